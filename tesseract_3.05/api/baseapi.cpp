@@ -71,6 +71,7 @@
 #include "makerow.h"
 #include "otsuthr.h"
 #include "osdetect.h"
+#include "pageresults.h"
 #include "params.h"
 #include "renderer.h"
 #include "strngs.h"
@@ -124,6 +125,8 @@ TessBaseAPI::TessBaseAPI()
     language_(NULL),
     last_oem_requested_(OEM_DEFAULT),
     recognition_done_(false),
+    page_results_(NULL),
+    share_page_results_(false),
     truth_cb_(NULL),
     rect_left_(0), rect_top_(0), rect_width_(0), rect_height_(0),
     image_width_(0), image_height_(0) {
@@ -831,6 +834,8 @@ int TessBaseAPI::Recognize(ETEXT_DESC* monitor) {
     return -1;
   if (FindLines() != 0)
     return -1;
+  delete page_results_;
+  page_results_ = NULL;
   delete page_res_;
   if (block_list_->empty()) {
     page_res_ = new PAGE_RES(false, block_list_,
@@ -902,6 +907,78 @@ int TessBaseAPI::Recognize(ETEXT_DESC* monitor) {
   return result;
 }
 
+/**
+ * Recognizes each of the boxes as a block of its own in a single pass.
+ * See the declaration for the details.
+ */
+bool TessBaseAPI::RecognizeRectangles(Boxa* boxes,
+                                      GenericVector<STRING>* texts,
+                                      GenericVector<int>* confidences) {
+  if (tesseract_ == NULL || thresholder_ == NULL || thresholder_->IsEmpty() ||
+      boxes == NULL)
+    return false;
+  // Threshold the whole image, once for all the boxes.
+  thresholder_->SetRectangle(0, 0, image_width_, image_height_);
+  ClearResults();
+  Threshold(tesseract_->mutable_pix_binary());
+  tesseract_->PrepareForPageseg();
+  int width = pixGetWidth(tesseract_->pix_binary());
+  int height = pixGetHeight(tesseract_->pix_binary());
+  // Make a block for each box. Tesseract coordinates have y going up.
+  int num_boxes = boxaGetCount(boxes);
+  BLOCK_IT block_it(block_list_);
+  for (int b = 0; b < num_boxes; ++b) {
+    l_int32 x, y, w, h;
+    if (boxaGetBoxGeometry(boxes, b, &x, &y, &w, &h) != 0) continue;
+    TBOX box(MAX(x, 0), MAX(height - (y + h), 0),
+             MIN(x + w, width), MIN(height - y, height));
+    if (box.width() <= 0 || box.height() <= 0) continue;
+    BLOCK* block = new BLOCK("", TRUE, 0, 0, box.left(), box.bottom(),
+                             box.right(), box.top());
+    block->set_index(b);
+    block->set_right_to_left(tesseract_->right_to_left());
+    block_it.add_to_end(block);
+  }
+  if (tesseract_->SegmentBlocks(block_list_) < 0)
+    return false;
+  OSResults osr;
+  tesseract_->PrepareForTessOCR(block_list_, NULL, &osr);
+  tesseract_->SetBlackAndWhitelist();
+  recognition_done_ = true;
+  page_res_ = new PAGE_RES(false, block_list_,
+                           &tesseract_->prev_word_best_choice_);
+  if (!block_list_->empty() &&
+      !tesseract_->recog_all_words(page_res_, NULL, NULL, NULL, 0))
+    return false;
+  // Collect the text and confidence of each box.
+  texts->init_to_size(num_boxes, STRING());
+  GenericVector<int> conf_sums;
+  GenericVector<int> word_counts;
+  conf_sums.init_to_size(num_boxes, 0);
+  word_counts.init_to_size(num_boxes, 0);
+  PAGE_RES_IT res_it(page_res_);
+  for (res_it.restart_page(); res_it.word() != NULL; res_it.forward()) {
+    WERD_CHOICE* choice = res_it.word()->best_choice;
+    if (choice == NULL) continue;
+    int b = res_it.block()->block->index();
+    STRING* text = &(*texts)[b];
+    if (word_counts[b] > 0)
+      *text += res_it.row() != res_it.prev_row() ? "\n" : " ";
+    *text += choice->unichar_string();
+    int w_conf = static_cast<int>(100 + 5 * choice->certainty());
+    conf_sums[b] += ClipToRange(w_conf, 0, 100);
+    ++word_counts[b];
+  }
+  if (confidences != NULL) {
+    confidences->init_to_size(num_boxes, 0);
+    for (int b = 0; b < num_boxes; ++b) {
+      if (word_counts[b] > 0)
+        (*confidences)[b] = conf_sums[b] / word_counts[b];
+    }
+  }
+  return true;
+}
+
 /** Tests the chopper by exhaustively running chop_one_blob. */
 int TessBaseAPI::RecognizeForChopTest(ETEXT_DESC* monitor) {
   if (tesseract_ == NULL)
@@ -1107,10 +1184,11 @@ bool TessBaseAPI::ProcessPagesInternal(const char* filename,
     data = reinterpret_cast<const l_uint8 *>(buf.data());
   }
 
-  // Here is our autodetection
+  // Here is our autodetection. findFileFormatBuffer looks at the first 12
+  // bytes, so anything shorter can only be a filelist.
   int format;
   int r = (stdInput) ?
-      findFileFormatBuffer(data, &format) :
+      (buf.size() < 12 ? 1 : findFileFormatBuffer(data, &format)) :
       findFileFormat(filename, &format);
 
   // Maybe we have a filelist
@@ -1128,6 +1206,10 @@ bool TessBaseAPI::ProcessPagesInternal(const char* filename,
                                 timeout_millisec, renderer,
                                 tesseract_->tessedit_page_number);
   }
+  if (stdInput) {
+    return ProcessPagesFromMemory(data, buf.size(), filename, retry_config,
+                                  timeout_millisec, renderer);
+  }
 
   // Maybe we have a TIFF which is potentially multipage
   bool tiff = (format == IFF_TIFF || format == IFF_TIFF_PACKBITS ||
@@ -1138,7 +1220,7 @@ bool TessBaseAPI::ProcessPagesInternal(const char* filename,
   // Fail early if we can, before producing any output
   Pix *pix = NULL;
   if (!tiff) {
-    pix = (stdInput) ? pixReadMem(data, buf.size()) : pixRead(filename);
+    pix = pixRead(filename);
     if (pix == NULL) {
       return false;
     }
@@ -1152,7 +1234,7 @@ bool TessBaseAPI::ProcessPagesInternal(const char* filename,
 
   // Produce output
   r = (tiff) ?
-      ProcessPagesMultipageTiff(data, buf.size(), filename, retry_config,
+      ProcessPagesMultipageTiff(NULL, 0, filename, retry_config,
                                 timeout_millisec, renderer,
                                 tesseract_->tessedit_page_number) :
       ProcessPage(pix, 0, filename, retry_config,
@@ -1169,6 +1251,46 @@ bool TessBaseAPI::ProcessPagesInternal(const char* filename,
   return true;
 }
 
+bool TessBaseAPI::ProcessPagesFromMemory(const unsigned char* data,
+                                         size_t size, const char* filename,
+                                         const char* retry_config,
+                                         int timeout_millisec,
+                                         TessResultRenderer* renderer) {
+  // findFileFormatBuffer looks at the first 12 bytes.
+  int format;
+  if (size < 12 || findFileFormatBuffer(data, &format) != 0 ||
+      format == IFF_UNKNOWN) {
+    tprintf("ERROR: Unknown image format\n");
+    return false;
+  }
+  bool tiff = (format == IFF_TIFF || format == IFF_TIFF_PACKBITS ||
+               format == IFF_TIFF_RLE || format == IFF_TIFF_G3 ||
+               format == IFF_TIFF_G4 || format == IFF_TIFF_LZW ||
+               format == IFF_TIFF_ZIP);
+  Pix *pix = NULL;
+  if (!tiff) {
+    pix = pixReadMem(data, size);
+    if (pix == NULL) {
+      return false;
+    }
+  }
+  if (renderer && !renderer->BeginDocument(unknown_title_)) {
+    pixDestroy(&pix);
+    return false;
+  }
+  bool r = (tiff) ?
+      ProcessPagesMultipageTiff(data, size, filename, retry_config,
+                                timeout_millisec, renderer,
+                                tesseract_->tessedit_page_number) :
+      ProcessPage(pix, 0, filename, retry_config,
+                  timeout_millisec, renderer);
+  pixDestroy(&pix);
+  if (!r || (renderer && !renderer->EndDocument())) {
+    return false;
+  }
+  return true;
+}
+
 bool TessBaseAPI::ProcessPage(Pix* pix, int page_index, const char* filename,
                               const char* retry_config, int timeout_millisec,
                               TessResultRenderer* renderer) {
@@ -1283,63 +1405,68 @@ char* TessBaseAPI::GetUTF8Text() {
       (!recognition_done_ && Recognize(NULL) < 0))
     return NULL;
   STRING text("");
-  ResultIterator *it = GetIterator();
-  do {
-    if (it->Empty(RIL_PARA)) continue;
-    char *para_text = it->GetUTF8Text(RIL_PARA);
-    text += para_text;
-    delete []para_text;
-  } while (it->Next(RIL_PARA));
+  const PageResults* results = GetPageResults();
+  results->AppendUTF8Text(&text);
+  ReleasePageResults(results);
   char* result = new char[text.length() + 1];
   strncpy(result, text.string(), text.length() + 1);
-  delete it;
   return result;
 }
 
 /**
- * Gets the block orientation at the current iterator position.
+ * Returns the results of the current page walked once for all the output
+ * formats. Must be given back to ReleasePageResults.
  */
-static tesseract::Orientation GetBlockTextOrientation(const PageIterator *it) {
-  tesseract::Orientation orientation;
-  tesseract::WritingDirection writing_direction;
-  tesseract::TextlineOrder textline_order;
-  float deskew_angle;
-  it->Orientation(&orientation, &writing_direction, &textline_order,
-                  &deskew_angle);
-  return orientation;
+const PageResults* TessBaseAPI::GetPageResults() {
+  if (page_results_ != NULL) return page_results_;
+  PageResults* results = new PageResults;
+  ResultIterator* it = GetIterator();
+  if (it != NULL) {
+    results->Collect(it);
+    delete it;
+  }
+  if (share_page_results_) page_results_ = results;
+  return results;
+}
+
+void TessBaseAPI::ReleasePageResults(const PageResults* results) {
+  if (results != page_results_) delete results;
+}
+
+void TessBaseAPI::SharePageResults(bool share) {
+  share_page_results_ = share;
+  if (!share) {
+    delete page_results_;
+    page_results_ = NULL;
+  }
 }
 
 /**
- * Fits a line to the baseline at the given level, and appends its coefficients
- * to the hOCR string.
+ * Fits a line to the baseline of the textline started by the given word, and
+ * appends its coefficients to the hOCR string.
  * NOTE: The hOCR spec is unclear on how to specify baseline coefficients for
  * rotated textlines. For this reason, on textlines that are not upright, this
  * method currently only inserts a 'textangle' property to indicate the rotation
  * direction and does not add any baseline information to the hocr string.
  */
-static void AddBaselineCoordsTohOCR(const PageIterator *it,
-                                    PageIteratorLevel level,
-                                    STRING* hocr_str) {
-  tesseract::Orientation orientation = GetBlockTextOrientation(it);
+static void AddBaselineCoordsTohOCR(const PageResultsWord& word,
+                                    ResultWriter* hocr) {
+  tesseract::Orientation orientation = word.orientation;
   if (orientation != ORIENTATION_PAGE_UP) {
-    hocr_str->add_str_int("; textangle ", 360 - orientation * 90);
+    hocr->AddInt("; textangle ", 360 - orientation * 90);
     return;
   }
 
-  int left, top, right, bottom;
-  it->BoundingBox(level, &left, &top, &right, &bottom);
-
-  // Try to get the baseline coordinates at this level.
-  int x1, y1, x2, y2;
-  if (!it->Baseline(level, &x1, &y1, &x2, &y2))
+  // Try to get the baseline coordinates of the textline.
+  if (!word.has_line_baseline)
     return;
   // Following the description of this field of the hOCR spec, we convert the
   // baseline coordinates so that "the bottom left of the bounding box is the
   // origin".
-  x1 -= left;
-  x2 -= left;
-  y1 -= bottom;
-  y2 -= bottom;
+  int x1 = word.line_x1 - word.line_box.left;
+  int x2 = word.line_x2 - word.line_box.left;
+  int y1 = word.line_y1 - word.line_box.bottom;
+  int y2 = word.line_y2 - word.line_box.bottom;
 
   // Now fit a line through the points so we can extract coefficients for the
   // equation:  y = p1 x + p0
@@ -1352,57 +1479,55 @@ static void AddBaselineCoordsTohOCR(const PageIterator *it,
   p1 = (y2 - y1) / static_cast<double>(x2 - x1);
   p0 = y1 - static_cast<double>(p1 * x1);
 
-  hocr_str->add_str_double("; baseline ", round(p1 * 1000.0) / 1000.0);
-  hocr_str->add_str_double(" ", round(p0 * 1000.0) / 1000.0);
+  hocr->AddDouble("; baseline ", round(p1 * 1000.0) / 1000.0);
+  hocr->AddDouble(" ", round(p0 * 1000.0) / 1000.0);
 }
 
-static void AddIdTohOCR(STRING* hocr_str, const std::string base, int num1,
+static void AddIdTohOCR(ResultWriter* hocr, const char* base, int num1,
                         int num2) {
-  const size_t BUFSIZE = 64;
-  char id_buffer[BUFSIZE];
-  if (num2 >= 0) {
-    snprintf(id_buffer, BUFSIZE - 1, "%s_%d_%d", base.c_str(), num1, num2);
-  } else {
-    snprintf(id_buffer, BUFSIZE - 1, "%s_%d", base.c_str(), num1);
-  }
-  id_buffer[BUFSIZE - 1] = '\0';
-  *hocr_str += " id='";
-  *hocr_str += id_buffer;
-  *hocr_str += "'";
+  hocr->Add(" id='");
+  hocr->Add(base);
+  hocr->AddInt("_", num1);
+  if (num2 >= 0) hocr->AddInt("_", num2);
+  hocr->Add("'");
 }
 
-static void AddBoxTohOCR(const ResultIterator* it, PageIteratorLevel level,
-                         STRING* hocr_str) {
-  int left, top, right, bottom;
-  it->BoundingBox(level, &left, &top, &right, &bottom);
+static void AddBoxTohOCR(const PageResultsWord& word, PageIteratorLevel level,
+                         ResultWriter* hocr) {
+  const PageResultsBox& box = word.box(level);
   // This is the only place we use double quotes instead of single quotes,
   // but it may too late to change for consistency
-  hocr_str->add_str_int(" title=\"bbox ", left);
-  hocr_str->add_str_int(" ", top);
-  hocr_str->add_str_int(" ", right);
-  hocr_str->add_str_int(" ", bottom);
+  hocr->AddInt(" title=\"bbox ", box.left);
+  hocr->AddInt(" ", box.top);
+  hocr->AddInt(" ", box.right);
+  hocr->AddInt(" ", box.bottom);
   // Add baseline coordinates & heights for textlines only.
   if (level == RIL_TEXTLINE) {
-    AddBaselineCoordsTohOCR(it, level, hocr_str);
+    AddBaselineCoordsTohOCR(word, hocr);
     // add custom height measures
-    float row_height, descenders, ascenders;  // row attributes
-    it->RowAttributes(&row_height, &descenders, &ascenders);
     // TODO(rays): Do we want to limit these to a single decimal place?
-    hocr_str->add_str_double("; x_size ", row_height);
-    hocr_str->add_str_double("; x_descenders ", descenders * -1);
-    hocr_str->add_str_double("; x_ascenders ", ascenders);
+    hocr->AddDouble("; x_size ", word.row_height);
+    hocr->AddDouble("; x_descenders ", word.descenders * -1);
+    hocr->AddDouble("; x_ascenders ", word.ascenders);
   }
-  *hocr_str += "\">";
+  hocr->Add("\">");
 }
 
-static void AddBoxToTSV(const PageIterator* it, PageIteratorLevel level,
-                        STRING* hocr_str) {
-  int left, top, right, bottom;
-  it->BoundingBox(level, &left, &top, &right, &bottom);
-  hocr_str->add_str_int("\t", left);
-  hocr_str->add_str_int("\t", top);
-  hocr_str->add_str_int("\t", right - left);
-  hocr_str->add_str_int("\t", bottom - top);
+static void AddBoxToTSV(const PageResultsWord& word, PageIteratorLevel level,
+                        ResultWriter* tsv) {
+  const PageResultsBox& box = word.box(level);
+  tsv->AddInt("\t", box.left);
+  tsv->AddInt("\t", box.top);
+  tsv->AddInt("\t", box.right - box.left);
+  tsv->AddInt("\t", box.bottom - box.top);
+}
+
+// Returns a new[] copy of the text in the given buffer, NUL-terminated.
+static char* CopyToNewString(const GenericVector<char>& text) {
+  char* result = new char[text.size() + 1];
+  if (text.size() > 0) memcpy(result, &text[0], text.size());
+  result[text.size()] = '\0';
+  return result;
 }
 
 /**
@@ -1426,8 +1551,20 @@ char* TessBaseAPI::GetHOCRText(int page_number) {
  * STL removed from original patch submission and refactored by rays.
  */
 char* TessBaseAPI::GetHOCRText(ETEXT_DESC* monitor, int page_number) {
-  if (tesseract_ == NULL || (page_res_ == NULL && Recognize(monitor) < 0))
+  GenericVector<char> hocr;
+  if (!WriteHOCRText(monitor, page_number, &hocr))
     return NULL;
+  return CopyToNewString(hocr);
+}
+
+/**
+ * Appends the hOCR markup of GetHOCRText to the given buffer.
+ * Returns false if recognition fails, without appending anything.
+ */
+bool TessBaseAPI::WriteHOCRText(ETEXT_DESC* monitor, int page_number,
+                                GenericVector<char>* out) {
+  if (tesseract_ == NULL || (page_res_ == NULL && Recognize(monitor) < 0))
+    return false;
 
   int lcnt = 1, bcnt = 1, pcnt = 1, wcnt = 1;
   int page_id = page_number + 1;  // hOCR uses 1-based page numbers.
@@ -1436,7 +1573,7 @@ char* TessBaseAPI::GetHOCRText(ETEXT_DESC* monitor, int page_number) {
   bool font_info = false;
   GetBoolVariable("hocr_font_info", &font_info);
 
-  STRING hocr_str("");
+  ResultWriter hocr(out);
 
   if (input_file_ == NULL)
       SetInputName(NULL);
@@ -1458,138 +1595,117 @@ char* TessBaseAPI::GetHOCRText(ETEXT_DESC* monitor, int page_number) {
   delete[] utf8_str;
 #endif
 
-  hocr_str += "  <div class='ocr_page'";
-  AddIdTohOCR(&hocr_str, "page", page_id, -1);
-  hocr_str += " title='image \"";
+  hocr.Add("  <div class='ocr_page'");
+  AddIdTohOCR(&hocr, "page", page_id, -1);
+  hocr.Add(" title='image \"");
   if (input_file_) {
-    hocr_str += HOcrEscape(input_file_->string());
+    hocr.AddHOcrEscaped(input_file_->string());
   } else {
-    hocr_str += "unknown";
-  }
-  hocr_str.add_str_int("\"; bbox ", rect_left_);
-  hocr_str.add_str_int(" ", rect_top_);
-  hocr_str.add_str_int(" ", rect_width_);
-  hocr_str.add_str_int(" ", rect_height_);
-  hocr_str.add_str_int("; ppageno ", page_number);
-  hocr_str += "'>\n";
-
-  ResultIterator *res_it = GetIterator();
-  while (!res_it->Empty(RIL_BLOCK)) {
-    if (res_it->Empty(RIL_WORD)) {
-      res_it->Next(RIL_WORD);
-      continue;
-    }
+    hocr.Add("unknown");
+  }
+  hocr.AddInt("\"; bbox ", rect_left_);
+  hocr.AddInt(" ", rect_top_);
+  hocr.AddInt(" ", rect_width_);
+  hocr.AddInt(" ", rect_height_);
+  hocr.AddInt("; ppageno ", page_number);
+  hocr.Add("'>\n");
+
+  const PageResults* results = GetPageResults();
+  const GenericVector<PageResultsWord>& words = results->words();
+  for (int w = 0; w < words.size(); ++w) {
+    const PageResultsWord& word = words[w];
+    if (word.empty) continue;
 
     // Open any new block/paragraph/textline.
-    if (res_it->IsAtBeginningOf(RIL_BLOCK)) {
+    if (word.starts_block) {
       para_is_ltr = true;  // reset to default direction
-      hocr_str += "   <div class='ocr_carea'";
-      AddIdTohOCR(&hocr_str, "block", page_id, bcnt);
-      AddBoxTohOCR(res_it, RIL_BLOCK, &hocr_str);
+      hocr.Add("   <div class='ocr_carea'");
+      AddIdTohOCR(&hocr, "block", page_id, bcnt);
+      AddBoxTohOCR(word, RIL_BLOCK, &hocr);
     }
-    if (res_it->IsAtBeginningOf(RIL_PARA)) {
-      hocr_str += "\n    <p class='ocr_par'";
-      para_is_ltr = res_it->ParagraphIsLtr();
+    if (word.starts_para) {
+      hocr.Add("\n    <p class='ocr_par'");
+      para_is_ltr = word.para_is_ltr;
       if (!para_is_ltr) {
-        hocr_str += " dir='rtl'";
+        hocr.Add(" dir='rtl'");
       }
-      AddIdTohOCR(&hocr_str, "par", page_id, pcnt);
-      paragraph_lang = res_it->WordRecognitionLanguage();
+      AddIdTohOCR(&hocr, "par", page_id, pcnt);
+      paragraph_lang = word.lang;
       if (paragraph_lang) {
-        hocr_str += " lang='";
-        hocr_str += paragraph_lang;
-        hocr_str += "'";
+        hocr.Add(" lang='");
+        hocr.Add(paragraph_lang);
+        hocr.Add("'");
       }
-      AddBoxTohOCR(res_it, RIL_PARA, &hocr_str);
+      AddBoxTohOCR(word, RIL_PARA, &hocr);
     }
-    if (res_it->IsAtBeginningOf(RIL_TEXTLINE)) {
-      hocr_str += "\n     <span class='ocr_line'";
-      AddIdTohOCR(&hocr_str, "line", page_id, lcnt);
-      AddBoxTohOCR(res_it, RIL_TEXTLINE, &hocr_str);
+    if (word.starts_line) {
+      hocr.Add("\n     <span class='ocr_line'");
+      AddIdTohOCR(&hocr, "line", page_id, lcnt);
+      AddBoxTohOCR(word, RIL_TEXTLINE, &hocr);
     }
 
     // Now, process the word...
-    hocr_str += "<span class='ocrx_word'";
-    AddIdTohOCR(&hocr_str, "word", page_id, wcnt);
-    int left, top, right, bottom;
-    bool bold, italic, underlined, monospace, serif, smallcaps;
-    int pointsize, font_id;
-    const char *font_name;
-    res_it->BoundingBox(RIL_WORD, &left, &top, &right, &bottom);
-    font_name = res_it->WordFontAttributes(&bold, &italic, &underlined,
-                                           &monospace, &serif, &smallcaps,
-                                           &pointsize, &font_id);
-    hocr_str.add_str_int(" title='bbox ", left);
-    hocr_str.add_str_int(" ", top);
-    hocr_str.add_str_int(" ", right);
-    hocr_str.add_str_int(" ", bottom);
-    hocr_str.add_str_int("; x_wconf ", res_it->Confidence(RIL_WORD));
+    hocr.Add("<span class='ocrx_word'");
+    AddIdTohOCR(&hocr, "word", page_id, wcnt);
+    const PageResultsBox& box = word.word_box;
+    hocr.AddInt(" title='bbox ", box.left);
+    hocr.AddInt(" ", box.top);
+    hocr.AddInt(" ", box.right);
+    hocr.AddInt(" ", box.bottom);
+    hocr.AddInt("; x_wconf ", word.confidence);
     if (font_info) {
-      if (font_name) {
-        hocr_str += "; x_font ";
-        hocr_str += HOcrEscape(font_name);
+      if (word.font_name) {
+        hocr.Add("; x_font ");
+        hocr.AddHOcrEscaped(word.font_name);
       }
-      hocr_str.add_str_int("; x_fsize ", pointsize);
+      hocr.AddInt("; x_fsize ", word.pointsize);
     }
-    hocr_str += "'";
-    const char* lang = res_it->WordRecognitionLanguage();
+    hocr.Add("'");
+    const char* lang = word.lang;
     if (lang && (!paragraph_lang || strcmp(lang, paragraph_lang))) {
-      hocr_str += " lang='";
-      hocr_str += lang;
-      hocr_str += "'";
+      hocr.Add(" lang='");
+      hocr.Add(lang);
+      hocr.Add("'");
     }
-    switch (res_it->WordDirection()) {
+    switch (word.direction) {
       // Only emit direction if different from current paragraph direction
       case DIR_LEFT_TO_RIGHT:
-        if (!para_is_ltr) hocr_str += " dir='ltr'";
+        if (!para_is_ltr) hocr.Add(" dir='ltr'");
         break;
       case DIR_RIGHT_TO_LEFT:
-        if (para_is_ltr) hocr_str += " dir='rtl'";
+        if (para_is_ltr) hocr.Add(" dir='rtl'");
         break;
       case DIR_MIX:
       case DIR_NEUTRAL:
       default:  // Do nothing.
         break;
     }
-    hocr_str += ">";
-    bool last_word_in_line = res_it->IsAtFinalElement(RIL_TEXTLINE, RIL_WORD);
-    bool last_word_in_para = res_it->IsAtFinalElement(RIL_PARA, RIL_WORD);
-    bool last_word_in_block = res_it->IsAtFinalElement(RIL_BLOCK, RIL_WORD);
-    if (bold) hocr_str += "<strong>";
-    if (italic) hocr_str += "<em>";
-    do {
-      const char *grapheme = res_it->GetUTF8Text(RIL_SYMBOL);
-      if (grapheme && grapheme[0] != 0) {
-        hocr_str += HOcrEscape(grapheme);
-      }
-      delete []grapheme;
-      res_it->Next(RIL_SYMBOL);
-    } while (!res_it->Empty(RIL_BLOCK) && !res_it->IsAtBeginningOf(RIL_WORD));
-    if (italic) hocr_str += "</em>";
-    if (bold) hocr_str += "</strong>";
-    hocr_str += "</span> ";
+    hocr.Add(">");
+    if (word.bold) hocr.Add("<strong>");
+    if (word.italic) hocr.Add("<em>");
+    hocr.AddHOcrEscaped(word.symbols_text.string());
+    if (word.italic) hocr.Add("</em>");
+    if (word.bold) hocr.Add("</strong>");
+    hocr.Add("</span> ");
     wcnt++;
     // Close any ending block/paragraph/textline.
-    if (last_word_in_line) {
-      hocr_str += "\n     </span>";
+    if (word.ends_line) {
+      hocr.Add("\n     </span>");
       lcnt++;
     }
-    if (last_word_in_para) {
-      hocr_str += "\n    </p>\n";
+    if (word.ends_para) {
+      hocr.Add("\n    </p>\n");
       pcnt++;
       para_is_ltr = true;  // back to default direction
     }
-    if (last_word_in_block) {
-      hocr_str += "   </div>\n";
+    if (word.ends_block) {
+      hocr.Add("   </div>\n");
       bcnt++;
     }
   }
-  hocr_str += "  </div>\n";
-
-  char *ret = new char[hocr_str.length() + 1];
-  strcpy(ret, hocr_str.string());
-  delete res_it;
-  return ret;
+  ReleasePageResults(results);
+  hocr.Add("  </div>\n");
+  return true;
 }
 
 /**
@@ -1597,106 +1713,91 @@ char* TessBaseAPI::GetHOCRText(ETEXT_DESC* monitor, int page_number) {
  * page_number is 0-based but will appear in the output as 1-based.
  */
 char* TessBaseAPI::GetTSVText(int page_number) {
-  if (tesseract_ == NULL || (page_res_ == NULL && Recognize(NULL) < 0))
+  GenericVector<char> tsv;
+  if (!WriteTSVText(page_number, &tsv))
     return NULL;
+  return CopyToNewString(tsv);
+}
+
+/**
+ * Appends the rows of GetTSVText to the given buffer.
+ * Returns false if recognition fails, without appending anything.
+ */
+bool TessBaseAPI::WriteTSVText(int page_number, GenericVector<char>* out) {
+  if (tesseract_ == NULL || (page_res_ == NULL && Recognize(NULL) < 0))
+    return false;
 
-  int lcnt = 1, bcnt = 1, pcnt = 1, wcnt = 1;
   int page_id = page_number + 1;  // we use 1-based page numbers.
 
-  STRING tsv_str("");
+  ResultWriter tsv(out);
 
   int page_num = page_id, block_num = 0, par_num = 0, line_num = 0,
       word_num = 0;
 
-  tsv_str.add_str_int("1\t", page_num);  // level 1 - page
-  tsv_str.add_str_int("\t", block_num);
-  tsv_str.add_str_int("\t", par_num);
-  tsv_str.add_str_int("\t", line_num);
-  tsv_str.add_str_int("\t", word_num);
-  tsv_str.add_str_int("\t", rect_left_);
-  tsv_str.add_str_int("\t", rect_top_);
-  tsv_str.add_str_int("\t", rect_width_);
-  tsv_str.add_str_int("\t", rect_height_);
-  tsv_str += "\t-1\t\n";
-
-  ResultIterator* res_it = GetIterator();
-  while (!res_it->Empty(RIL_BLOCK)) {
-    if (res_it->Empty(RIL_WORD)) {
-      res_it->Next(RIL_WORD);
-      continue;
-    }
+  tsv.AddInt("1\t", page_num);  // level 1 - page
+  tsv.AddInt("\t", block_num);
+  tsv.AddInt("\t", par_num);
+  tsv.AddInt("\t", line_num);
+  tsv.AddInt("\t", word_num);
+  tsv.AddInt("\t", rect_left_);
+  tsv.AddInt("\t", rect_top_);
+  tsv.AddInt("\t", rect_width_);
+  tsv.AddInt("\t", rect_height_);
+  tsv.Add("\t-1\t\n");
+
+  const PageResults* results = GetPageResults();
+  const GenericVector<PageResultsWord>& words = results->words();
+  for (int w = 0; w < words.size(); ++w) {
+    const PageResultsWord& word = words[w];
+    if (word.empty) continue;
 
     // Add rows for any new block/paragraph/textline.
-    if (res_it->IsAtBeginningOf(RIL_BLOCK)) {
+    if (word.starts_block) {
       block_num++, par_num = 0, line_num = 0, word_num = 0;
-      tsv_str.add_str_int("2\t", page_num);  // level 2 - block
-      tsv_str.add_str_int("\t", block_num);
-      tsv_str.add_str_int("\t", par_num);
-      tsv_str.add_str_int("\t", line_num);
-      tsv_str.add_str_int("\t", word_num);
-      AddBoxToTSV(res_it, RIL_BLOCK, &tsv_str);
-      tsv_str += "\t-1\t\n";  // end of row for block
+      tsv.AddInt("2\t", page_num);  // level 2 - block
+      tsv.AddInt("\t", block_num);
+      tsv.AddInt("\t", par_num);
+      tsv.AddInt("\t", line_num);
+      tsv.AddInt("\t", word_num);
+      AddBoxToTSV(word, RIL_BLOCK, &tsv);
+      tsv.Add("\t-1\t\n");  // end of row for block
     }
-    if (res_it->IsAtBeginningOf(RIL_PARA)) {
+    if (word.starts_para) {
       par_num++, line_num = 0, word_num = 0;
-      tsv_str.add_str_int("3\t", page_num);  // level 3 - paragraph
-      tsv_str.add_str_int("\t", block_num);
-      tsv_str.add_str_int("\t", par_num);
-      tsv_str.add_str_int("\t", line_num);
-      tsv_str.add_str_int("\t", word_num);
-      AddBoxToTSV(res_it, RIL_PARA, &tsv_str);
-      tsv_str += "\t-1\t\n";  // end of row for para
+      tsv.AddInt("3\t", page_num);  // level 3 - paragraph
+      tsv.AddInt("\t", block_num);
+      tsv.AddInt("\t", par_num);
+      tsv.AddInt("\t", line_num);
+      tsv.AddInt("\t", word_num);
+      AddBoxToTSV(word, RIL_PARA, &tsv);
+      tsv.Add("\t-1\t\n");  // end of row for para
     }
-    if (res_it->IsAtBeginningOf(RIL_TEXTLINE)) {
+    if (word.starts_line) {
       line_num++, word_num = 0;
-      tsv_str.add_str_int("4\t", page_num);  // level 4 - line
-      tsv_str.add_str_int("\t", block_num);
-      tsv_str.add_str_int("\t", par_num);
-      tsv_str.add_str_int("\t", line_num);
-      tsv_str.add_str_int("\t", word_num);
-      AddBoxToTSV(res_it, RIL_TEXTLINE, &tsv_str);
-      tsv_str += "\t-1\t\n";  // end of row for line
+      tsv.AddInt("4\t", page_num);  // level 4 - line
+      tsv.AddInt("\t", block_num);
+      tsv.AddInt("\t", par_num);
+      tsv.AddInt("\t", line_num);
+      tsv.AddInt("\t", word_num);
+      AddBoxToTSV(word, RIL_TEXTLINE, &tsv);
+      tsv.Add("\t-1\t\n");  // end of row for line
     }
 
     // Now, process the word...
-    int left, top, right, bottom;
-    bool bold, italic, underlined, monospace, serif, smallcaps;
-    int pointsize, font_id;
-    const char* font_name;
-    res_it->BoundingBox(RIL_WORD, &left, &top, &right, &bottom);
-    font_name =
-        res_it->WordFontAttributes(&bold, &italic, &underlined, &monospace,
-                                   &serif, &smallcaps, &pointsize, &font_id);
     word_num++;
-    tsv_str.add_str_int("5\t", page_num);  // level 5 - word
-    tsv_str.add_str_int("\t", block_num);
-    tsv_str.add_str_int("\t", par_num);
-    tsv_str.add_str_int("\t", line_num);
-    tsv_str.add_str_int("\t", word_num);
-    tsv_str.add_str_int("\t", left);
-    tsv_str.add_str_int("\t", top);
-    tsv_str.add_str_int("\t", right - left);
-    tsv_str.add_str_int("\t", bottom - top);
-    tsv_str.add_str_int("\t", res_it->Confidence(RIL_WORD));
-    tsv_str += "\t";
-
-    // Increment counts if at end of block/paragraph/textline.
-    if (res_it->IsAtFinalElement(RIL_TEXTLINE, RIL_WORD)) lcnt++;
-    if (res_it->IsAtFinalElement(RIL_PARA, RIL_WORD)) pcnt++;
-    if (res_it->IsAtFinalElement(RIL_BLOCK, RIL_WORD)) bcnt++;
-
-    do {
-      tsv_str += res_it->GetUTF8Text(RIL_SYMBOL);
-      res_it->Next(RIL_SYMBOL);
-    } while (!res_it->Empty(RIL_BLOCK) && !res_it->IsAtBeginningOf(RIL_WORD));
-    tsv_str += "\n";  // end of row
-    wcnt++;
-  }
-
-  char* ret = new char[tsv_str.length() + 1];
-  strcpy(ret, tsv_str.string());
-  delete res_it;
-  return ret;
+    tsv.AddInt("5\t", page_num);  // level 5 - word
+    tsv.AddInt("\t", block_num);
+    tsv.AddInt("\t", par_num);
+    tsv.AddInt("\t", line_num);
+    tsv.AddInt("\t", word_num);
+    AddBoxToTSV(word, RIL_WORD, &tsv);
+    tsv.AddInt("\t", word.confidence);
+    tsv.Add("\t");
+    tsv.Add(word.symbols_text);
+    tsv.Add("\n");  // end of row
+  }
+  ReleasePageResults(results);
+  return true;
 }
 
 /** The 5 numbers output for each box (the usual 4 and a page number.) */
@@ -2328,6 +2429,8 @@ void TessBaseAPI::ClearResults() {
     delete page_res_;
     page_res_ = NULL;
   }
+  delete page_results_;
+  page_results_ = NULL;
   recognition_done_ = false;
   if (block_list_ == NULL)
     block_list_ = new BLOCK_LIST;
@@ -75,6 +75,7 @@ class PageIterator;
 class LTRResultIterator;
 class ResultIterator;
 class MutableIterator;
+class PageResults;
 class TessResultRenderer;
 class Tesseract;
 class Trie;
@@ -504,6 +505,27 @@ class TESS_API TessBaseAPI {
    */
   int Recognize(ETEXT_DESC* monitor);
 
+  /**
+   * Recognizes many small regions of the image in a single pass, instead of
+   * a SetRectangle and Recognize for each of them. Each box of boxes (in
+   * image coordinates) becomes a block of its own, segmented according to
+   * the current PageSegMode, which must be one without layout analysis:
+   * PSM_SINGLE_BLOCK, PSM_SINGLE_BLOCK_VERT_TEXT, PSM_SINGLE_LINE,
+   * PSM_SINGLE_WORD, PSM_SINGLE_CHAR or PSM_RAW_LINE.
+   * The whole image is thresholded once, and the words of all the boxes are
+   * recognized together in a single set of page results, so the page-level
+   * setup and teardown is paid once per batch instead of once per box.
+   * On success, texts holds the UTF-8 text of each box, in the order of
+   * boxes, with words separated by spaces and lines by newlines, and empty
+   * if nothing was found in the box. If confidences is not NULL, it holds
+   * the mean word confidence (0-100) of each box. The results of the whole
+   * batch stay available through GetIterator etc until the next SetImage
+   * or SetRectangle.
+   * Returns false on failure.
+   */
+  bool RecognizeRectangles(Boxa* boxes, GenericVector<STRING>* texts,
+                           GenericVector<int>* confidences);
+
   /**
    * Methods to retrieve information after SetAndThresholdImage(),
    * Recognize() or TesseractRect(). (Recognize is called implicitly if needed.)
@@ -540,6 +562,16 @@ class TESS_API TessBaseAPI {
   bool ProcessPagesInternal(const char* filename, const char* retry_config,
                             int timeout_millisec, TessResultRenderer* renderer);
 
+  /**
+   * As ProcessPages, for an image (or a multi-page TIFF) that is already in
+   * memory, such as one received over a socket. filename is only used as
+   * the name of the input, e.g. in the hOCR output, and may be "".
+   */
+  bool ProcessPagesFromMemory(const unsigned char* data, size_t size,
+                              const char* filename, const char* retry_config,
+                              int timeout_millisec,
+                              TessResultRenderer* renderer);
+
   /**
    * Turn a single image into symbolic text.
    *
@@ -602,6 +634,15 @@ class TESS_API TessBaseAPI {
    */
   char* GetTSVText(int page_number);
 
+  /**
+   * Append the hOCR markup of GetHOCRText or the rows of GetTSVText to the
+   * given buffer, which the renderers keep from one page to the next.
+   * Return false if recognition fails.
+   */
+  TESS_LOCAL bool WriteHOCRText(ETEXT_DESC* monitor, int page_number,
+                                GenericVector<char>* out);
+  TESS_LOCAL bool WriteTSVText(int page_number, GenericVector<char>* out);
+
   /**
    * The recognized text is returned as a char* which is coded in the same
    * format as a box file used in training. Returned string must be freed with
@@ -822,6 +863,22 @@ class TESS_API TessBaseAPI {
    */
   TESS_LOCAL int TextLength(int* blob_count);
 
+  /**
+   * Returns the results of the current page collected in one walk of a
+   * ResultIterator, from which GetUTF8Text, GetHOCRText, GetTSVText and the
+   * PDF text layer are made. While SharePageResults(true) is in effect, the
+   * walk is kept and shared by all the callers, otherwise every call walks
+   * the page again. Use ReleasePageResults when done with the results.
+   */
+  TESS_LOCAL const PageResults* GetPageResults();
+  TESS_LOCAL void ReleasePageResults(const PageResults* results);
+  /**
+   * Starts or ends sharing the page results between the output formats.
+   * TessResultRenderer::AddImage shares them between all the renderers in
+   * the chain, so the page is walked once however many formats are made.
+   */
+  TESS_LOCAL void SharePageResults(bool share);
+
   /** @defgroup ocropusAddOns ocropus add-ons */
   /* @{ */
 
@@ -875,6 +932,8 @@ class TESS_API TessBaseAPI {
   STRING*           language_;        ///< Last initialized language.
   OcrEngineMode last_oem_requested_;  ///< Last ocr language mode requested.
   bool          recognition_done_;   ///< page_res_ contains recognition data.
+  PageResults*  page_results_;       ///< Shared walk of page_res_ or NULL.
+  bool          share_page_results_; ///< Keep page_results_ between calls.
   TruthCallback *truth_cb_;           /// fxn for setting truth_* in WERD_RES
 
   /**
@@ -911,6 +970,11 @@ class TESS_API TessBaseAPI {
   // variable will hopefully reduce confusion if the situation changes
   // in the future.
   const char *unknown_title_;
+
+  friend class TessResultRenderer;
+  friend class TessPDFRenderer;
+  friend class TessHOcrRenderer;
+  friend class TessTsvRenderer;
 };  // class TessBaseAPI.
 
 /** Escape a char string - remove &<>"' with HTML codes. */
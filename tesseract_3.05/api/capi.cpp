@@ -18,6 +18,7 @@
 #ifndef TESS_CAPI_INCLUDE_BASEAPI
 #   define TESS_CAPI_INCLUDE_BASEAPI
 #endif
+#include <string.h>
 #include "capi.h"
 #include "genericvector.h"
 #include "strngs.h"
@@ -32,6 +33,29 @@ TESS_API void TESS_CALL TessDeleteText(char* text)
     delete [] text;
 }
 
+// Copies length bytes of text into the buffer of a *Buffer function, as
+// much as fits with the terminator, and returns length.
+static int CopyToBuffer(const char* text, int length, char* buffer, int buffer_size)
+{
+    if (buffer != NULL && buffer_size > 0) {
+        int copied = length < buffer_size ? length : buffer_size - 1;
+        memcpy(buffer, text, copied);
+        buffer[copied] = '\0';
+    }
+    return length;
+}
+
+// Copies a text returned by a Get*Text function into the buffer of a
+// *Buffer function and deletes it.
+static int CopyTextToBuffer(char* text, char* buffer, int buffer_size)
+{
+    if (text == NULL)
+        return -1;
+    int length = CopyToBuffer(text, strlen(text), buffer, buffer_size);
+    delete [] text;
+    return length;
+}
+
 TESS_API void TESS_CALL TessDeleteTextArray(char** arr)
 {
     for (char** pos = arr; *pos != NULL; ++pos)
@@ -502,6 +526,78 @@ TESS_API int* TESS_CALL TessBaseAPIAllWordConfidences(TessBaseAPI* handle)
     return handle->AllWordConfidences();
 }
 
+TESS_API int TESS_CALL TessBaseAPIGetUTF8TextBuffer(TessBaseAPI* handle, char* buffer, int buffer_size)
+{
+    return CopyTextToBuffer(handle->GetUTF8Text(), buffer, buffer_size);
+}
+
+TESS_API int TESS_CALL TessBaseAPIGetHOCRTextBuffer(TessBaseAPI* handle, int page_number, char* buffer, int buffer_size)
+{
+    return CopyTextToBuffer(handle->GetHOCRText(NULL, page_number), buffer, buffer_size);
+}
+
+TESS_API int TESS_CALL TessBaseAPIGetBoxTextBuffer(TessBaseAPI* handle, int page_number, char* buffer, int buffer_size)
+{
+    return CopyTextToBuffer(handle->GetBoxText(page_number), buffer, buffer_size);
+}
+
+TESS_API int TESS_CALL TessBaseAPIGetUNLVTextBuffer(TessBaseAPI* handle, char* buffer, int buffer_size)
+{
+    return CopyTextToBuffer(handle->GetUNLVText(), buffer, buffer_size);
+}
+
+TESS_API int TESS_CALL TessBaseAPIGetWordResults(TessBaseAPI* handle, TessWordResult* words, int max_words,
+                                                 char* text, int text_size, int* text_length)
+{
+    tesseract::ResultIterator* it = handle->GetIterator();
+    if (it == NULL)
+        return -1;
+    int num_words = 0;
+    int length = 0;
+    int block_num = 0, par_num = 0, line_num = 0, word_num = 0;
+    STRING word_text;
+    for (; !it->Empty(tesseract::RIL_BLOCK); it->Next(tesseract::RIL_WORD)) {
+        if (it->Empty(tesseract::RIL_WORD))
+            continue;
+        if (it->IsAtBeginningOf(tesseract::RIL_BLOCK)) {
+            block_num++;
+            par_num = 0;
+        }
+        if (it->IsAtBeginningOf(tesseract::RIL_PARA)) {
+            par_num++;
+            line_num = 0;
+        }
+        if (it->IsAtBeginningOf(tesseract::RIL_TEXTLINE)) {
+            line_num++;
+            word_num = 0;
+        }
+        word_num++;
+        word_text.truncate_at(0);
+        it->AppendUTF8Text(tesseract::RIL_WORD, &word_text);
+        int word_length = word_text.length() + 1;
+        if (num_words < max_words) {
+            TessWordResult* word = &words[num_words];
+            it->BoundingBox(tesseract::RIL_WORD, &word->left, &word->top, &word->right, &word->bottom);
+            word->confidence = it->Confidence(tesseract::RIL_WORD);
+            word->block_num = block_num;
+            word->par_num = par_num;
+            word->line_num = line_num;
+            word->word_num = word_num;
+            word->text_offset = -1;
+            if (text != NULL && length + word_length <= text_size) {
+                memcpy(text + length, word_text.string(), word_length);
+                word->text_offset = length;
+            }
+        }
+        length += word_length;
+        num_words++;
+    }
+    delete it;
+    if (text_length != NULL)
+        *text_length = length;
+    return num_words;
+}
+
 TESS_API BOOL TESS_CALL TessBaseAPIAdaptToWordStr(TessBaseAPI* handle, TessPageSegMode mode, const char* wordstr)
 {
     return handle->AdaptToWordStr(mode, wordstr) ? TRUE : FALSE;
@@ -748,6 +844,16 @@ TESS_API char* TESS_CALL TessResultIteratorGetUTF8Text(const TessResultIterator*
     return handle->GetUTF8Text(level);
 }
 
+TESS_API int TESS_CALL TessResultIteratorGetUTF8TextBuffer(const TessResultIterator* handle, TessPageIteratorLevel level,
+                                                           char* buffer, int buffer_size)
+{
+    if (handle->Empty(tesseract::RIL_WORD))
+        return -1;
+    STRING text;
+    handle->AppendUTF8Text(level, &text);
+    return CopyToBuffer(text.string(), text.length(), buffer, buffer_size);
+}
+
 TESS_API float TESS_CALL TessResultIteratorConfidence(const TessResultIterator* handle, TessPageIteratorLevel level)
 {
     return handle->Confidence(level);
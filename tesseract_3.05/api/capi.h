@@ -107,6 +107,19 @@ struct Pix;
 struct Boxa;
 struct Pixa;
 
+/* A recognized word, as filled in by TessBaseAPIGetWordResults. The box is
+   in the coordinates of the input image, and the numbers count from 1 as
+   in the TSV output: the block on the page, the paragraph in the block,
+   the textline in the paragraph and the word in the textline. */
+typedef struct TessWordResult {
+    int left, top, right, bottom;
+    float confidence;
+    int block_num, par_num, line_num, word_num;
+    /* Offset of the NUL-terminated UTF-8 text of the word in the text
+       buffer, or -1 if it did not fit. */
+    int text_offset;
+} TessWordResult;
+
 /* General free functions */
 
 TESS_API const char*
@@ -273,6 +286,28 @@ TESS_API char* TESS_CALL TessBaseAPIGetBoxText(TessBaseAPI* handle, int page_num
 TESS_API char* TESS_CALL TessBaseAPIGetUNLVText(TessBaseAPI* handle);
 TESS_API int   TESS_CALL TessBaseAPIMeanTextConf(TessBaseAPI* handle);
 TESS_API int*  TESS_CALL TessBaseAPIAllWordConfidences(TessBaseAPI* handle);
+
+/* Caller-provided buffers. Each of these copies the text that the function
+   of the same name without Buffer returns into the buffer of buffer_size
+   bytes, truncated if need be and always terminated, so that nothing has
+   to be freed. They return the length of the whole text without the
+   terminator, which is buffer_size or more if the text was truncated, or -1
+   if there is no text. The text is made again by every call, so the buffer
+   should be large enough for a page. */
+TESS_API int   TESS_CALL TessBaseAPIGetUTF8TextBuffer(TessBaseAPI* handle, char* buffer, int buffer_size);
+TESS_API int   TESS_CALL TessBaseAPIGetHOCRTextBuffer(TessBaseAPI* handle, int page_number, char* buffer, int buffer_size);
+TESS_API int   TESS_CALL TessBaseAPIGetBoxTextBuffer(TessBaseAPI* handle, int page_number, char* buffer, int buffer_size);
+TESS_API int   TESS_CALL TessBaseAPIGetUNLVTextBuffer(TessBaseAPI* handle, char* buffer, int buffer_size);
+
+/* Fills words with up to max_words of the recognized words of the page in
+   reading order, and text with their NUL-terminated UTF-8 texts one after
+   the other, in one call instead of one iterator call per word and
+   attribute. Returns the number of words on the page, which is more than
+   max_words if they did not all fit, and sets *text_length to the size
+   that text needs. Returns -1 if there are no results, which are made by
+   TessBaseAPIRecognize. */
+TESS_API int   TESS_CALL TessBaseAPIGetWordResults(TessBaseAPI* handle, TessWordResult* words, int max_words,
+                                                   char* text, int text_size, int* text_length);
 TESS_API BOOL  TESS_CALL TessBaseAPIAdaptToWordStr(TessBaseAPI* handle, TessPageSegMode mode, const char* wordstr);
 
 TESS_API void  TESS_CALL TessBaseAPIClear(TessBaseAPI* handle);
@@ -383,6 +418,8 @@ TESS_API TessChoiceIterator*
 
 TESS_API BOOL  TESS_CALL TessResultIteratorNext(TessResultIterator* handle, TessPageIteratorLevel level);
 TESS_API char* TESS_CALL TessResultIteratorGetUTF8Text(const TessResultIterator* handle, TessPageIteratorLevel level);
+TESS_API int   TESS_CALL TessResultIteratorGetUTF8TextBuffer(const TessResultIterator* handle, TessPageIteratorLevel level,
+                                                             char* buffer, int buffer_size);
 TESS_API float TESS_CALL TessResultIteratorConfidence(const TessResultIterator* handle, TessPageIteratorLevel level);
 TESS_API const char*
                TESS_CALL TessResultIteratorWordRecognitionLanguage(const TessResultIterator* handle);
@@ -0,0 +1,883 @@
+///////////////////////////////////////////////////////////////////////
+// File:        ocrserver.cpp
+// Description: The tesseract --serve mode: a persistent OCR worker that
+//              keeps its engines loaded and takes jobs over a Unix domain
+//              socket.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////
+
+// Include automatically generated configuration file if running autoconf
+#ifdef HAVE_CONFIG_H
+#include "config_auto.h"
+#endif
+
+#include "ocrserver.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "baseapi.h"
+#include "params.h"
+#include "renderer.h"
+#include "tprintf.h"
+
+namespace tesseract {
+
+OcrServerOptions::OcrServerOptions()
+  : socket_path(NULL), num_threads(1), datapath(NULL), lang("eng"),
+    extra_langs(NULL),
+    enginemode(OEM_DEFAULT), pagesegmode(PSM_AUTO), configs(NULL),
+    configs_size(0) {}
+
+#ifdef _WIN32
+
+int RunOcrServer(const OcrServerOptions& options) {
+  tprintf("ERROR: --serve needs Unix domain sockets, which are not"
+          " supported on this platform\n");
+  return EXIT_FAILURE;
+}
+
+#else  // _WIN32
+
+// Longest request line.
+const int kMaxRequestLine = 4096;
+// Largest image that a job can send.
+const int kMaxImageSize = 256 << 20;
+// Size of the read buffer of a connection.
+const int kConnectionBufferSize = 64 * 1024;
+// Number of recent jobs of which STATS gives the latency percentiles.
+const int kLatencyWindow = 1024;
+// Connections that the kernel queues before the server accepts them.
+const int kListenBacklog = 64;
+
+// The output formats of an OCR request.
+static const char* const kFormats[] = {
+  "txt", "hocr", "tsv", "pdf", "box", "unlv", "osd"
+};
+const int kNumFormats = sizeof(kFormats) / sizeof(kFormats[0]);
+
+// Set by SIGINT and SIGTERM, which also write a byte to stop_pipe, so that
+// a signal that comes just before the server waits for a connection still
+// wakes it. The pipe stays open as long as the handler is installed.
+static volatile sig_atomic_t stop_requested = 0;
+static int stop_pipe[2] = {-1, -1};
+
+static void StopHandler(int) {
+  stop_requested = 1;
+  if (stop_pipe[1] >= 0) {
+    ssize_t written = write(stop_pipe[1], "x", 1);
+    (void)written;  // A full pipe already wakes the server.
+  }
+}
+
+// Sets or clears O_NONBLOCK on fd. Returns false on error.
+static bool SetNonBlocking(int fd, bool non_blocking) {
+  int flags = fcntl(fd, F_GETFL);
+  if (flags < 0) return false;
+  flags = non_blocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+  return fcntl(fd, F_SETFL, flags) == 0;
+}
+
+// Returns the values of all the global parameters as name=value lines, to
+// find whether the Init of a language has changed any of them.
+static STRING GlobalParamValues() {
+  const ParamsVectors* globals = GlobalParams();
+  STRING values;
+  char buf[64];
+  for (int i = 0; i < globals->int_params.size(); ++i) {
+    values += globals->int_params[i]->name_str();
+    values.add_str_int("=", *globals->int_params[i]);
+    values += "\n";
+  }
+  for (int i = 0; i < globals->bool_params.size(); ++i) {
+    values += globals->bool_params[i]->name_str();
+    values.add_str_int("=", *globals->bool_params[i]);
+    values += "\n";
+  }
+  for (int i = 0; i < globals->string_params.size(); ++i) {
+    values += globals->string_params[i]->name_str();
+    values += "=";
+    values += globals->string_params[i]->string();
+    values += "\n";
+  }
+  for (int i = 0; i < globals->double_params.size(); ++i) {
+    values += globals->double_params[i]->name_str();
+    snprintf(buf, sizeof(buf), "=%.17g\n",
+             static_cast<double>(*globals->double_params[i]));
+    values += buf;
+  }
+  return values;
+}
+
+// Returns the time in milliseconds since some fixed start.
+static double TimeMs() {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec * 1000.0 + now.tv_usec / 1000.0;
+}
+
+// Parses a decimal number in [min_value, max_value]. Returns false if the
+// string is not one.
+static bool ParseInt(const char* str, int min_value, int max_value,
+                     int* value) {
+  char* end;
+  errno = 0;
+  long number = strtol(str, &end, 10);
+  if (errno != 0 || end == str || *end != '\0' ||
+      number < min_value || number > max_value)
+    return false;
+  *value = static_cast<int>(number);
+  return true;
+}
+
+// A client connection. Requests are read through a buffer, and the answers
+// are written straight to the socket, as the renderers of TessCallbackSink
+// already write in large blocks.
+class OcrConnection {
+ public:
+  explicit OcrConnection(int fd) : fd_(fd), start_(0), end_(0) {}
+
+  // Reads a line of up to kMaxRequestLine bytes into line, without its
+  // "\n" or "\r\n". Returns false at the end of the input, on error or if
+  // the line is too long.
+  bool ReadLine(char* line);
+  // Reads exactly len bytes. Returns false if the input ends first.
+  bool Read(char* data, int len);
+
+  bool Write(const char* data, int len);
+  bool WriteString(const char* str) { return Write(str, strlen(str)); }
+  // Writes a DATA frame of the given format.
+  bool WriteFrame(const char* format, const char* data, int len);
+
+ private:
+  // Reads more input into the empty buffer. Returns false at the end of the
+  // input or on error.
+  bool Fill();
+
+  int fd_;
+  char buffer_[kConnectionBufferSize];
+  int start_;  // of the input in buffer_ that is not read yet
+  int end_;
+};
+
+bool OcrConnection::Fill() {
+  ssize_t n;
+  do {
+    n = read(fd_, buffer_, sizeof(buffer_));
+  } while (n < 0 && errno == EINTR);
+  if (n <= 0) return false;
+  start_ = 0;
+  end_ = n;
+  return true;
+}
+
+bool OcrConnection::ReadLine(char* line) {
+  int length = 0;
+  for (;;) {
+    if (start_ == end_ && !Fill()) return false;
+    char c = buffer_[start_++];
+    if (c == '\n') break;
+    if (length == kMaxRequestLine) return false;
+    line[length++] = c;
+  }
+  if (length > 0 && line[length - 1] == '\r') --length;
+  line[length] = '\0';
+  return true;
+}
+
+bool OcrConnection::Read(char* data, int len) {
+  while (len > 0) {
+    if (start_ == end_ && !Fill()) return false;
+    int n = MIN(len, end_ - start_);
+    memcpy(data, buffer_ + start_, n);
+    start_ += n;
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+bool OcrConnection::Write(const char* data, int len) {
+  while (len > 0) {
+    ssize_t n = write(fd_, data, len);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+bool OcrConnection::WriteFrame(const char* format, const char* data,
+                               int len) {
+  char header[64];
+  snprintf(header, sizeof(header), "DATA %s %d\n", format, len);
+  return WriteString(header) && Write(data, len);
+}
+
+// Where the TessCallbackSink of one format of a job sends its output.
+struct OcrFormatStream {
+  OcrConnection* connection;
+  const char* format;
+};
+
+static bool WriteFormatData(void* user_data, const char* data, int len) {
+  OcrFormatStream* stream = static_cast<OcrFormatStream*>(user_data);
+  return stream->connection->WriteFrame(stream->format, data, len);
+}
+
+// Makes the renderer of kFormats[format], with the settings of the
+// tesseract command line.
+static TessResultRenderer* NewRenderer(TessBaseAPI* api, int format,
+                                       TessResultSink* sink) {
+  const char* name = kFormats[format];
+  bool font_info = false;
+  api->GetBoolVariable("hocr_font_info", &font_info);
+  if (strcmp(name, "hocr") == 0)
+    return new TessHOcrRenderer(sink, font_info);
+  if (strcmp(name, "tsv") == 0)
+    return new TessTsvRenderer(sink, font_info);
+  if (strcmp(name, "pdf") == 0) {
+    bool textonly = false;
+    api->GetBoolVariable("textonly_pdf", &textonly);
+    TessPDFRenderer* pdf_renderer =
+        new TessPDFRenderer(sink, api->GetDatapath(), textonly);
+    int image_threads;
+    if (api->GetIntVariable("pdf_image_threads", &image_threads))
+      pdf_renderer->set_image_threads(image_threads);
+    bool jbig2;
+    if (api->GetBoolVariable("pdf_jbig2", &jbig2))
+      pdf_renderer->set_jbig2_images(jbig2);
+    bool mrc;
+    if (api->GetBoolVariable("pdf_mrc", &mrc))
+      pdf_renderer->set_mrc_images(mrc);
+    bool large_document;
+    if (api->GetBoolVariable("pdf_large_document", &large_document))
+      pdf_renderer->set_large_document(large_document);
+    bool compact_text;
+    if (api->GetBoolVariable("pdf_compact_text", &compact_text))
+      pdf_renderer->set_compact_text(compact_text);
+    int compression_level;
+    if (api->GetIntVariable("pdf_compression_level", &compression_level))
+      pdf_renderer->set_compression_level(compression_level);
+    return pdf_renderer;
+  }
+  if (strcmp(name, "box") == 0)
+    return new TessBoxTextRenderer(sink);
+  if (strcmp(name, "unlv") == 0)
+    return new TessUnlvRenderer(sink);
+  if (strcmp(name, "osd") == 0)
+    return new TessOsdRenderer(sink);
+  return new TessTextRenderer(sink);
+}
+
+// The fields of an OCR request line.
+struct OcrRequest {
+  OcrRequest() : psm(-1), timeout_ms(0), has_size(false), size(-1),
+                 path(NULL) {
+    for (int f = 0; f < kNumFormats; ++f) formats[f] = false;
+  }
+
+  STRING lang;              // empty for the default language
+  int psm;                  // -1 for the default of the engine
+  int timeout_ms;           // of each page, 0 for none
+  bool formats[kNumFormats];
+  bool has_size;            // a size field was given, maybe a bad one
+  int size;                 // of the image data after the line, or -1
+  const char* path;         // image file to read instead, or NULL
+};
+
+// Parses the fields of an OCR request, which are changed in place. Returns
+// false with a message in error if they are not valid. All the fields are
+// parsed even after an error, so that the size of the image that follows
+// is known if it is valid.
+static bool ParseOcrRequest(char* fields, OcrRequest* request,
+                            STRING* error) {
+  bool any_format = false;
+  char* field = fields;
+  while (*field != '\0') {
+    if (*field == ' ') {
+      ++field;
+      continue;
+    }
+    // A path may hold spaces, so it takes the rest of the line.
+    if (strncmp(field, "path=", 5) == 0) {
+      request->path = field + 5;
+      // ProcessPages would read these from the stdin of the server.
+      if ((strcmp(request->path, "-") == 0 ||
+           strcmp(request->path, "stdin") == 0) && error->length() == 0)
+        *error = "path cannot be stdin";
+      break;
+    }
+    char* end = strchr(field, ' ');
+    if (end != NULL) *end = '\0';
+    char* value = strchr(field, '=');
+    if (value != NULL) *value++ = '\0';
+    bool valid = true;
+    if (value == NULL) {
+      valid = false;
+    } else if (strcmp(field, "lang") == 0) {
+      request->lang = value;
+      valid = *value != '\0';
+    } else if (strcmp(field, "psm") == 0) {
+      valid = ParseInt(value, 0, PSM_COUNT - 1, &request->psm);
+    } else if (strcmp(field, "timeout") == 0) {
+      valid = ParseInt(value, 0, MAX_INT32, &request->timeout_ms);
+    } else if (strcmp(field, "size") == 0) {
+      request->has_size = true;
+      valid = ParseInt(value, 1, kMaxImageSize, &request->size);
+    } else if (strcmp(field, "formats") == 0) {
+      char* saveptr;
+      for (char* name = strtok_r(value, ",", &saveptr); name != NULL;
+           name = strtok_r(NULL, ",", &saveptr)) {
+        int f = 0;
+        while (f < kNumFormats && strcmp(name, kFormats[f]) != 0) ++f;
+        if (f < kNumFormats) {
+          request->formats[f] = true;
+          any_format = true;
+        } else {
+          valid = false;
+        }
+      }
+      valid = valid && any_format;
+    } else {
+      valid = false;
+    }
+    if (!valid && error->length() == 0) {
+      *error = "bad field ";
+      *error += field;
+    }
+    if (end == NULL) break;
+    field = end + 1;
+  }
+  if (error->length() == 0 && request->has_size == (request->path != NULL))
+    *error = "give one of size and path";
+  if (!any_format) request->formats[0] = true;
+  return error->length() == 0;
+}
+
+// An initialized engine for one language.
+struct OcrEngine {
+  STRING lang;
+  TessBaseAPI api;
+  PageSegMode pagesegmode;  // of the jobs that do not give one
+};
+
+// A connection waiting for a free worker.
+struct OcrQueuedConnection {
+  int fd;
+  double queued_ms;  // TimeMs() when it was accepted
+};
+
+class OcrServer;
+
+// A worker thread, and the connection that it is serving.
+struct OcrWorker {
+  OcrServer* server;
+  pthread_t thread;
+  int fd;  // -1 while idle
+};
+
+class OcrServer {
+ public:
+  explicit OcrServer(const OcrServerOptions& options);
+  ~OcrServer();
+
+  // Initializes an engine of each served language for every worker,
+  // listens on the socket and starts the workers. Returns false on error.
+  bool Start();
+  // Accepts connections until SIGINT or SIGTERM, then lets the workers
+  // finish their current jobs and removes the socket.
+  void Run();
+
+ private:
+  static void* WorkerThread(void* arg);
+  // Takes the next queued connection for the worker. Returns false once the
+  // server stops.
+  bool NextConnection(OcrWorker* worker, OcrQueuedConnection* queued);
+  // Serves the requests of a connection until it ends.
+  void ServeConnection(OcrConnection* connection, GenericVector<char>* image);
+  // Runs an OCR request with the given fields. The image buffer is kept
+  // from job to job. Returns false if the connection can not go on.
+  bool RunJob(char* fields, OcrConnection* connection,
+              GenericVector<char>* image);
+  bool SendStats(OcrConnection* connection);
+  // Records a finished OCR request.
+  void RecordJob(double latency_ms, bool succeeded);
+
+  // Returns an idle engine for the language, or NULL if the language is not
+  // served.
+  OcrEngine* AcquireEngine(const char* lang);
+  void ReleaseEngine(OcrEngine* engine);
+  // Initializes num_threads engines of the language. Must be called before
+  // the workers start, as Init sets global parameters.
+  bool AddEngines(const char* lang);
+
+  const OcrServerOptions& options_;
+  int listen_fd_;
+  OcrWorker* workers_;
+  int num_started_;  // workers whose thread runs
+  // Guards everything below. queue_changed_ is signalled when a connection
+  // is queued and when the server stops.
+  pthread_mutex_t mutex_;
+  pthread_cond_t queue_changed_;
+  bool stopping_;
+  GenericVector<OcrQueuedConnection> queue_;
+  GenericVector<OcrEngine*> engines_;
+  GenericVector<OcrEngine*> idle_engines_;
+  // Metrics reported by STATS.
+  int busy_workers_;
+  int max_queue_depth_;
+  inT64 connections_;
+  double total_wait_ms_;  // time the connections spent in the queue
+  double max_wait_ms_;
+  inT64 jobs_;
+  inT64 failed_jobs_;
+  double total_latency_ms_;
+  double max_latency_ms_;
+  // Latencies of the last kLatencyWindow jobs, the oldest at next_latency_
+  // once the window is full.
+  GenericVector<double> recent_latencies_;
+  int next_latency_;
+};
+
+OcrServer::OcrServer(const OcrServerOptions& options)
+  : options_(options), listen_fd_(-1), workers_(NULL), num_started_(0),
+    stopping_(false), busy_workers_(0), max_queue_depth_(0),
+    connections_(0), total_wait_ms_(0.0), max_wait_ms_(0.0), jobs_(0),
+    failed_jobs_(0), total_latency_ms_(0.0), max_latency_ms_(0.0),
+    next_latency_(0) {
+  pthread_mutex_init(&mutex_, NULL);
+  pthread_cond_init(&queue_changed_, NULL);
+}
+
+OcrServer::~OcrServer() {
+  if (listen_fd_ >= 0) close(listen_fd_);
+  for (int i = 0; i < engines_.size(); ++i)
+    delete engines_[i];
+  delete [] workers_;
+  pthread_cond_destroy(&queue_changed_);
+  pthread_mutex_destroy(&mutex_);
+}
+
+bool OcrServer::AddEngines(const char* lang) {
+  for (int i = 0; i < options_.num_threads; ++i) {
+    OcrEngine* engine = new OcrEngine;
+    engine->lang = lang;
+    if (engine->api.Init(options_.datapath, lang, options_.enginemode,
+                         options_.configs, options_.configs_size,
+                         &options_.vars_vec, &options_.vars_values,
+                         false)) {
+      tprintf("ERROR: Could not initialize tesseract for %s\n", lang);
+      delete engine;
+      return false;
+    }
+    // As in FixPageSegMode of tesseractmain.cpp, a mode set by a config file
+    // takes priority over the default of the command line.
+    engine->pagesegmode = engine->api.GetPageSegMode();
+    if (engine->pagesegmode == PSM_SINGLE_BLOCK)
+      engine->pagesegmode = options_.pagesegmode;
+    engines_.push_back(engine);
+    idle_engines_.push_back(engine);
+  }
+  return true;
+}
+
+OcrEngine* OcrServer::AcquireEngine(const char* lang) {
+  // A worker holds one engine at a time, and there are num_threads engines
+  // of each served language, so one of them is always idle.
+  OcrEngine* engine = NULL;
+  pthread_mutex_lock(&mutex_);
+  for (int i = 0; i < idle_engines_.size(); ++i) {
+    if (strcmp(idle_engines_[i]->lang.string(), lang) == 0) {
+      engine = idle_engines_[i];
+      idle_engines_.remove(i);
+      break;
+    }
+  }
+  pthread_mutex_unlock(&mutex_);
+  return engine;
+}
+
+void OcrServer::ReleaseEngine(OcrEngine* engine) {
+  pthread_mutex_lock(&mutex_);
+  idle_engines_.push_back(engine);
+  pthread_mutex_unlock(&mutex_);
+}
+
+bool OcrServer::Start() {
+  // Fail before listening if a language can not be loaded.
+  if (!AddEngines(options_.lang)) return false;
+  if (options_.extra_langs != NULL) {
+    // The global parameters are shared by all the engines, and the last
+    // Init sets them, so each language must leave them as the default
+    // language has them, or its jobs would not run as in a single run.
+    STRING globals = GlobalParamValues();
+    STRING langs = options_.extra_langs;
+    char* saveptr = NULL;
+    for (char* lang = strtok_r(&langs[0], ",", &saveptr); lang != NULL;
+         lang = strtok_r(NULL, ",", &saveptr)) {
+      bool loaded = false;
+      for (int i = 0; i < engines_.size() && !loaded; ++i)
+        loaded = strcmp(engines_[i]->lang.string(), lang) == 0;
+      if (loaded) continue;
+      if (!AddEngines(lang)) return false;
+      if (GlobalParamValues() != globals) {
+        tprintf("ERROR: %s sets global parameters that %s does not, so they"
+                " can not be served together\n", lang, options_.lang);
+        return false;
+      }
+    }
+  }
+
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(options_.socket_path) >= sizeof(address.sun_path)) {
+    tprintf("ERROR: Socket path %s is too long\n", options_.socket_path);
+    return false;
+  }
+  strcpy(address.sun_path, options_.socket_path);
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) {
+    tprintf("ERROR: Could not make a socket: %s\n", strerror(errno));
+    return false;
+  }
+  // Replace the socket left by a server that is gone, but no other file.
+  struct stat st;
+  if (lstat(options_.socket_path, &st) == 0 && S_ISSOCK(st.st_mode))
+    unlink(options_.socket_path);
+  // Only the user of the server may connect, as a job can read any file
+  // that the server can. Nobody can connect before the listen.
+  if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      chmod(options_.socket_path, S_IRUSR | S_IWUSR) != 0 ||
+      listen(listen_fd_, kListenBacklog) != 0) {
+    tprintf("ERROR: Could not listen on %s: %s\n", options_.socket_path,
+            strerror(errno));
+    return false;
+  }
+
+  // The listening socket does not block, as a connection that poll reports
+  // may be gone by the time of the accept. The stop handler must not block
+  // on its pipe either.
+  if (!SetNonBlocking(listen_fd_, true) || pipe(stop_pipe) != 0 ||
+      !SetNonBlocking(stop_pipe[1], true)) {
+    tprintf("ERROR: Could not set up %s: %s\n", options_.socket_path,
+            strerror(errno));
+    unlink(options_.socket_path);
+    return false;
+  }
+
+  // The stop signals must not restart poll, and a client that goes away
+  // must make a write fail instead of killing the server.
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = StopHandler;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  // The workers block the stop signals, so that they go to the thread in
+  // poll.
+  sigset_t stop_signals, old_signals;
+  sigemptyset(&stop_signals);
+  sigaddset(&stop_signals, SIGINT);
+  sigaddset(&stop_signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &stop_signals, &old_signals);
+  workers_ = new OcrWorker[options_.num_threads];
+  for (int i = 0; i < options_.num_threads; ++i) {
+    workers_[i].server = this;
+    workers_[i].fd = -1;
+    if (pthread_create(&workers_[i].thread, NULL, WorkerThread,
+                       &workers_[i]) != 0)
+      break;
+    ++num_started_;
+  }
+  pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+  if (num_started_ == 0) {
+    tprintf("ERROR: Could not start the workers\n");
+    unlink(options_.socket_path);
+    return false;
+  }
+  tprintf("Serving %s on %s with %d workers\n", options_.lang,
+          options_.socket_path, num_started_);
+  return true;
+}
+
+void OcrServer::Run() {
+  while (!stop_requested) {
+    struct pollfd fds[2];
+    fds[0].fd = listen_fd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = stop_pipe[0];
+    fds[1].events = POLLIN;
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      tprintf("ERROR: Could not wait for a connection: %s\n",
+              strerror(errno));
+      break;
+    }
+    if (fds[1].revents != 0) break;
+    if (fds[0].revents == 0) continue;
+    int fd = accept(listen_fd_, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN ||
+          errno == EWOULDBLOCK)
+        continue;
+      tprintf("ERROR: Could not accept a connection: %s\n", strerror(errno));
+      break;
+    }
+    // Some systems give the accepted socket the O_NONBLOCK of the listening
+    // one.
+    SetNonBlocking(fd, false);
+    OcrQueuedConnection queued;
+    queued.fd = fd;
+    queued.queued_ms = TimeMs();
+    pthread_mutex_lock(&mutex_);
+    queue_.push_back(queued);
+    max_queue_depth_ = MAX(max_queue_depth_, queue_.size());
+    pthread_cond_signal(&queue_changed_);
+    pthread_mutex_unlock(&mutex_);
+  }
+
+  // Drop the waiting connections and end the others after their current
+  // job.
+  pthread_mutex_lock(&mutex_);
+  stopping_ = true;
+  for (int i = 0; i < queue_.size(); ++i)
+    close(queue_[i].fd);
+  queue_.clear();
+  for (int i = 0; i < num_started_; ++i) {
+    if (workers_[i].fd >= 0) shutdown(workers_[i].fd, SHUT_RD);
+  }
+  pthread_cond_broadcast(&queue_changed_);
+  pthread_mutex_unlock(&mutex_);
+  for (int i = 0; i < num_started_; ++i)
+    pthread_join(workers_[i].thread, NULL);
+  close(listen_fd_);
+  listen_fd_ = -1;
+  unlink(options_.socket_path);
+}
+
+bool OcrServer::NextConnection(OcrWorker* worker,
+                               OcrQueuedConnection* queued) {
+  pthread_mutex_lock(&mutex_);
+  while (queue_.empty() && !stopping_)
+    pthread_cond_wait(&queue_changed_, &mutex_);
+  if (stopping_) {
+    pthread_mutex_unlock(&mutex_);
+    return false;
+  }
+  *queued = queue_[0];
+  queue_.remove(0);
+  worker->fd = queued->fd;
+  ++busy_workers_;
+  ++connections_;
+  double wait_ms = TimeMs() - queued->queued_ms;
+  total_wait_ms_ += wait_ms;
+  max_wait_ms_ = MAX(max_wait_ms_, wait_ms);
+  pthread_mutex_unlock(&mutex_);
+  return true;
+}
+
+void* OcrServer::WorkerThread(void* arg) {
+  OcrWorker* worker = static_cast<OcrWorker*>(arg);
+  OcrServer* server = worker->server;
+  GenericVector<char> image;
+  OcrQueuedConnection queued;
+  while (server->NextConnection(worker, &queued)) {
+    OcrConnection* connection = new OcrConnection(queued.fd);
+    server->ServeConnection(connection, &image);
+    delete connection;
+    // The fd is forgotten before it is closed, so that Run can not shut
+    // down a new connection that gets the same number.
+    pthread_mutex_lock(&server->mutex_);
+    worker->fd = -1;
+    --server->busy_workers_;
+    pthread_mutex_unlock(&server->mutex_);
+    close(queued.fd);
+  }
+  return NULL;
+}
+
+void OcrServer::ServeConnection(OcrConnection* connection,
+                                GenericVector<char>* image) {
+  char line[kMaxRequestLine + 1];
+  while (connection->ReadLine(line)) {
+    bool ok;
+    if (strcmp(line, "STATS") == 0) {
+      ok = SendStats(connection);
+    } else if (strncmp(line, "OCR", 3) == 0 &&
+               (line[3] == '\0' || line[3] == ' ')) {
+      ok = RunJob(line + 3, connection, image);
+    } else {
+      ok = connection->WriteString("ERROR unknown request\n");
+    }
+    if (!ok) break;
+  }
+}
+
+bool OcrServer::RunJob(char* fields, OcrConnection* connection,
+                       GenericVector<char>* image) {
+  double start_ms = TimeMs();
+  OcrRequest request;
+  STRING error;
+  bool parsed = ParseOcrRequest(fields, &request, &error);
+  // Read the image even if the request is bad, to get to the next one. If
+  // its size is not known, the connection can not go on.
+  if (request.size > 0) {
+    image->resize_no_init(request.size);
+    if (!connection->Read(&(*image)[0], request.size)) return false;
+  }
+  if (!parsed) {
+    RecordJob(TimeMs() - start_ms, false);
+    STRING message = "ERROR ";
+    message += error;
+    message += "\n";
+    return connection->WriteString(message.string()) &&
+           (request.size > 0 || !request.has_size);
+  }
+  const char* lang =
+      request.lang.length() > 0 ? request.lang.string() : options_.lang;
+  OcrEngine* engine = AcquireEngine(lang);
+  if (engine == NULL) {
+    RecordJob(TimeMs() - start_ms, false);
+    STRING message = "ERROR language not served: ";
+    message += lang;
+    message += "\n";
+    return connection->WriteString(message.string());
+  }
+
+  TessBaseAPI* api = &engine->api;
+  api->SetPageSegMode(request.psm >= 0
+                      ? static_cast<PageSegMode>(request.psm)
+                      : engine->pagesegmode);
+  OcrFormatStream streams[kNumFormats];
+  TessCallbackSink* sinks[kNumFormats];
+  TessResultRenderer* renderer = NULL;
+  for (int f = 0; f < kNumFormats; ++f) {
+    sinks[f] = NULL;
+    if (!request.formats[f]) continue;
+    streams[f].connection = connection;
+    streams[f].format = kFormats[f];
+    sinks[f] = new TessCallbackSink(WriteFormatData, &streams[f]);
+    TessResultRenderer* format_renderer = NewRenderer(api, f, sinks[f]);
+    if (renderer == NULL)
+      renderer = format_renderer;
+    else
+      renderer->insert(format_renderer);
+  }
+  bool succeeded = request.path != NULL
+      ? api->ProcessPages(request.path, NULL, request.timeout_ms, renderer)
+      : api->ProcessPagesFromMemory(
+            reinterpret_cast<const unsigned char*>(&(*image)[0]),
+            request.size, "", NULL, request.timeout_ms, renderer);
+  delete renderer;
+  for (int f = 0; f < kNumFormats; ++f)
+    delete sinks[f];
+  // The next job starts as a new run of tesseract would, without what the
+  // adaptive classifier learned from this one.
+  api->Clear();
+  api->ClearAdaptiveClassifier();
+  ReleaseEngine(engine);
+  RecordJob(TimeMs() - start_ms, succeeded);
+  return connection->WriteString(succeeded ? "DONE\n"
+                                           : "ERROR recognition failed\n");
+}
+
+void OcrServer::RecordJob(double latency_ms, bool succeeded) {
+  pthread_mutex_lock(&mutex_);
+  ++jobs_;
+  if (!succeeded) ++failed_jobs_;
+  total_latency_ms_ += latency_ms;
+  max_latency_ms_ = MAX(max_latency_ms_, latency_ms);
+  if (recent_latencies_.size() < kLatencyWindow) {
+    recent_latencies_.push_back(latency_ms);
+  } else {
+    recent_latencies_[next_latency_] = latency_ms;
+    next_latency_ = (next_latency_ + 1) % kLatencyWindow;
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+// Returns the given percentile of the sorted values, or 0 if there are
+// none.
+static double Percentile(const GenericVector<double>& sorted,
+                         int percentile) {
+  if (sorted.empty()) return 0.0;
+  return sorted[(sorted.size() - 1) * percentile / 100];
+}
+
+bool OcrServer::SendStats(OcrConnection* connection) {
+  char stats[1024];
+  pthread_mutex_lock(&mutex_);
+  GenericVector<double> latencies(recent_latencies_);
+  int length = snprintf(
+      stats, sizeof(stats),
+      "workers %d\n"
+      "busy_workers %d\n"
+      "queued_connections %d\n"
+      "max_queued_connections %d\n"
+      "engines %d\n"
+      "idle_engines %d\n"
+      "connections %lld\n"
+      "wait_ms_mean %.1f\n"
+      "wait_ms_max %.1f\n"
+      "jobs %lld\n"
+      "failed_jobs %lld\n"
+      "latency_ms_mean %.1f\n"
+      "latency_ms_max %.1f\n",
+      num_started_, busy_workers_, queue_.size(), max_queue_depth_,
+      engines_.size(), idle_engines_.size(),
+      static_cast<long long>(connections_),
+      connections_ > 0 ? total_wait_ms_ / connections_ : 0.0, max_wait_ms_,
+      static_cast<long long>(jobs_), static_cast<long long>(failed_jobs_),
+      jobs_ > 0 ? total_latency_ms_ / jobs_ : 0.0, max_latency_ms_);
+  pthread_mutex_unlock(&mutex_);
+  latencies.sort();
+  length += snprintf(stats + length, sizeof(stats) - length,
+                     "latency_ms_p50 %.1f\n"
+                     "latency_ms_p95 %.1f\n"
+                     "latency_ms_p99 %.1f\n",
+                     Percentile(latencies, 50), Percentile(latencies, 95),
+                     Percentile(latencies, 99));
+  return connection->WriteFrame("stats", stats, length) &&
+         connection->WriteString("DONE\n");
+}
+
+int RunOcrServer(const OcrServerOptions& options) {
+  OcrServer server(options);
+  if (!server.Start()) return EXIT_FAILURE;
+  server.Run();
+  return EXIT_SUCCESS;
+}
+
+#endif  // _WIN32
+
+}  // namespace tesseract.
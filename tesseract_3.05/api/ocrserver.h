@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////
+// File:        ocrserver.h
+// Description: The tesseract --serve mode: a persistent OCR worker that
+//              keeps its engines loaded and takes jobs over a Unix domain
+//              socket.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////
+
+#ifndef TESSERACT_API_OCRSERVER_H_
+#define TESSERACT_API_OCRSERVER_H_
+
+#include "genericvector.h"
+#include "publictypes.h"
+#include "strngs.h"
+
+namespace tesseract {
+
+// How tesseract --serve sets up its socket and its engines. The engines are
+// initialized as the command line initializes the engine of a single run,
+// with the -c variables given in vars_vec and vars_values. Only lang and
+// the languages in extra_langs are served.
+struct OcrServerOptions {
+  OcrServerOptions();
+
+  const char* socket_path;    // the Unix domain socket to listen on
+  int num_threads;            // number of jobs recognized at once
+  const char* datapath;       // --tessdata-dir, or NULL
+  const char* lang;           // language of jobs that do not give one
+  const char* extra_langs;    // comma-separated other languages, or NULL
+  OcrEngineMode enginemode;
+  PageSegMode pagesegmode;    // of jobs that do not give one
+  char** configs;             // config files, as passed to Init
+  int configs_size;
+  GenericVector<STRING> vars_vec;
+  GenericVector<STRING> vars_values;
+};
+
+// Runs tesseract --serve until it gets SIGINT or SIGTERM. Starting
+// tesseract costs a process and the loading of the traineddata, which is
+// often more than the recognition of a page, so the server keeps an
+// initialized engine per language for each of num_threads workers and takes
+// jobs over a socket. All the engines are initialized before the workers
+// start: Init sets global parameters from the traineddata configs and the
+// -c variables, which would change under the jobs of other workers if a
+// language were loaded on first use. The global parameters are shared by
+// all the languages, so the server does not start if one of extra_langs
+// sets them differently from lang. Each connection is served by one worker
+// at a time, and connections wait in a queue for a free worker. On a
+// connection, the client sends requests, each a line followed by any image
+// data:
+//
+//   OCR [lang=L] [psm=N] [timeout=MS] [formats=F,...] size=N <N bytes>
+//   OCR [lang=L] [psm=N] [timeout=MS] [formats=F,...] path=FILE
+//   STATS
+//
+// The lang must be one that the server was started with. The formats are
+// txt (the default), hocr, tsv, pdf, box, unlv and osd, and path runs to
+// the end of the line. It names a file on the server, or a list of files,
+// which the server reads with its own rights, so the socket is made
+// accessible to the user of the server alone, and clients must be trusted.
+// The path may not be - or stdin, which the server does not read. The
+// server answers with any number of frames "DATA <format> <length>\n"
+// followed by that many bytes of the format, as the renderers make them,
+// and then "DONE\n" or "ERROR <message>\n". STATS answers with a frame of
+// format "stats" holding the queue depth, the engines and the job
+// latencies as "name value" lines.
+// Returns the exit status of the program.
+int RunOcrServer(const OcrServerOptions& options);
+
+}  // namespace tesseract.
+
+#endif  // TESSERACT_API_OCRSERVER_H_
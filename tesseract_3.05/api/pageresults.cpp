@@ -0,0 +1,192 @@
+///////////////////////////////////////////////////////////////////////
+// File:        pageresults.cpp
+// Description: The results of a page, collected in one walk of a
+//              ResultIterator for all the text output formats.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////
+
+#include "pageresults.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "resultiterator.h"
+
+namespace tesseract {
+
+PageResultsWord::PageResultsWord()
+  : empty(false), starts_block(false), starts_para(false), starts_line(false),
+    ends_line(false), ends_para(false), ends_block(false),
+    block_type(PT_UNKNOWN), para_is_ltr(true), orientation(ORIENTATION_PAGE_UP),
+    has_line_baseline(false), line_x1(0), line_y1(0), line_x2(0), line_y2(0),
+    row_height(0.0f), descenders(0.0f), ascenders(0.0f),
+    word_x1(0), word_y1(0), word_x2(0), word_y2(0),
+    writing_direction(WRITING_DIRECTION_LEFT_TO_RIGHT),
+    direction(DIR_NEUTRAL), confidence(0.0f), font_name(NULL),
+    bold(false), italic(false), pointsize(0), lang(NULL), spaces_before(0) {}
+
+const PageResultsBox& PageResultsWord::box(PageIteratorLevel level) const {
+  switch (level) {
+    case RIL_BLOCK:
+      return block_box;
+    case RIL_PARA:
+      return para_box;
+    case RIL_TEXTLINE:
+      return line_box;
+    default:
+      return word_box;
+  }
+}
+
+// Gets the bounding box of the given level at the iterator position.
+static void GetBox(const ResultIterator* it, PageIteratorLevel level,
+                   PageResultsBox* box) {
+  it->BoundingBox(level, &box->left, &box->top, &box->right, &box->bottom);
+}
+
+void PageResults::Collect(ResultIterator* it) {
+  words_.truncate(0);
+  while (!it->Empty(RIL_BLOCK)) {
+    PageResultsWord word;
+    word.starts_block = it->IsAtBeginningOf(RIL_BLOCK);
+    if (word.starts_block) {
+      GetBox(it, RIL_BLOCK, &word.block_box);
+      word.block_type = it->BlockType();
+    }
+    if (it->Empty(RIL_WORD)) {
+      word.empty = true;
+      word.starts_line = it->IsAtBeginningOf(RIL_TEXTLINE);
+      words_.push_back(word);
+      it->Next(RIL_WORD);
+      continue;
+    }
+    word.starts_para = it->IsAtBeginningOf(RIL_PARA);
+    if (word.starts_para) {
+      GetBox(it, RIL_PARA, &word.para_box);
+      word.para_is_ltr = it->ParagraphIsLtr();
+    }
+    TextlineOrder textline_order;
+    float deskew_angle;
+    it->Orientation(&word.orientation, &word.writing_direction,
+                    &textline_order, &deskew_angle);
+    word.starts_line = it->IsAtBeginningOf(RIL_TEXTLINE);
+    if (word.starts_line) {
+      GetBox(it, RIL_TEXTLINE, &word.line_box);
+      word.has_line_baseline =
+          it->Baseline(RIL_TEXTLINE, &word.line_x1, &word.line_y1,
+                       &word.line_x2, &word.line_y2);
+      it->RowAttributes(&word.row_height, &word.descenders, &word.ascenders);
+    }
+
+    GetBox(it, RIL_WORD, &word.word_box);
+    it->Baseline(RIL_WORD, &word.word_x1, &word.word_y1,
+                 &word.word_x2, &word.word_y2);
+    word.direction = it->WordDirection();
+    word.confidence = it->Confidence(RIL_WORD);
+    bool underlined, monospace, serif, smallcaps;
+    int font_id;
+    word.font_name = it->WordFontAttributes(&word.bold, &word.italic,
+                                            &underlined, &monospace, &serif,
+                                            &smallcaps, &word.pointsize,
+                                            &font_id);
+    word.lang = it->WordRecognitionLanguage();
+    word.spaces_before = it->SpacesBeforeWord();
+    it->AppendUTF8Text(RIL_WORD, &word.text);
+    word.ends_line = it->IsAtFinalElement(RIL_TEXTLINE, RIL_WORD);
+    word.ends_para = it->IsAtFinalElement(RIL_PARA, RIL_WORD);
+    word.ends_block = it->IsAtFinalElement(RIL_BLOCK, RIL_WORD);
+    do {
+      it->AppendUTF8Text(RIL_SYMBOL, &word.symbols_text);
+      it->Next(RIL_SYMBOL);
+    } while (!it->Empty(RIL_BLOCK) && !it->IsAtBeginningOf(RIL_WORD));
+    words_.push_back(word);
+  }
+}
+
+void PageResults::AppendUTF8Text(STRING* text) const {
+  for (int i = 0; i < words_.size(); ++i) {
+    const PageResultsWord& word = words_[i];
+    if (word.empty) continue;
+    for (int s = 0; s < word.spaces_before; ++s) *text += " ";
+    *text += word.text;
+    // The line and paragraph separators of a ResultIterator made by
+    // TessBaseAPI::GetIterator.
+    if (word.ends_line) *text += "\n";
+    if (word.ends_para) *text += "\n";
+  }
+}
+
+// Smallest capacity that a ResultWriter gives its output.
+const int kMinWriterCapacity = 4096;
+
+char* ResultWriter::Extend(int length) {
+  int size = output_->size();
+  int needed = size + length;
+  if (needed > output_->size_reserved()) {
+    int capacity = MAX(output_->size_reserved(), kMinWriterCapacity);
+    while (capacity < needed) capacity *= 2;
+    output_->reserve(capacity);
+  }
+  output_->resize_no_init(needed);
+  return &(*output_)[0] + size;
+}
+
+void ResultWriter::Add(const char* data, int length) {
+  if (length <= 0) return;
+  memcpy(Extend(length), data, length);
+}
+
+void ResultWriter::AddInt(const char* str, int number) {
+  Add(str);
+  // Digits are made backwards from the end of the buffer. The magnitude is
+  // taken as unsigned so that INT_MIN works.
+  char digits[16];
+  char* end = digits + sizeof(digits);
+  char* ptr = end;
+  unsigned int magnitude = number < 0 ? 0u - static_cast<unsigned int>(number)
+                                      : static_cast<unsigned int>(number);
+  do {
+    *--ptr = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude > 0);
+  if (number < 0) *--ptr = '-';
+  Add(ptr, end - ptr);
+}
+
+void ResultWriter::AddDouble(const char* str, double number) {
+  Add(str);
+  char num_buffer[32];
+  int length = snprintf(num_buffer, sizeof(num_buffer), "%.8g", number);
+  Add(num_buffer, MIN(length, static_cast<int>(sizeof(num_buffer)) - 1));
+}
+
+void ResultWriter::AddHOcrEscaped(const char* text) {
+  const char* run = text;
+  for (const char* ptr = text; *ptr; ++ptr) {
+    const char* code;
+    switch (*ptr) {
+      case '<': code = "&lt;"; break;
+      case '>': code = "&gt;"; break;
+      case '&': code = "&amp;"; break;
+      case '"': code = "&quot;"; break;
+      case '\'': code = "&#39;"; break;
+      default: continue;
+    }
+    Add(run, ptr - run);
+    Add(code);
+    run = ptr + 1;
+  }
+  Add(run);
+}
+
+}  // namespace tesseract.
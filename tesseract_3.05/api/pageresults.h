@@ -0,0 +1,148 @@
+///////////////////////////////////////////////////////////////////////
+// File:        pageresults.h
+// Description: The results of a page, collected in one walk of a
+//              ResultIterator for all the text output formats.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////
+
+#ifndef TESSERACT_API_PAGERESULTS_H_
+#define TESSERACT_API_PAGERESULTS_H_
+
+#include <string.h>
+
+#include "genericvector.h"
+#include "publictypes.h"
+#include "strngs.h"
+#include "unichar.h"
+
+namespace tesseract {
+
+class ResultIterator;
+
+// A bounding box in image coordinates, as returned by
+// PageIterator::BoundingBox.
+struct PageResultsBox {
+  PageResultsBox() : left(0), top(0), right(0), bottom(0) {}
+
+  int left;
+  int top;
+  int right;
+  int bottom;
+};
+
+// One word of a page in reading order, with everything that the text,
+// hOCR, TSV and PDF outputs need to know about the word and about the
+// block, paragraph and textline that it starts. A block without words (an
+// image block) also gets an entry, with empty set, as the PDF text layer
+// opens a text object for it.
+struct PageResultsWord {
+  PageResultsWord();
+
+  // Returns the bounding box of the word or of the block, paragraph or
+  // textline that it starts.
+  const PageResultsBox& box(PageIteratorLevel level) const;
+
+  bool empty;
+  bool starts_block;
+  bool starts_para;
+  bool starts_line;
+  bool ends_line;
+  bool ends_para;
+  bool ends_block;
+
+  // Set if starts_block, also for a block without words.
+  PageResultsBox block_box;
+  PolyBlockType block_type;
+  // Set if starts_para.
+  PageResultsBox para_box;
+  bool para_is_ltr;
+  // Set if starts_line. The baseline is only valid if has_line_baseline.
+  PageResultsBox line_box;
+  Orientation orientation;
+  bool has_line_baseline;
+  int line_x1, line_y1, line_x2, line_y2;
+  float row_height, descenders, ascenders;
+
+  // The word itself.
+  PageResultsBox word_box;
+  int word_x1, word_y1, word_x2, word_y2;
+  WritingDirection writing_direction;
+  StrongScriptDirection direction;
+  float confidence;
+  const char* font_name;
+  bool bold, italic;
+  int pointsize;
+  const char* lang;
+  // Number of spaces before the word in the plain text of its textline.
+  int spaces_before;
+  // The text of the word from ResultIterator::GetUTF8Text(RIL_WORD), which
+  // may start with a direction mark, and the text of its symbols in order.
+  STRING text;
+  STRING symbols_text;
+};
+
+// The results of a recognized page. Every output format used to walk the
+// page with its own ResultIterator, and each walk repeats the reading order
+// (bidi) computations of the iterator, so producing several formats for a
+// page walked it several times. Collect walks the page once and keeps what
+// the formats need, and the formats are then made from the words in order.
+class PageResults {
+ public:
+  PageResults() {}
+  ~PageResults() {}
+
+  // Walks the page from the start with the given iterator, which ends up at
+  // the end of the page, replacing any previous contents.
+  void Collect(ResultIterator* it);
+
+  const GenericVector<PageResultsWord>& words() const { return words_; }
+
+  // Appends the text of the page exactly as the RIL_PARA text of all the
+  // paragraphs of a ResultIterator would read.
+  void AppendUTF8Text(STRING* text) const;
+
+ private:
+  GenericVector<PageResultsWord> words_;
+};
+
+// Appends the text of an output format to a buffer owned by the caller.
+// The hOCR and TSV of a dense page are made of a great many short pieces,
+// and building them up in a STRING allocated a string for every escaped
+// word and number, so the writer formats them in place at the end of the
+// buffer instead. A buffer that is kept from one page to the next only grows
+// until it holds the largest page.
+class ResultWriter {
+ public:
+  explicit ResultWriter(GenericVector<char>* output) : output_(output) {}
+
+  void Add(const char* data, int length);
+  void Add(const char* str) { Add(str, strlen(str)); }
+  void Add(const STRING& str) { Add(str.string(), str.length()); }
+  // Appends str and the number, as STRING::add_str_int does.
+  void AddInt(const char* str, int number);
+  // Appends str and the number as a %.8g, as STRING::add_str_double does.
+  void AddDouble(const char* str, double number);
+  // Appends the text with &<>"' replaced by their HTML codes, as HOcrEscape
+  // returns it.
+  void AddHOcrEscaped(const char* text);
+
+ private:
+  // Grows the output by length bytes and returns the start of the new bytes.
+  char* Extend(int length);
+
+  GenericVector<char>* output_;
+};
+
+}  // namespace tesseract.
+
+#endif  // TESSERACT_API_PAGERESULTS_H_
@@ -20,17 +20,29 @@
 #include "config_auto.h"
 #endif
 
+#include <stdlib.h>
+
 #include "allheaders.h"
 #include "baseapi.h"
 #include "math.h"
+#include "pageresults.h"
 #include "renderer.h"
 #include "strngs.h"
+#include "svutil.h"
 #include "tprintf.h"
 
 #ifdef _MSC_VER
 #include "mathfix.h"
 #endif
 
+#ifdef HAVE_JBIG2ENC
+#include "jbig2enc.h"
+#endif
+
+#ifdef HAVE_LIBZ
+#include "zlib.h"
+#endif
+
 /*
 
 Design notes from Ken Sharp, with light editing.
@@ -179,13 +191,153 @@ static const int kCharWidth = 2;
 // letter 'c'
 static const int kMaxBytesPerCodepoint = 20;
 
+// JPEG quality of the page images that have to be transcoded.
+static const int kJpegQuality = 85;
+
+// The background of a mixed raster content page is kept at this fraction
+// of the resolution of the page, and compressed harder, as the text that
+// makes it look sharp is in the full resolution mask.
+static const float kMRCBackgroundScale = 1.0f / 3;
+static const int kMRCBackgroundJpegQuality = 50;
+// At most this many image regions of a mixed raster content page are kept
+// at full resolution. The rest are only in the background.
+static const int kMaxMRCRegions = 32;
+
+// Object number of the root of the page tree, which is reserved at the
+// start of the document and written at the end.
+static const long int kPagesObjectNumber = 2;
+// Number of pages under each intermediate node of the page tree of a large
+// document.
+static const int kPagesPerTreeNode = 64;
+
+#ifdef HAVE_JBIG2ENC
+// Symbol classification threshold of the JBIG2 encoder (the default of the
+// jbig2 program). Lower values merge more symbols, which is lossier.
+static const float kJBIG2Threshold = 0.85f;
+// Weight of the symbol width in the JBIG2 classification.
+static const float kJBIG2Weight = 0.5f;
+#endif
+
+// A page whose images are being compressed on another thread. Its /Page
+// and /Contents objects wait with it, as the objects of the pages are
+// written in order.
+struct PDFPendingPage {
+  PDFPendingPage()
+    : starts_tree_node(false), page_size(0), contents_size(0), num_images(0),
+      first_image_objnum(0), pix(NULL), has_filename(false), mask(NULL),
+      image_width(0), image_height(0), image_ppi(0), images_ok(false) {}
+
+  // Number of objects that the page takes: the /Page, its /Contents and
+  // its images, after the page tree node that it may start.
+  int num_objects() const {
+    return (starts_tree_node ? 1 : 0) + 2 + num_images;
+  }
+
+  // Whether the number before the /Page is reserved for the page tree node
+  // of the page and those after it, written at the end of the document.
+  bool starts_tree_node;
+  // The /Page object followed by the /Contents object.
+  GenericVector<char> objects;
+  long int page_size;
+  long int contents_size;
+  // The images take the object numbers from first_image_objnum on.
+  int num_images;
+  long int first_image_objnum;
+  // The input of the compression. As leptonica reference counts are not
+  // thread-safe, pix is a private copy of the page image, which the
+  // compression alone uses and destroys, while mask is a clone that it only
+  // reads and the rendering thread destroys. A page with a mask is written
+  // as mixed raster content: a low resolution background, the image regions
+  // at full resolution and the mask of the thresholded page painted over
+  // them.
+  Pix* pix;
+  STRING filename;
+  bool has_filename;
+  Pix* mask;
+  GenericVector<PageResultsBox> regions;
+  // The size of the thresholded image given to the JBIG2 encoder.
+  int image_width;
+  int image_height;
+  int image_ppi;
+  // The image objects one after the other, valid if images_ok once done
+  // has been signalled.
+  GenericVector<char> images;
+  GenericVector<long int> image_sizes;
+  bool images_ok;
+  SVSemaphore done;
+};
+
+// The threads that compress the page images of a TessPDFRenderer, and the
+// pages queued for them.
+struct PDFImageWorkers {
+  PDFImageWorkers() : num_threads(0) {}
+
+  // Guards queue.
+  SVMutex mutex;
+  GenericVector<PDFPendingPage*> queue;
+  // Signalled once for each queued page, and to stop, once for each thread.
+  // A thread that finds the queue empty exits.
+  SVSemaphore work;
+  // Signalled by each thread as it exits.
+  SVSemaphore exited;
+  // Number of threads running. Only used by the rendering thread.
+  int num_threads;
+};
+
+static bool CIDataToPDFObj(L_Compressed_Data *cid, long int objnum,
+                           bool image_mask, GenericVector<char>* pdf_object);
+
+// Compresses data for a /FlateDecode stream at the given zlib compression
+// level (-1 for the default). The result is freed with lept_free. Without
+// zlib, and at the default level, leptonica compresses it.
+static unsigned char* FlateCompress(const unsigned char* data, size_t size,
+                                    int level, size_t* compressed_size) {
+#ifdef HAVE_LIBZ
+  if (level != Z_DEFAULT_COMPRESSION) {
+    uLongf bound = compressBound(size);
+    unsigned char* compressed =
+        static_cast<unsigned char*>(lept_calloc(bound, 1));
+    if (compressed == NULL)
+      return NULL;
+    if (compress2(compressed, &bound, data, size, level) != Z_OK) {
+      lept_free(compressed);
+      return NULL;
+    }
+    *compressed_size = bound;
+    return compressed;
+  }
+#endif
+  return zlibCompress(const_cast<unsigned char*>(data), size,
+                      compressed_size);
+}
+
+// Returns the number of objects taken by the given pending pages.
+static long int NumPendingObjects(
+    const GenericVector<PDFPendingPage*>& pages) {
+  long int num_objects = 0;
+  for (int i = 0; i < pages.size(); ++i)
+    num_objects += pages[i]->num_objects();
+  return num_objects;
+}
+
 /**********************************************************************
  * PDF Renderer interface implementation
  **********************************************************************/
 
 TessPDFRenderer::TessPDFRenderer(const char *outputbase, const char *datadir)
     : TessResultRenderer(outputbase, "pdf") {
-  TessPDFRenderer(outputbase, datadir, false);
+  obj_  = 0;
+  datadir_ = datadir;
+  textonly_ = false;
+  image_threads_ = 1;
+  jbig2_images_ = false;
+  mrc_images_ = false;
+  large_document_ = false;
+  compact_text_ = false;
+  compression_level_ = -1;
+  jbig2_ = NULL;
+  image_workers_ = NULL;
+  offsets_.push_back(0);
 }
 
 TessPDFRenderer::TessPDFRenderer(const char *outputbase, const char *datadir,
@@ -194,9 +346,54 @@ TessPDFRenderer::TessPDFRenderer(const char *outputbase, const char *datadir,
   obj_  = 0;
   datadir_ = datadir;
   textonly_ = textonly;
+  image_threads_ = 1;
+  jbig2_images_ = false;
+  mrc_images_ = false;
+  large_document_ = false;
+  compact_text_ = false;
+  compression_level_ = -1;
+  jbig2_ = NULL;
+  image_workers_ = NULL;
+  offsets_.push_back(0);
+}
+
+TessPDFRenderer::TessPDFRenderer(TessResultSink* sink, const char *datadir,
+                                 bool textonly)
+    : TessResultRenderer(sink, "pdf") {
+  obj_  = 0;
+  datadir_ = datadir;
+  textonly_ = textonly;
+  image_threads_ = 1;
+  jbig2_images_ = false;
+  mrc_images_ = false;
+  large_document_ = false;
+  compact_text_ = false;
+  compression_level_ = -1;
+  jbig2_ = NULL;
+  image_workers_ = NULL;
   offsets_.push_back(0);
 }
 
+TessPDFRenderer::~TessPDFRenderer() {
+  // If the document was not ended, the pages that were added are written
+  // anyway, as they would have been had their images been compressed in line.
+  if (jbig2_ != NULL)
+    WriteJBIG2Pages();
+  while (!pending_pages_.empty())
+    WriteFirstPendingPage();
+  StopImageWorkers();
+  delete image_workers_;
+}
+
+void TessPDFRenderer::set_jbig2_images(bool jbig2_images) {
+#ifdef HAVE_JBIG2ENC
+  jbig2_images_ = jbig2_images;
+#else
+  if (jbig2_images)
+    tprintf("Warning: JBIG2 PDF images need tesseract built with jbig2enc\n");
+#endif
+}
+
 void TessPDFRenderer::AppendPDFObjectDIY(size_t objectsize) {
   offsets_.push_back(objectsize + offsets_.back());
   obj_++;
@@ -331,18 +528,154 @@ bool CodepointToUtf16be(int code, char utf16[kMaxBytesPerCodepoint]) {
   return true;
 }
 
+// Appends the operators that paint image /Im<index> over the given
+// rectangle of the page, in PDF units. A stencil is an image mask, which
+// is painted in black. Without an image (index 0) only the graphics state
+// is touched.
+static void AppendDrawImage(double x, double y, double width, double height,
+                            int index, bool stencil, STRING* pdf_str) {
+  *pdf_str += "q ";
+  pdf_str->add_str_double("", prec(width));
+  *pdf_str += " 0 0 ";
+  pdf_str->add_str_double("", prec(height));
+  pdf_str->add_str_double(" ", prec(x));
+  pdf_str->add_str_double(" ", prec(y));
+  *pdf_str += " cm";
+  if (stencil) {
+    *pdf_str += " 0 g";
+  }
+  if (index > 0) {
+    pdf_str->add_str_int(" /Im", index);
+    *pdf_str += " Do";
+  }
+  *pdf_str += " Q\n";
+}
+
+// A word of the text layer, placed on the page.
+struct PDFTextWord {
+  PDFTextWord()
+    : empty(true), starts_block(false), ends_line(false), ends_block(false),
+      line_x1(0), line_y1(0), line_x2(0), line_y2(0),
+      writing_direction(WRITING_DIRECTION_LEFT_TO_RIGHT),
+      x(0.0), y(0.0), length(0.0), fontsize(0), num_glyphs(0) {}
+
+  // Whether the word is visible, which it is if it has a length and glyphs.
+  bool shown() const {
+    return length > 0 && num_glyphs > 0 && fontsize > 0;
+  }
+
+  bool empty;
+  bool starts_block;
+  bool ends_line;
+  bool ends_block;
+  // The baseline of the textline, clipped.
+  int line_x1, line_y1, line_x2, line_y2;
+  tesseract::WritingDirection writing_direction;
+  // Origin and length of the word on the page, in PDF units.
+  double x, y, length;
+  int fontsize;
+  // The UTF-16BE representation of the word, in hex, and its glyph count.
+  STRING utf16;
+  int num_glyphs;
+};
+
+// Lays out the words of the page for the text layer.
+static void GetPDFTextWords(const PageResults* results, double ppi,
+                            double height, GenericVector<PDFTextWord>* out) {
+  tesseract::WritingDirection old_writing_direction =
+      WRITING_DIRECTION_LEFT_TO_RIGHT;
+  int line_x1 = 0;
+  int line_y1 = 0;
+  int line_x2 = 0;
+  int line_y2 = 0;
+
+  const GenericVector<PageResultsWord>& words = results->words();
+  out->reserve(words.size());
+  for (int w = 0; w < words.size(); ++w) {
+    const PageResultsWord& word = words[w];
+    PDFTextWord pdf_word;
+    pdf_word.starts_block = word.starts_block;
+    if (word.empty) {
+      out->push_back(pdf_word);
+      continue;
+    }
+    pdf_word.empty = false;
+    pdf_word.ends_line = word.ends_line;
+    pdf_word.ends_block = word.ends_block;
+
+    if (word.starts_line) {
+      ClipBaseline(ppi, word.line_x1, word.line_y1, word.line_x2, word.line_y2,
+                   &line_x1, &line_y1, &line_x2, &line_y2);
+    }
+    pdf_word.line_x1 = line_x1;
+    pdf_word.line_y1 = line_y1;
+    pdf_word.line_x2 = line_x2;
+    pdf_word.line_y2 = line_y2;
+
+    // Writing direction changes at a per-word granularity
+    tesseract::WritingDirection writing_direction = word.writing_direction;
+    if (writing_direction != WRITING_DIRECTION_TOP_TO_BOTTOM) {
+      switch (word.direction) {
+        case DIR_LEFT_TO_RIGHT:
+          writing_direction = WRITING_DIRECTION_LEFT_TO_RIGHT;
+          break;
+        case DIR_RIGHT_TO_LEFT:
+          writing_direction = WRITING_DIRECTION_RIGHT_TO_LEFT;
+          break;
+        default:
+          writing_direction = old_writing_direction;
+      }
+    }
+    pdf_word.writing_direction = writing_direction;
+    old_writing_direction = writing_direction;
+
+    // Where is word origin and how long is it?
+    GetWordBaseline(writing_direction, ppi, height,
+                    word.word_x1, word.word_y1, word.word_x2, word.word_y2,
+                    line_x1, line_y1, line_x2, line_y2,
+                    &pdf_word.x, &pdf_word.y, &pdf_word.length);
+
+    // We've found that for in Arabic, Tesseract will happily return a
+    // fontsize of zero, so we make up a default number to protect
+    // ourselves.
+    const int kDefaultFontsize = 8;
+    pdf_word.fontsize = word.pointsize;
+    if (pdf_word.fontsize <= 0)
+      pdf_word.fontsize = kDefaultFontsize;
+
+    GenericVector<int> unicodes;
+    UNICHAR::UTF8ToUnicode(word.symbols_text.string(), &unicodes);
+    char utf16[kMaxBytesPerCodepoint];
+    for (int i = 0; i < unicodes.length(); i++) {
+      int code = unicodes[i];
+      if (CodepointToUtf16be(code, utf16)) {
+        pdf_word.utf16 += utf16;
+        pdf_word.num_glyphs++;
+      }
+    }
+    out->push_back(pdf_word);
+  }
+}
+
+// Returns the horizontal stretch (Tz) that makes glyphs of the given size
+// span the given length.
+static double HorizontalStretch(double length, int fontsize, int num_glyphs) {
+  return kCharWidth * prec(100.0 * length / (fontsize * num_glyphs));
+}
+
 char* TessPDFRenderer::GetPDFTextObjects(TessBaseAPI* api,
-                                         double width, double height) {
+                                         double width, double height,
+                                         const char* image_ops) {
   STRING pdf_str("");
   double ppi = api->GetSourceYResolution();
 
   // These initial conditions are all arbitrary and will be overwritten
   double old_x = 0.0, old_y = 0.0;
   int old_fontsize = 0;
+  double old_h_stretch = 0.0;
   tesseract::WritingDirection old_writing_direction =
       WRITING_DIRECTION_LEFT_TO_RIGHT;
   bool new_block = true;
-  int fontsize = 0;
   double a = 1;
   double b = 0;
   double c = 0;
@@ -351,159 +684,158 @@ char* TessPDFRenderer::GetPDFTextObjects(TessBaseAPI* api,
   // TODO(jbreiden) This marries the text and image together.
   // Slightly cleaner from an abstraction standpoint if this were to
   // live inside a separate text object.
-  pdf_str += "q ";
-  pdf_str.add_str_double("", prec(width));
-  pdf_str += " 0 0 ";
-  pdf_str.add_str_double("", prec(height));
-  pdf_str += " 0 0 cm";
-  if (!textonly_) {
-    pdf_str += " /Im1 Do";
-  }
-  pdf_str += " Q\n";
-
-  int line_x1 = 0;
-  int line_y1 = 0;
-  int line_x2 = 0;
-  int line_y2 = 0;
-
-  ResultIterator *res_it = api->GetIterator();
-  while (!res_it->Empty(RIL_BLOCK)) {
-    if (res_it->IsAtBeginningOf(RIL_BLOCK)) {
+  pdf_str += image_ops;
+
+  const PageResults* results = api->GetPageResults();
+  GenericVector<PDFTextWord> words;
+  GetPDFTextWords(results, ppi, height, &words);
+  api->ReleasePageResults(results);
+  int w = 0;
+  while (w < words.size()) {
+    const PDFTextWord& word = words[w];
+    if (word.starts_block && (!compact_text_ || !word.empty)) {
       pdf_str += "BT\n3 Tr";     // Begin text object, use invisible ink
       old_fontsize = 0;          // Every block will declare its fontsize
+      old_h_stretch = 0.0;       // and its horizontal stretch
       new_block = true;          // Every block will declare its affine matrix
     }
 
-    if (res_it->IsAtBeginningOf(RIL_TEXTLINE)) {
-      int x1, y1, x2, y2;
-      res_it->Baseline(RIL_TEXTLINE, &x1, &y1, &x2, &y2);
-      ClipBaseline(ppi, x1, y1, x2, y2, &line_x1, &line_y1, &line_x2, &line_y2);
-    }
-
-    if (res_it->Empty(RIL_WORD)) {
-      res_it->Next(RIL_WORD);
+    if (word.empty || (compact_text_ && !word.shown())) {
+      if (compact_text_ && word.ends_block)
+        pdf_str += "ET\n";
+      ++w;
       continue;
     }
 
-    // Writing direction changes at a per-word granularity
-    tesseract::WritingDirection writing_direction;
-    {
-      tesseract::Orientation orientation;
-      tesseract::TextlineOrder textline_order;
-      float deskew_angle;
-      res_it->Orientation(&orientation, &writing_direction,
-                          &textline_order, &deskew_angle);
-      if (writing_direction != WRITING_DIRECTION_TOP_TO_BOTTOM) {
-        switch (res_it->WordDirection()) {
-          case DIR_LEFT_TO_RIGHT:
-            writing_direction = WRITING_DIRECTION_LEFT_TO_RIGHT;
-            break;
-          case DIR_RIGHT_TO_LEFT:
-            writing_direction = WRITING_DIRECTION_RIGHT_TO_LEFT;
-            break;
-          default:
-            writing_direction = old_writing_direction;
-        }
+    // In the compact text layer, the following words of the line that
+    // share the font size are shown by the same TJ as this one, with the
+    // gap to each word as a displacement in the array.
+    int end = w + 1;
+    double h_stretch =
+        HorizontalStretch(word.length, word.fontsize, word.num_glyphs);
+    if (compact_text_) {
+      double length = word.length;
+      int num_glyphs = word.num_glyphs;
+      while (!words[end - 1].ends_line && end < words.size() &&
+             !words[end].starts_block &&
+             words[end].writing_direction == word.writing_direction &&
+             words[end].fontsize == word.fontsize && words[end].shown()) {
+        length += words[end].length;
+        num_glyphs += words[end].num_glyphs;
+        ++end;
       }
+      // One stretch for all the words, so that they are as long as they
+      // are in total.
+      h_stretch = HorizontalStretch(length, word.fontsize, num_glyphs);
     }
 
-    // Where is word origin and how long is it?
-    double x, y, word_length;
-    {
-      int word_x1, word_y1, word_x2, word_y2;
-      res_it->Baseline(RIL_WORD, &word_x1, &word_y1, &word_x2, &word_y2);
-      GetWordBaseline(writing_direction, ppi, height,
-                      word_x1, word_y1, word_x2, word_y2,
-                      line_x1, line_y1, line_x2, line_y2,
-                      &x, &y, &word_length);
+    bool new_matrix =
+        word.writing_direction != old_writing_direction || new_block;
+    if (compact_text_ && !new_matrix) {
+      // The matrix of a block is that of its first line, and the words of
+      // a later line at another angle would drift off it along the TJ, so
+      // such a line gets its own matrix.
+      double la, lb, lc, ld;
+      AffineMatrix(word.writing_direction, word.line_x1, word.line_y1,
+                   word.line_x2, word.line_y2, &la, &lb, &lc, &ld);
+      new_matrix = prec(la) != a || prec(lb) != b ||
+                   prec(lc) != c || prec(ld) != d;
     }
-
-    if (writing_direction != old_writing_direction || new_block) {
-      AffineMatrix(writing_direction,
-                   line_x1, line_y1, line_x2, line_y2, &a, &b, &c, &d);
+    if (new_matrix) {
+      AffineMatrix(word.writing_direction, word.line_x1, word.line_y1,
+                   word.line_x2, word.line_y2, &a, &b, &c, &d);
+      if (compact_text_) {
+        // Positions in the line are worked out with the matrix as written.
+        a = prec(a);
+        b = prec(b);
+        c = prec(c);
+        d = prec(d);
+      }
       pdf_str.add_str_double(" ", prec(a));  // . This affine matrix
       pdf_str.add_str_double(" ", prec(b));  // . sets the coordinate
       pdf_str.add_str_double(" ", prec(c));  // . system for all
       pdf_str.add_str_double(" ", prec(d));  // . text that follows.
-      pdf_str.add_str_double(" ", prec(x));  // .
-      pdf_str.add_str_double(" ", prec(y));  // .
+      pdf_str.add_str_double(" ", prec(word.x));  // .
+      pdf_str.add_str_double(" ", prec(word.y));  // .
       pdf_str += (" Tm ");                   // Place cursor absolutely
       new_block = false;
     } else {
-      double dx = x - old_x;
-      double dy = y - old_y;
+      double dx = word.x - old_x;
+      double dy = word.y - old_y;
       pdf_str.add_str_double(" ", prec(dx * a + dy * b));
       pdf_str.add_str_double(" ", prec(dx * c + dy * d));
       pdf_str += (" Td ");                   // Relative moveto
     }
-    old_x = x;
-    old_y = y;
-    old_writing_direction = writing_direction;
+    old_x = word.x;
+    old_y = word.y;
+    old_writing_direction = word.writing_direction;
 
     // Adjust font size on a per word granularity. Pay attention to
-    // fontsize, old_fontsize, and pdf_str. We've found that for
-    // in Arabic, Tesseract will happily return a fontsize of zero,
-    // so we make up a default number to protect ourselves.
-    {
-      bool bold, italic, underlined, monospace, serif, smallcaps;
-      int font_id;
-      res_it->WordFontAttributes(&bold, &italic, &underlined, &monospace,
-                                 &serif, &smallcaps, &fontsize, &font_id);
-      const int kDefaultFontsize = 8;
-      if (fontsize <= 0)
-        fontsize = kDefaultFontsize;
-      if (fontsize != old_fontsize) {
-        char textfont[20];
-        snprintf(textfont, sizeof(textfont), "/f-0-0 %d Tf ", fontsize);
-        pdf_str += textfont;
-        old_fontsize = fontsize;
-      }
+    // fontsize, old_fontsize, and pdf_str.
+    if (word.fontsize != old_fontsize) {
+      char textfont[20];
+      snprintf(textfont, sizeof(textfont), "/f-0-0 %d Tf ", word.fontsize);
+      pdf_str += textfont;
+      old_fontsize = word.fontsize;
     }
 
-    bool last_word_in_line = res_it->IsAtFinalElement(RIL_TEXTLINE, RIL_WORD);
-    bool last_word_in_block = res_it->IsAtFinalElement(RIL_BLOCK, RIL_WORD);
-    STRING pdf_word("");
-    int pdf_word_len = 0;
-    do {
-      const char *grapheme = res_it->GetUTF8Text(RIL_SYMBOL);
-      if (grapheme && grapheme[0] != '\0') {
-        GenericVector<int> unicodes;
-        UNICHAR::UTF8ToUnicode(grapheme, &unicodes);
-        char utf16[kMaxBytesPerCodepoint];
-        for (int i = 0; i < unicodes.length(); i++) {
-          int code = unicodes[i];
-          if (CodepointToUtf16be(code, utf16)) {
-            pdf_word += utf16;
-            pdf_word_len++;
-          }
+    if (!compact_text_) {
+      if (word.shown()) {
+        pdf_str.add_str_double("", h_stretch);
+        pdf_str += " Tz";          // horizontal stretch
+        pdf_str += " [ <";
+        pdf_str += word.utf16;     // UTF-16BE representation
+        pdf_str += "> ] TJ";       // show the text
+      }
+    } else {
+      if (h_stretch != old_h_stretch) {
+        pdf_str.add_str_double("", h_stretch);
+        pdf_str += " Tz ";
+        old_h_stretch = h_stretch;
+      }
+      // Glyph advance in text space, and the displacement of a TJ number,
+      // which is in thousandths of the font size, stretched.
+      double glyph_width = word.fontsize * h_stretch / (100.0 * kCharWidth);
+      double tj_unit = word.fontsize * h_stretch / 100000.0;
+      double position = 0.0;
+      pdf_str += "[<";
+      for (int i = w; i < end; ++i) {
+        const PDFTextWord& next = words[i];
+        if (i > w) {
+          double dx = next.x - word.x;
+          double dy = next.y - word.y;
+          double gap = (dx * a + dy * b) - position;
+          int displacement = static_cast<int>(floor(-gap / tj_unit + 0.5));
+          pdf_str.add_str_int(">", displacement);
+          pdf_str += "<";
+          position -= displacement * tj_unit;
         }
+        pdf_str += next.utf16;
+        position += next.num_glyphs * glyph_width;
       }
-      delete []grapheme;
-      res_it->Next(RIL_SYMBOL);
-    } while (!res_it->Empty(RIL_BLOCK) && !res_it->IsAtBeginningOf(RIL_WORD));
-    if (word_length > 0 && pdf_word_len > 0 && fontsize > 0) {
-      double h_stretch =
-          kCharWidth * prec(100.0 * word_length / (fontsize * pdf_word_len));
-      pdf_str.add_str_double("", h_stretch);
-      pdf_str += " Tz";          // horizontal stretch
-      pdf_str += " [ <";
-      pdf_str += pdf_word;       // UTF-16BE representation
-      pdf_str += "> ] TJ";       // show the text
+      pdf_str += ">]TJ";
     }
-    if (last_word_in_line) {
+    const PDFTextWord& last = words[end - 1];
+    if (last.ends_line) {
       pdf_str += " \n";
+    } else if (compact_text_) {
+      pdf_str += "\n";
     }
-    if (last_word_in_block) {
+    if (last.ends_block) {
       pdf_str += "ET\n";         // end the text object
     }
+    w = end;
   }
   char *ret = new char[pdf_str.length() + 1];
   strcpy(ret, pdf_str.string());
-  delete res_it;
   return ret;
 }
 
 bool TessPDFRenderer::BeginDocumentHandler() {
+#ifdef HAVE_JBIG2ENC
+  if (jbig2_images_ && !textonly_ && jbig2_ == NULL)
+    jbig2_ = jbig2_init(kJBIG2Threshold, kJBIG2Weight, 0, 0, false, -1);
+#endif
   char buf[kBasicBufSize];
   size_t n;
 
@@ -581,8 +913,9 @@ bool TessPDFRenderer::BeginDocumentHandler() {
   }
   size_t len;
   unsigned char *comp =
-      zlibCompress(cidtogidmap, kCIDToGIDMapSize, &len);
+      FlateCompress(cidtogidmap, kCIDToGIDMapSize, compression_level_, &len);
   delete[] cidtogidmap;
+  if (comp == NULL) return false;
   n = snprintf(buf, sizeof(buf),
                "5 0 obj\n"
                "<<\n"
@@ -706,23 +1039,13 @@ bool TessPDFRenderer::BeginDocumentHandler() {
 }
 
 bool TessPDFRenderer::imageToPDFObj(Pix *pix,
-                                    char *filename,
+                                    const char *filename,
                                     long int objnum,
-                                    char **pdf_object,
-                                    long int *pdf_object_size) {
-  size_t n;
-  char b0[kBasicBufSize];
-  char b1[kBasicBufSize];
-  char b2[kBasicBufSize];
-  if (!pdf_object_size || !pdf_object)
-    return false;
-  *pdf_object = NULL;
-  *pdf_object_size = 0;
-  if (!filename)
+                                    GenericVector<char>* pdf_object) {
+  if (!pdf_object || !filename)
     return false;
 
   L_Compressed_Data *cid = NULL;
-  const int kJpegQuality = 85;
 
   int format, sad;
   findFileFormat(filename, &format);
@@ -738,7 +1061,18 @@ bool TessPDFRenderer::imageToPDFObj(Pix *pix,
     l_CIDataDestroy(&cid);
     return false;
   }
+  return CIDataToPDFObj(cid, objnum, false, pdf_object);
+}
 
+// Appends the PDF image object of the given compressed image to pdf_object
+// and destroys it. An image mask paints the current colour where the image
+// is black and leaves the rest of the page alone.
+static bool CIDataToPDFObj(L_Compressed_Data *cid, long int objnum,
+                           bool image_mask, GenericVector<char>* pdf_object) {
+  size_t n;
+  char b0[kBasicBufSize];
+  char b1[kBasicBufSize];
+  char b2[kBasicBufSize];
   const char *group4 = "";
   const char *filter;
   switch(cid->type) {
@@ -764,7 +1098,12 @@ bool TessPDFRenderer::imageToPDFObj(Pix *pix,
   // It requires creating an /SMask for the alpha channel.
   // http://stackoverflow.com/questions/14220221
   const char *colorspace;
-  if (cid->ncolors > 0) {
+  if (image_mask) {
+    // Leptonica has 1 for black, while the fax decoder makes 0 for black,
+    // which is what an image mask paints.
+    colorspace = (cid->type == L_G4_ENCODE) ?
+        "  /ImageMask true\n" : "  /ImageMask true\n  /Decode [1 0]\n";
+  } else if (cid->ncolors > 0) {
     n = snprintf(b0, sizeof(b0),
                  "  /ColorSpace [ /Indexed /DeviceRGB %d %s ]\n",
                  cid->ncolors - 1, cid->cmapdatahex);
@@ -827,43 +1166,327 @@ bool TessPDFRenderer::imageToPDFObj(Pix *pix,
       "endstream\n"
       "endobj\n";
 
-  size_t b1_len = strlen(b1);
-  size_t b2_len = strlen(b2);
-  size_t b3_len = strlen(b3);
-  size_t colorspace_len = strlen(colorspace);
-
-  *pdf_object_size =
-      b1_len + colorspace_len + b2_len + cid->nbytescomp + b3_len;
-  *pdf_object = new char[*pdf_object_size];
-
-  char *p = *pdf_object;
-  memcpy(p, b1, b1_len);
-  p += b1_len;
-  memcpy(p, colorspace, colorspace_len);
-  p += colorspace_len;
-  memcpy(p, b2, b2_len);
-  p += b2_len;
-  memcpy(p, cid->datacomp, cid->nbytescomp);
-  p += cid->nbytescomp;
-  memcpy(p, b3, b3_len);
+  ResultWriter writer(pdf_object);
+  writer.Add(b1);
+  writer.Add(colorspace);
+  writer.Add(b2);
+  writer.Add(reinterpret_cast<const char *>(cid->datacomp), cid->nbytescomp);
+  writer.Add(b3);
   l_CIDataDestroy(&cid);
   return true;
 }
 
+// Makes the image objects of a mixed raster content page: the background,
+// the mask and then the image regions. page->pix is the page's own copy, so
+// leptonica may clone it here, but the mask is shared with the rendering
+// thread and is only copied.
+static bool MRCToPDFObjs(PDFPendingPage* page) {
+  long int objnum = page->first_image_objnum;
+  L_Compressed_Data *cid = NULL;
+  // BACKGROUND
+  Pix* converted = NULL;
+  if (pixGetColormap(page->pix) != NULL)
+    converted = pixRemoveColormap(page->pix, REMOVE_CMAP_BASED_ON_SRC);
+  else if (pixGetDepth(page->pix) != 8 && pixGetDepth(page->pix) != 32)
+    converted = pixConvertTo8(page->pix, false);
+  Pix* src = converted != NULL ? converted : page->pix;
+  Pix* background = pixScaleAreaMap(src, kMRCBackgroundScale,
+                                    kMRCBackgroundScale);
+  bool ok = background != NULL &&
+      pixGenerateCIData(background, L_JPEG_ENCODE, kMRCBackgroundJpegQuality,
+                        0, &cid) == 0 &&
+      CIDataToPDFObj(cid, objnum++, false, &page->images);
+  pixDestroy(&background);
+  page->image_sizes.push_back(page->images.size());
+  // MASK
+  // The image regions are not thresholded text, so they are left out of the
+  // mask that is painted over them.
+  Pix* mask = ok ? pixCopy(NULL, page->mask) : NULL;
+  for (int i = 0; mask != NULL && i < page->regions.size(); ++i) {
+    const PageResultsBox& region = page->regions[i];
+    Box* box = boxCreate(region.left, region.top, region.right - region.left,
+                         region.bottom - region.top);
+    pixClearInRect(mask, box);
+    boxDestroy(&box);
+  }
+  // G4 needs leptonica built with libtiff, and flate does it otherwise.
+  cid = NULL;
+  if (mask != NULL && pixGenerateCIData(mask, L_G4_ENCODE, 0, 0, &cid) != 0)
+    pixGenerateCIData(mask, L_FLATE_ENCODE, 0, 0, &cid);
+  ok = mask != NULL && cid != NULL &&
+      CIDataToPDFObj(cid, objnum++, true, &page->images);
+  pixDestroy(&mask);
+  page->image_sizes.push_back(page->images.size() - page->image_sizes[0]);
+  // REGIONS
+  for (int i = 0; ok && i < page->regions.size(); ++i) {
+    const PageResultsBox& region = page->regions[i];
+    Box* box = boxCreate(region.left, region.top, region.right - region.left,
+                         region.bottom - region.top);
+    Pix* image = pixClipRectangle(src, box, NULL);
+    boxDestroy(&box);
+    int start = page->images.size();
+    cid = NULL;
+    ok = image != NULL &&
+        pixGenerateCIData(image, L_JPEG_ENCODE, kJpegQuality, 0, &cid) == 0 &&
+        CIDataToPDFObj(cid, objnum++, false, &page->images);
+    pixDestroy(&image);
+    page->image_sizes.push_back(page->images.size() - start);
+  }
+  pixDestroy(&converted);
+  return ok;
+}
+
+void TessPDFRenderer::CompressImages(PDFPendingPage* page) {
+  if (page->mask != NULL) {
+    page->images_ok = MRCToPDFObjs(page);
+  } else {
+    page->images_ok = imageToPDFObj(
+        page->pix, page->has_filename ? page->filename.string() : NULL,
+        page->first_image_objnum, &page->images);
+    page->image_sizes.push_back(page->images.size());
+  }
+  pixDestroy(&page->pix);
+  page->done.Signal();
+}
+
+void* TessPDFRenderer::ImageWorkerThread(void* arg) {
+  PDFImageWorkers* workers = static_cast<PDFImageWorkers*>(arg);
+  while (true) {
+    workers->work.Wait();
+    workers->mutex.Lock();
+    if (workers->queue.empty()) {
+      workers->mutex.Unlock();
+      break;
+    }
+    PDFPendingPage* page = workers->queue[0];
+    workers->queue.remove(0);
+    workers->mutex.Unlock();
+    CompressImages(page);
+  }
+  workers->exited.Signal();
+  return NULL;
+}
+
+void TessPDFRenderer::StartImageWorkers() {
+  if (image_workers_ == NULL)
+    image_workers_ = new PDFImageWorkers;
+  while (image_workers_->num_threads < image_threads_ &&
+         SVSync::StartThread(ImageWorkerThread, image_workers_))
+    ++image_workers_->num_threads;
+}
+
+void TessPDFRenderer::StopImageWorkers() {
+  if (image_workers_ == NULL)
+    return;
+  int num_threads = image_workers_->num_threads;
+  for (int t = 0; t < num_threads; ++t)
+    image_workers_->work.Signal();
+  for (int t = 0; t < num_threads; ++t)
+    image_workers_->exited.Wait();
+  image_workers_->num_threads = 0;
+}
+
+bool TessPDFRenderer::WriteFirstPendingPage() {
+  PDFPendingPage* page = pending_pages_[0];
+  pending_pages_.remove(0);
+  if (page->starts_tree_node)
+    AppendPDFObject("");
+  AppendData(&page->objects[0], page->page_size);
+  AppendPDFObjectDIY(page->page_size);
+  AppendData(&page->objects[0] + page->page_size, page->contents_size);
+  AppendPDFObjectDIY(page->contents_size);
+  bool result = true;
+  if (page->num_images > 0) {
+    page->done.Wait();
+    pixDestroy(&page->mask);
+    if (page->images_ok) {
+      const char* image = &page->images[0];
+      for (int i = 0; i < page->num_images; ++i) {
+        AppendData(image, page->image_sizes[i]);
+        AppendPDFObjectDIY(page->image_sizes[i]);
+        image += page->image_sizes[i];
+      }
+    } else {
+      // The object numbers were taken when the page was queued, and the
+      // pages after it refer to their own objects by number, so they must
+      // be filled.
+      char buf[kBasicBufSize];
+      for (int i = 0; i < page->num_images; ++i) {
+        snprintf(buf, sizeof(buf), "%ld 0 obj\nnull\nendobj\n",
+                 page->first_image_objnum + i);
+        AppendPDFObject(buf);
+      }
+      result = false;
+    }
+  }
+  delete page;
+  return result;
+}
+
+bool TessPDFRenderer::WriteJBIG2Pages() {
+#ifdef HAVE_JBIG2ENC
+  if (pending_pages_.empty()) {
+    jbig2_destroy(jbig2_);
+    jbig2_ = NULL;
+    return true;
+  }
+  int globals_length = 0;
+  uint8_t* globals = jbig2_pages_complete(jbig2_, &globals_length);
+  // The dictionary is written after the pages that refer to it.
+  long int globals_obj = obj_ + NumPendingObjects(pending_pages_);
+  bool result = globals != NULL;
+  char buf[kBasicBufSize];
+  for (int page_no = 0; !pending_pages_.empty(); ++page_no) {
+    PDFPendingPage* page = pending_pages_[0];
+    int length = 0;
+    uint8_t* data = NULL;
+    if (globals != NULL) {
+      data = jbig2_produce_page(jbig2_, page_no, page->image_ppi,
+                                page->image_ppi, &length);
+    }
+    size_t n = snprintf(buf, sizeof(buf),
+                        "%ld 0 obj\n"
+                        "<<\n"
+                        "  /Length %d\n"
+                        "  /Subtype /Image\n"
+                        "  /Width %d\n"
+                        "  /Height %d\n"
+                        "  /ColorSpace /DeviceGray\n"
+                        "  /BitsPerComponent 1\n"
+                        "  /Filter /JBIG2Decode\n"
+                        "  /DecodeParms << /JBIG2Globals %ld 0 R >>\n"
+                        ">>\n"
+                        "stream\n",
+                        page->first_image_objnum, length, page->image_width,
+                        page->image_height, globals_obj);
+    if (data != NULL && n < sizeof(buf)) {
+      const char* b3 =
+          "endstream\n"
+          "endobj\n";
+      ResultWriter writer(&page->images);
+      writer.Add(buf, n);
+      writer.Add(reinterpret_cast<const char*>(data), length);
+      writer.Add(b3);
+      page->image_sizes.push_back(page->images.size());
+      page->images_ok = true;
+    }
+    free(data);
+    page->done.Signal();
+    if (!WriteFirstPendingPage()) result = false;
+  }
+  // GLOBALS
+  if (globals != NULL) {
+    snprintf(buf, sizeof(buf),
+             "%ld 0 obj\n"
+             "<<\n"
+             "  /Length %d\n"
+             ">>\n"
+             "stream\n", globals_obj, globals_length);
+    AppendString(buf);
+    long int objsize = strlen(buf);
+    AppendData(reinterpret_cast<const char*>(globals), globals_length);
+    objsize += globals_length;
+    const char* b2 =
+        "endstream\n"
+        "endobj\n";
+    AppendString(b2);
+    objsize += strlen(b2);
+    AppendPDFObjectDIY(objsize);
+    free(globals);
+  } else {
+    snprintf(buf, sizeof(buf), "%ld 0 obj\nnull\nendobj\n", globals_obj);
+    AppendPDFObject(buf);
+  }
+  jbig2_destroy(jbig2_);
+  jbig2_ = NULL;
+  return result;
+#else
+  return true;
+#endif
+}
+
 bool TessPDFRenderer::AddImageHandler(TessBaseAPI* api) {
   size_t n;
   char buf[kBasicBufSize];
-  char buf2[kBasicBufSize];
   Pix *pix = api->GetInputImage();
-  char *filename = (char *)api->GetInputName();
+  const char *filename = api->GetInputName();
   int ppi = api->GetSourceYResolution();
   if (!pix || ppi <= 0)
     return false;
   double width = pixGetWidth(pix) * 72.0 / ppi;
   double height = pixGetHeight(pix) * 72.0 / ppi;
+  // The pages still waiting for their images have taken the next numbers.
+  long int page_obj = obj_ + NumPendingObjects(pending_pages_);
+  // The pages of a large document are grouped under intermediate nodes of
+  // the page tree, so that a viewer does not have to read a /Kids array of
+  // every page to find one.
+  long int parent_obj = kPagesObjectNumber;
+  bool starts_tree_node = false;
+  if (large_document_) {
+    starts_tree_node = pages_.size() % kPagesPerTreeNode == 0;
+    parent_obj = starts_tree_node ? page_obj++ : page_tree_nodes_.back();
+  }
+  // A bilevel page is its own mask, so it is never split up.
+  bool mrc = mrc_images_ && !textonly_ && jbig2_ == NULL &&
+      pixGetDepth(pix) > 1;
+  Pix* bw = NULL;
+  if (jbig2_ != NULL || mrc) {
+    bw = api->GetThresholdedImage();
+    if (bw == NULL)
+      return false;
+  }
+  // The mask is painted over the whole page and the image regions are in
+  // the coordinates of the input image, so a thresholded image of another
+  // size, such as that of a SetRectangle, is not split up either.
+  if (mrc && (pixGetWidth(bw) != pixGetWidth(pix) ||
+              pixGetHeight(bw) != pixGetHeight(pix))) {
+    mrc = false;
+    pixDestroy(&bw);
+  }
 
-  snprintf(buf2, sizeof(buf2), "/XObject << /Im1 %ld 0 R >>\n", obj_ + 2);
-  const char *xobject = (textonly_) ? "" : buf2;
+  PDFPendingPage* page = new PDFPendingPage;
+  ResultWriter objects(&page->objects);
+  page->starts_tree_node = starts_tree_node;
+  page->first_image_objnum = page_obj + 2;
+  STRING image_ops;
+  if (textonly_) {
+    AppendDrawImage(0, 0, width, height, 0, false, &image_ops);
+  } else if (!mrc) {
+    page->num_images = 1;
+    AppendDrawImage(0, 0, width, height, 1, false, &image_ops);
+  } else {
+    // The background goes first, the image regions over it and the text
+    // over everything.
+    const PageResults* results = api->GetPageResults();
+    const GenericVector<PageResultsWord>& words = results->words();
+    for (int w = 0; w < words.size() &&
+         page->regions.size() < kMaxMRCRegions; ++w) {
+      if (words[w].starts_block && PTIsImageType(words[w].block_type))
+        page->regions.push_back(words[w].block_box);
+    }
+    api->ReleasePageResults(results);
+    page->num_images = 2 + page->regions.size();
+    AppendDrawImage(0, 0, width, height, 1, false, &image_ops);
+    double scale = 72.0 / ppi;
+    for (int i = 0; i < page->regions.size(); ++i) {
+      const PageResultsBox& region = page->regions[i];
+      AppendDrawImage(region.left * scale, height - region.bottom * scale,
+                      (region.right - region.left) * scale,
+                      (region.bottom - region.top) * scale, i + 3, false,
+                      &image_ops);
+    }
+    AppendDrawImage(0, 0, width, height, 2, true, &image_ops);
+  }
+  STRING xobject;
+  if (page->num_images > 0) {
+    xobject = "/XObject <<";
+    for (int i = 0; i < page->num_images; ++i) {
+      xobject.add_str_int(" /Im", i + 1);
+      xobject.add_str_int(" ", page->first_image_objnum + i);
+      xobject += " 0 R";
+    }
+    xobject += " >>\n";
+  }
 
   // PAGE
   n = snprintf(buf, sizeof(buf),
@@ -881,85 +1504,134 @@ bool TessPDFRenderer::AddImageHandler(TessBaseAPI* api) {
                "  >>\n"
                ">>\n"
                "endobj\n",
-               obj_,
-               2L,  // Pages object
+               page_obj,
+               parent_obj,  // Pages object
                width, height,
-               obj_ + 1,  // Contents object
-               xobject,   // Image object
-               3L);       // Type0 Font
-  if (n >= sizeof(buf)) return false;
-  pages_.push_back(obj_);
-  AppendPDFObject(buf);
+               page_obj + 1,  // Contents object
+               xobject.string(),  // Image objects
+               3L);           // Type0 Font
+  if (n >= sizeof(buf)) {
+    pixDestroy(&bw);
+    delete page;
+    return false;
+  }
+  pages_.push_back(page_obj);
+  if (starts_tree_node)
+    page_tree_nodes_.push_back(parent_obj);
+  objects.Add(buf);
+  page->page_size = page->objects.size();
 
   // CONTENTS
-  char* pdftext = GetPDFTextObjects(api, width, height);
+  char* pdftext = GetPDFTextObjects(api, width, height,
+                                    image_ops.string());
   long pdftext_len = strlen(pdftext);
   unsigned char *pdftext_casted = reinterpret_cast<unsigned char *>(pdftext);
   size_t len;
   unsigned char *comp_pdftext =
-      zlibCompress(pdftext_casted, pdftext_len, &len);
+      FlateCompress(pdftext_casted, pdftext_len, compression_level_, &len);
+  if (comp_pdftext == NULL) {
+    delete[] pdftext;
+    pixDestroy(&bw);
+    delete page;
+    return false;
+  }
   long comp_pdftext_len = len;
   n = snprintf(buf, sizeof(buf),
                "%ld 0 obj\n"
                "<<\n"
                "  /Length %ld /Filter /FlateDecode\n"
                ">>\n"
-               "stream\n", obj_, comp_pdftext_len);
+               "stream\n", page_obj + 1, comp_pdftext_len);
   if (n >= sizeof(buf)) {
     delete[] pdftext;
     lept_free(comp_pdftext);
+    pixDestroy(&bw);
+    delete page;
     return false;
   }
-  AppendString(buf);
-  long objsize = strlen(buf);
-  AppendData(reinterpret_cast<char *>(comp_pdftext), comp_pdftext_len);
-  objsize += comp_pdftext_len;
+  objects.Add(buf);
+  objects.Add(reinterpret_cast<char *>(comp_pdftext), comp_pdftext_len);
   lept_free(comp_pdftext);
   delete[] pdftext;
-  const char *b2 =
-      "endstream\n"
-      "endobj\n";
-  AppendString(b2);
-  objsize += strlen(b2);
-  AppendPDFObjectDIY(objsize);
+  objects.Add("endstream\n"
+              "endobj\n");
+  page->contents_size = page->objects.size() - page->page_size;
 
-  if (!textonly_) {
-    char *pdf_object = NULL;
-    if (!imageToPDFObj(pix, filename, obj_, &pdf_object, &objsize)) {
-      return false;
+  // IMAGE
+  // Compressing the image takes about as long as the rest of the page, so
+  // it is done on another thread while the next page is recognized, and the
+  // page is written once the image is ready.
+  int max_pending = 0;
+#ifdef HAVE_JBIG2ENC
+  if (jbig2_ != NULL) {
+    // The symbol dictionary is shared by all the pages, so the images are
+    // only made by WriteJBIG2Pages once the document is complete.
+    page->num_images = 1;
+    page->image_width = pixGetWidth(bw);
+    page->image_height = pixGetHeight(bw);
+    page->image_ppi = ppi;
+    jbig2_add_page(jbig2_, bw);
+    pixDestroy(&bw);
+    pending_pages_.push_back(page);
+    return true;
+  }
+#endif
+  if (page->num_images > 0) {
+    // A clone of pix would share its reference count with the caller.
+    page->pix = pixCopy(NULL, pix);
+    page->has_filename = filename != NULL;
+    if (filename != NULL) page->filename = filename;
+    page->mask = bw;
+    if (image_threads_ > 0)
+      StartImageWorkers();
+    if (image_workers_ != NULL && image_workers_->num_threads > 0) {
+      image_workers_->mutex.Lock();
+      image_workers_->queue.push_back(page);
+      image_workers_->mutex.Unlock();
+      image_workers_->work.Signal();
+      max_pending = image_threads_;
+    } else {
+      CompressImages(page);
     }
-    AppendData(pdf_object, objsize);
-    AppendPDFObjectDIY(objsize);
-    delete[] pdf_object;
+  }
+  pending_pages_.push_back(page);
+  while (pending_pages_.size() > max_pending) {
+    if (!WriteFirstPendingPage()) return false;
   }
   return true;
 }
 
 
-bool TessPDFRenderer::EndDocumentHandler() {
+bool TessPDFRenderer::WritePageTreeNode(long int objnum, long int parent,
+                                        const GenericVector<long int>& kids,
+                                        int first_kid, int num_kids,
+                                        int count) {
   size_t n;
   char buf[kBasicBufSize];
-
-  // We reserved the /Pages object number early, so that the /Page
+  // We reserved the page tree object numbers early, so that the /Page
   // objects could refer to their parent. We finally have enough
-  // information to go fill it in. Using lower level calls to manipulate
+  // information to go fill them in. Using lower level calls to manipulate
   // the offset record in two spots, because we are placing objects
   // out of order in the file.
-
-  // PAGES
-  const long int kPagesObjectNumber = 2;
-  offsets_[kPagesObjectNumber] = offsets_.back();  // manipulation #1
+  offsets_[objnum] = offsets_.back();  // manipulation #1
   n = snprintf(buf, sizeof(buf),
                "%ld 0 obj\n"
                "<<\n"
-               "  /Type /Pages\n"
-               "  /Kids [ ", kPagesObjectNumber);
+               "  /Type /Pages\n", objnum);
   if (n >= sizeof(buf)) return false;
   AppendString(buf);
   size_t pages_objsize  = strlen(buf);
-  for (size_t i = 0; i < pages_.size(); i++) {
+  if (parent > 0) {
+    n = snprintf(buf, sizeof(buf), "  /Parent %ld 0 R\n", parent);
+    if (n >= sizeof(buf)) return false;
+    AppendString(buf);
+    pages_objsize += strlen(buf);
+  }
+  AppendString("  /Kids [ ");
+  pages_objsize += strlen("  /Kids [ ");
+  for (int i = 0; i < num_kids; i++) {
     n = snprintf(buf, sizeof(buf),
-                 "%ld 0 R ", pages_[i]);
+                 "%ld 0 R ", kids[first_kid + i]);
     if (n >= sizeof(buf)) return false;
     AppendString(buf);
     pages_objsize += strlen(buf);
@@ -968,11 +1640,118 @@ bool TessPDFRenderer::EndDocumentHandler() {
                "]\n"
                "  /Count %d\n"
                ">>\n"
-               "endobj\n", pages_.size());
+               "endobj\n", count);
   if (n >= sizeof(buf)) return false;
   AppendString(buf);
   pages_objsize += strlen(buf);
   offsets_.back() += pages_objsize;    // manipulation #2
+  return true;
+}
+
+bool TessPDFRenderer::WriteXRefStream() {
+  // The cross-reference stream is the last object, and takes the place of
+  // the xref table and the trailer. Its rows are the type (0 free, 1 in
+  // use), the offset and the generation of each object, in big-endian
+  // fields only as wide as the largest offset needs. Successive offsets
+  // share most of their leading bytes, so the rows are stored as their
+  // difference from the row above (the PNG Up predictor) before the
+  // compression, which makes the table a small fraction of its text size.
+  long int xref_obj = obj_;
+  long int xref_offset = offsets_.back();
+  int offset_bytes = 1;
+  while (offset_bytes < static_cast<int>(sizeof(xref_offset)) &&
+         (xref_offset >> (8 * offset_bytes)) != 0)
+    ++offset_bytes;
+  const int row_bytes = 1 + offset_bytes + 2;
+  GenericVector<unsigned char> table;
+  table.init_to_size((xref_obj + 1) * (row_bytes + 1), 0);
+  unsigned char row[16];
+  unsigned char prev_row[16];
+  memset(prev_row, 0, sizeof(prev_row));
+  unsigned char* out = &table[0];
+  for (long int i = 0; i <= xref_obj; ++i) {
+    long int offset = (i == xref_obj) ? xref_offset : offsets_[i];
+    int generation = 0;
+    row[0] = 1;
+    if (i == 0) {
+      row[0] = 0;
+      offset = 0;
+      generation = 65535;
+    }
+    for (int b = 0; b < offset_bytes; ++b)
+      row[offset_bytes - b] = (offset >> (8 * b)) & 0xff;
+    row[row_bytes - 2] = generation >> 8;
+    row[row_bytes - 1] = generation & 0xff;
+    *out++ = 2;  // PNG Up
+    for (int b = 0; b < row_bytes; ++b)
+      *out++ = row[b] - prev_row[b];
+    memcpy(prev_row, row, row_bytes);
+  }
+  size_t len;
+  unsigned char *comp = FlateCompress(&table[0], table.size(),
+                                      compression_level_, &len);
+  if (comp == NULL) return false;
+  char buf[kBasicBufSize];
+  size_t n = snprintf(buf, sizeof(buf),
+                      "%ld 0 obj\n"
+                      "<<\n"
+                      "  /Type /XRef\n"
+                      "  /Size %ld\n"
+                      "  /W [ 1 %d 2 ]\n"
+                      "  /Root %ld 0 R\n"
+                      "  /Info %ld 0 R\n"
+                      "  /Length %lu /Filter /FlateDecode\n"
+                      "  /DecodeParms << /Columns %d /Predictor 12 >>\n"
+                      ">>\n"
+                      "stream\n",
+                      xref_obj, xref_obj + 1, offset_bytes,
+                      1L,             // catalog
+                      xref_obj - 1,   // info
+                      (unsigned long)len, row_bytes);
+  if (n >= sizeof(buf)) {
+    lept_free(comp);
+    return false;
+  }
+  AppendString(buf);
+  AppendData(reinterpret_cast<char *>(comp), len);
+  lept_free(comp);
+  n = snprintf(buf, sizeof(buf),
+               "endstream\n"
+               "endobj\n"
+               "startxref\n"
+               "%ld\n"
+               "%%%%EOF\n", xref_offset);
+  if (n >= sizeof(buf)) return false;
+  AppendString(buf);
+  return true;
+}
+
+bool TessPDFRenderer::EndDocumentHandler() {
+  size_t n;
+  char buf[kBasicBufSize];
+
+  if (jbig2_ != NULL && !WriteJBIG2Pages()) return false;
+  while (!pending_pages_.empty()) {
+    if (!WriteFirstPendingPage()) return false;
+  }
+  StopImageWorkers();
+
+  // PAGES
+  if (large_document_) {
+    for (int i = 0; i < page_tree_nodes_.size(); ++i) {
+      int first = i * kPagesPerTreeNode;
+      int num_pages = MIN(pages_.size() - first, kPagesPerTreeNode);
+      if (!WritePageTreeNode(page_tree_nodes_[i], kPagesObjectNumber,
+                             pages_, first, num_pages, num_pages))
+        return false;
+    }
+    if (!WritePageTreeNode(kPagesObjectNumber, 0, page_tree_nodes_, 0,
+                           page_tree_nodes_.size(), pages_.size()))
+      return false;
+  } else if (!WritePageTreeNode(kPagesObjectNumber, 0, pages_, 0,
+                                pages_.size(), pages_.size())) {
+    return false;
+  }
 
   // INFO
   STRING utf16_title = "FEFF";  // byte_order_marker
@@ -999,6 +1778,8 @@ bool TessPDFRenderer::EndDocumentHandler() {
   lept_free(datestr);
   if (n >= sizeof(buf)) return false;
   AppendPDFObject(buf);
+  if (large_document_)
+    return WriteXRefStream();
   n = snprintf(buf, sizeof(buf),
                "xref\n"
                "0 %ld\n"
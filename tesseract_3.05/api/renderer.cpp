@@ -26,6 +26,118 @@
 
 namespace tesseract {
 
+/**********************************************************************
+ * Output sinks
+ **********************************************************************/
+TessResultSink::~TessResultSink() {
+}
+
+bool TessResultSink::Flush() {
+  return true;
+}
+
+TessBufferedSink::TessBufferedSink(int buffer_size)
+    : buffer_(new char[buffer_size]),
+      buffer_size_(buffer_size),
+      buffer_used_(0) {
+}
+
+TessBufferedSink::~TessBufferedSink() {
+  delete [] buffer_;
+}
+
+bool TessBufferedSink::Write(const char* data, int len) {
+  if (buffer_used_ + len <= buffer_size_) {
+    memcpy(buffer_ + buffer_used_, data, len);
+    buffer_used_ += len;
+    return true;
+  }
+  if (!Flush()) return false;
+  if (len >= buffer_size_) return WriteBlock(data, len);
+  memcpy(buffer_, data, len);
+  buffer_used_ = len;
+  return true;
+}
+
+bool TessBufferedSink::Flush() {
+  if (buffer_used_ == 0) return true;
+  bool ok = WriteBlock(buffer_, buffer_used_);
+  buffer_used_ = 0;
+  return ok;
+}
+
+TessFileSink::TessFileSink(const char* filename)
+    : TessBufferedSink(kDefaultBufferSize) {
+  Open(filename);
+}
+
+TessFileSink::TessFileSink(const char* filename, int buffer_size)
+    : TessBufferedSink(buffer_size) {
+  Open(filename);
+}
+
+void TessFileSink::Open(const char* filename) {
+  if (strcmp(filename, "-") && strcmp(filename, "stdout")) {
+    fp_ = fopen(filename, "wb");
+  } else {
+    fp_ = stdout;
+  }
+}
+
+TessFileSink::~TessFileSink() {
+  if (fp_ != NULL) {
+    Flush();
+    if (fp_ != stdout) {
+      fclose(fp_);
+    } else {
+      fflush(fp_);
+      clearerr(fp_);
+    }
+  }
+}
+
+bool TessFileSink::WriteBlock(const char* data, int len) {
+  if (fp_ == NULL) return false;
+  int n = fwrite(data, 1, len, fp_);
+  // Pass whole blocks on right away, rather than in stdio's small pieces.
+  return n == len && fflush(fp_) == 0;
+}
+
+TessMemorySink::~TessMemorySink() {
+}
+
+bool TessMemorySink::Write(const char* data, int len) {
+  if (len <= 0) return true;
+  int size = data_.size();
+  // Grow geometrically, as resize_no_init only reserves what it is asked.
+  if (size + len > data_.size_reserved()) {
+    int new_size = 2 * data_.size_reserved();
+    data_.reserve(new_size > size + len ? new_size : size + len);
+  }
+  data_.resize_no_init(size + len);
+  memcpy(&data_[size], data, len);
+  return true;
+}
+
+TessCallbackSink::TessCallbackSink(TessWriteFunc write_func, void* user_data)
+    : TessBufferedSink(kDefaultBufferSize),
+      write_func_(write_func), user_data_(user_data) {
+}
+
+TessCallbackSink::TessCallbackSink(TessWriteFunc write_func, void* user_data,
+                                   int buffer_size)
+    : TessBufferedSink(buffer_size),
+      write_func_(write_func), user_data_(user_data) {
+}
+
+TessCallbackSink::~TessCallbackSink() {
+  Flush();
+}
+
+bool TessCallbackSink::WriteBlock(const char* data, int len) {
+  return (*write_func_)(user_data_, data, len);
+}
+
 /**********************************************************************
  * Base Renderer interface implementation
  **********************************************************************/
@@ -33,24 +145,38 @@ TessResultRenderer::TessResultRenderer(const char *outputbase,
                                        const char* extension)
     : file_extension_(extension),
       title_(""), imagenum_(-1),
-      fout_(stdout),
+      sink_(NULL),
+      owns_sink_(true),
       next_(NULL),
       happy_(true) {
+  TessFileSink* sink;
   if (strcmp(outputbase, "-") && strcmp(outputbase, "stdout")) {
     STRING outfile = STRING(outputbase) + STRING(".") + STRING(file_extension_);
-    fout_ = fopen(outfile.string(), "wb");
-    if (fout_ == NULL) {
-      happy_ = false;
-    }
+    sink = new TessFileSink(outfile.string());
+  } else {
+    sink = new TessFileSink("-");
   }
+  if (!sink->is_open()) {
+    happy_ = false;
+  }
+  sink_ = sink;
+}
+
+TessResultRenderer::TessResultRenderer(TessResultSink* sink,
+                                       const char* extension)
+    : file_extension_(extension),
+      title_(""), imagenum_(-1),
+      sink_(sink),
+      owns_sink_(false),
+      next_(NULL),
+      happy_(sink != NULL) {
 }
 
 TessResultRenderer::~TessResultRenderer() {
-  if (fout_ != NULL) {
-    if (fout_ != stdout)
-      fclose(fout_);
-    else
-      clearerr(fout_);
+  if (owns_sink_) {
+    delete sink_;
+  } else if (sink_ != NULL) {
+    sink_->Flush();
   }
   delete next_;
 }
@@ -82,16 +208,23 @@ bool TessResultRenderer::BeginDocument(const char* title) {
 bool TessResultRenderer::AddImage(TessBaseAPI* api) {
   if (!happy_) return false;
   ++imagenum_;
+  // The first renderer of the chain makes all of them share one walk of
+  // the page results.
+  bool first_in_chain = !api->share_page_results_;
+  if (first_in_chain) api->SharePageResults(true);
   bool ok = AddImageHandler(api);
+  if (!sink_->Flush()) happy_ = false;
   if (next_) {
     ok = next_->AddImage(api) && ok;
   }
+  if (first_in_chain) api->SharePageResults(false);
   return ok;
 }
 
 bool TessResultRenderer::EndDocument() {
   if (!happy_) return false;
   bool ok = EndDocumentHandler();
+  if (!sink_->Flush()) happy_ = false;
   if (next_) {
     ok = next_->EndDocument() && ok;
   }
@@ -103,8 +236,7 @@ void TessResultRenderer::AppendString(const char* s) {
 }
 
 void TessResultRenderer::AppendData(const char* s, int len) {
-  int n = fwrite(s, 1, len, fout_);
-  if (n != len) happy_ = false;
+  if (!sink_->Write(s, len)) happy_ = false;
 }
 
 bool TessResultRenderer::BeginDocumentHandler() {
@@ -123,6 +255,10 @@ TessTextRenderer::TessTextRenderer(const char *outputbase)
     : TessResultRenderer(outputbase, "txt") {
 }
 
+TessTextRenderer::TessTextRenderer(TessResultSink* sink)
+    : TessResultRenderer(sink, "txt") {
+}
+
 bool TessTextRenderer::AddImageHandler(TessBaseAPI* api) {
   char* utf8 = api->GetUTF8Text();
   if (utf8 == NULL) {
@@ -155,6 +291,11 @@ TessHOcrRenderer::TessHOcrRenderer(const char *outputbase, bool font_info)
     font_info_ = font_info;
 }
 
+TessHOcrRenderer::TessHOcrRenderer(TessResultSink* sink, bool font_info)
+    : TessResultRenderer(sink, "hocr") {
+    font_info_ = font_info;
+}
+
 bool TessHOcrRenderer::BeginDocumentHandler() {
   AppendString(
       "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
@@ -188,11 +329,10 @@ bool TessHOcrRenderer::EndDocumentHandler() {
 }
 
 bool TessHOcrRenderer::AddImageHandler(TessBaseAPI* api) {
-  char* hocr = api->GetHOCRText(imagenum());
-  if (hocr == NULL) return false;
+  page_text_.truncate(0);
+  if (!api->WriteHOCRText(NULL, imagenum(), &page_text_)) return false;
 
-  AppendString(hocr);
-  delete[] hocr;
+  AppendData(&page_text_[0], page_text_.size());
 
   return true;
 }
@@ -210,6 +350,11 @@ TessTsvRenderer::TessTsvRenderer(const char* outputbase, bool font_info)
   font_info_ = font_info;
 }
 
+TessTsvRenderer::TessTsvRenderer(TessResultSink* sink, bool font_info)
+    : TessResultRenderer(sink, "tsv") {
+  font_info_ = font_info;
+}
+
 bool TessTsvRenderer::BeginDocumentHandler() {
   // Output TSV column headings
   AppendString(
@@ -221,11 +366,10 @@ bool TessTsvRenderer::BeginDocumentHandler() {
 bool TessTsvRenderer::EndDocumentHandler() { return true; }
 
 bool TessTsvRenderer::AddImageHandler(TessBaseAPI* api) {
-  char* tsv = api->GetTSVText(imagenum());
-  if (tsv == NULL) return false;
+  page_text_.truncate(0);
+  if (!api->WriteTSVText(imagenum(), &page_text_)) return false;
 
-  AppendString(tsv);
-  delete[] tsv;
+  AppendData(&page_text_[0], page_text_.size());
 
   return true;
 }
@@ -237,6 +381,10 @@ TessUnlvRenderer::TessUnlvRenderer(const char *outputbase)
     : TessResultRenderer(outputbase, "unlv") {
 }
 
+TessUnlvRenderer::TessUnlvRenderer(TessResultSink* sink)
+    : TessResultRenderer(sink, "unlv") {
+}
+
 bool TessUnlvRenderer::AddImageHandler(TessBaseAPI* api) {
   char* unlv = api->GetUNLVText();
   if (unlv == NULL) return false;
@@ -254,6 +402,10 @@ TessBoxTextRenderer::TessBoxTextRenderer(const char *outputbase)
     : TessResultRenderer(outputbase, "box") {
 }
 
+TessBoxTextRenderer::TessBoxTextRenderer(TessResultSink* sink)
+    : TessResultRenderer(sink, "box") {
+}
+
 bool TessBoxTextRenderer::AddImageHandler(TessBaseAPI* api) {
   char* text = api->GetBoxText(imagenum());
   if (text == NULL) return false;
@@ -270,6 +422,9 @@ bool TessBoxTextRenderer::AddImageHandler(TessBaseAPI* api) {
 TessOsdRenderer::TessOsdRenderer(const char* outputbase)
     : TessResultRenderer(outputbase, "osd") {}
 
+TessOsdRenderer::TessOsdRenderer(TessResultSink* sink)
+    : TessResultRenderer(sink, "osd") {}
+
 bool TessOsdRenderer::AddImageHandler(TessBaseAPI* api) {
   char* osd = api->GetOsdText(imagenum());
   if (osd == NULL) return false;
@@ -25,9 +25,121 @@
 #include "platform.h"
 #include "publictypes.h"
 
+struct jbig2ctx;
+
 namespace tesseract {
 
 class TessBaseAPI;
+struct PDFPendingPage;
+struct PDFImageWorkers;
+
+/**
+ * Destination of the bytes produced by a TessResultRenderer. By default a
+ * renderer writes to a file (or stdout) through a TessFileSink, but it can
+ * be given any sink instead, such as a TessMemorySink to keep the output
+ * in memory or a TessCallbackSink to hand it to the caller as it is made.
+ */
+class TESS_API TessResultSink {
+ public:
+  virtual ~TessResultSink();
+
+  // Writes len bytes of data. Returns false if they could not be written.
+  virtual bool Write(const char* data, int len) = 0;
+
+  // Writes out anything that the sink has buffered. The renderers flush
+  // their sink after each image and at the end of the document.
+  virtual bool Flush();
+};
+
+/**
+ * Base class of the sinks that collect small writes into large blocks and
+ * pass each block to WriteBlock, so that output made of many small strings
+ * (hOCR, TSV, PDF text) turns into a few large writes.
+ */
+class TESS_API TessBufferedSink : public TessResultSink {
+ public:
+  // Default size of the blocks passed to WriteBlock.
+  static const int kDefaultBufferSize = 256 * 1024;
+
+  explicit TessBufferedSink(int buffer_size);
+  virtual ~TessBufferedSink();
+
+  virtual bool Write(const char* data, int len);
+  virtual bool Flush();
+
+ protected:
+  // Writes out a block of data. Returns false on error.
+  virtual bool WriteBlock(const char* data, int len) = 0;
+
+ private:
+  char* buffer_;
+  int buffer_size_;
+  int buffer_used_;
+};
+
+/**
+ * Writes to a file, or to stdout if the filename is "-" or "stdout".
+ */
+class TESS_API TessFileSink : public TessBufferedSink {
+ public:
+  explicit TessFileSink(const char* filename);
+  TessFileSink(const char* filename, int buffer_size);
+  virtual ~TessFileSink();
+
+  // Returns false if the file could not be opened.
+  bool is_open() const { return fp_ != NULL; }
+
+ protected:
+  virtual bool WriteBlock(const char* data, int len);
+
+ private:
+  void Open(const char* filename);
+
+  FILE* fp_;
+};
+
+/**
+ * Keeps all the output in memory, e.g. to send a PDF or hOCR document
+ * somewhere without going through a temporary file.
+ */
+class TESS_API TessMemorySink : public TessResultSink {
+ public:
+  TessMemorySink() {}
+  virtual ~TessMemorySink();
+
+  virtual bool Write(const char* data, int len);
+
+  // The output so far. Not '\0' terminated.
+  const char* data() const { return data_.empty() ? "" : &data_[0]; }
+  int size() const { return data_.size(); }
+  // Discards the output so far, e.g. once it has been sent.
+  void Clear() { data_.truncate(0); }
+
+ private:
+  GenericVector<char> data_;
+};
+
+/**
+ * Passes the output in blocks to a function given by the caller, e.g. to
+ * stream it over a socket. The function returns false on error, which makes
+ * the renderer fail.
+ */
+typedef bool (*TessWriteFunc)(void* user_data, const char* data, int len);
+
+class TESS_API TessCallbackSink : public TessBufferedSink {
+ public:
+  TessCallbackSink(TessWriteFunc write_func, void* user_data);
+  TessCallbackSink(TessWriteFunc write_func, void* user_data,
+                   int buffer_size);
+  virtual ~TessCallbackSink();
+
+ protected:
+  virtual bool WriteBlock(const char* data, int len);
+
+ private:
+  TessWriteFunc write_func_;
+  void* user_data_;
+};
 
 /**
  * Interface for rendering tesseract results into a document, such as text,
@@ -104,6 +216,11 @@ class TESS_API TessResultRenderer {
      */
     TessResultRenderer(const char *outputbase,
                        const char* extension);
+    /**
+     * Writes the output to the given sink, which must outlive the renderer
+     * and is not deleted by it.
+     */
+    TessResultRenderer(TessResultSink* sink, const char* extension);
 
     // Hook for specialized handling in BeginDocument()
     virtual bool BeginDocumentHandler();
@@ -130,7 +247,8 @@ class TESS_API TessResultRenderer {
     STRING title_;                // title of document being renderered
     int imagenum_;                // index of last image added
 
-    FILE* fout_;                  // output file pointer
+    TessResultSink* sink_;        // where the output goes
+    bool owns_sink_;              // sink_ was made from the outputbase
     TessResultRenderer* next_;    // Can link multiple renderers together
     bool happy_;                  // I get grumpy when the disk fills up, etc.
 };
@@ -141,6 +259,7 @@ class TESS_API TessResultRenderer {
 class TESS_API TessTextRenderer : public TessResultRenderer {
  public:
   explicit TessTextRenderer(const char *outputbase);
+  explicit TessTextRenderer(TessResultSink* sink);
 
  protected:
   virtual bool AddImageHandler(TessBaseAPI* api);
@@ -153,6 +272,7 @@ class TESS_API TessHOcrRenderer : public TessResultRenderer {
  public:
   explicit TessHOcrRenderer(const char *outputbase, bool font_info);
   explicit TessHOcrRenderer(const char *outputbase);
+  TessHOcrRenderer(TessResultSink* sink, bool font_info);
 
  protected:
   virtual bool BeginDocumentHandler();
@@ -161,6 +281,7 @@ class TESS_API TessHOcrRenderer : public TessResultRenderer {
 
  private:
   bool font_info_;  // whether to print font information
+  GenericVector<char> page_text_;  // hOCR of a page, reused for every page
 };
 
 /**
@@ -170,6 +291,7 @@ class TESS_API TessTsvRenderer : public TessResultRenderer {
  public:
   explicit TessTsvRenderer(const char* outputbase, bool font_info);
   explicit TessTsvRenderer(const char* outputbase);
+  TessTsvRenderer(TessResultSink* sink, bool font_info);
 
  protected:
   virtual bool BeginDocumentHandler();
@@ -178,6 +300,7 @@ class TESS_API TessTsvRenderer : public TessResultRenderer {
 
  private:
   bool font_info_;              // whether to print font information
+  GenericVector<char> page_text_;  // rows of a page, reused for every page
 };
 
 /**
@@ -189,6 +312,63 @@ class TESS_API TessPDFRenderer : public TessResultRenderer {
   // we load a custom PDF font from this location.
   TessPDFRenderer(const char* outputbase, const char* datadir);
   TessPDFRenderer(const char* outputbase, const char* datadir, bool textonly);
+  TessPDFRenderer(TessResultSink* sink, const char* datadir, bool textonly);
+  virtual ~TessPDFRenderer();
+
+  // Sets the number of threads that compress the page images while the next
+  // pages are recognized, and so the number of pages that may wait for
+  // them. The threads are started with the first page and stopped by
+  // EndDocument. 0, or threads that can not be started, compress each image
+  // before AddImage returns. The pages are written in order either way.
+  void set_image_threads(int image_threads) {
+    image_threads_ = image_threads;
+  }
+
+  // Sets whether the page images are the thresholded pages compressed as
+  // JBIG2, with one symbol dictionary shared by all the pages of the
+  // document. The pages are then only written by EndDocument. Needs
+  // tesseract to be built with jbig2enc, and has no effect otherwise.
+  void set_jbig2_images(bool jbig2_images);
+
+  // Sets whether colour and grey pages are written as mixed raster content:
+  // a low resolution background, the image regions of the page layout at
+  // full resolution, and the thresholded page as a mask over them that
+  // keeps the text sharp. Much smaller than the full page image, at some
+  // cost in the fidelity of the non-text parts of the page. Bilevel pages
+  // and JBIG2 images are not affected.
+  void set_mrc_images(bool mrc_images) {
+    mrc_images_ = mrc_images;
+  }
+
+  // Sets whether the document is laid out for very many pages: the pages
+  // are grouped under intermediate nodes of the page tree, and the document
+  // ends with a compressed cross-reference stream instead of an xref table,
+  // which needs a PDF 1.5 reader.
+  void set_large_document(bool large_document) {
+    large_document_ = large_document;
+  }
+
+  // Sets whether the invisible text layer is written compactly: the words
+  // of a textline are shown by one TJ with a single horizontal stretch,
+  // and placed by the displacements between them, instead of each word
+  // having its own Td, Tz and TJ. Every word still starts where it is on
+  // the page, but its glyphs may end slightly before or after it.
+  void set_compact_text(bool compact_text) {
+    compact_text_ = compact_text;
+  }
+
+  // Sets the zlib compression level (0-9, -1 for the default) of the
+  // streams that the renderer compresses itself: the page contents, the
+  // CIDToGIDMap and the xref stream. Other levels are clamped to that range.
+  // The images are compressed by leptonica. Needs tesseract to be built with
+  // zlib, and has no effect otherwise.
+  void set_compression_level(int compression_level) {
+    if (compression_level < -1)
+      compression_level = -1;
+    else if (compression_level > 9)
+      compression_level = 9;
+    compression_level_ = compression_level;
+  }
 
  protected:
   virtual bool BeginDocumentHandler();
@@ -204,17 +384,58 @@ class TESS_API TessPDFRenderer : public TessResultRenderer {
   long int obj_;                     // counter for PDF objects
   GenericVector<long int> offsets_;  // offset of every PDF object in bytes
   GenericVector<long int> pages_;    // object number for every /Page object
+  // Object numbers of the intermediate page tree nodes of a large document,
+  // each the parent of kPagesPerTreeNode pages in order.
+  GenericVector<long int> page_tree_nodes_;
   const char *datadir_;              // where to find the custom font
   bool textonly_;                    // skip images if set
+  int image_threads_;                // max images compressed in background
+  bool jbig2_images_;                // compress thresholded images as JBIG2
+  bool mrc_images_;                  // split images into background and mask
+  bool large_document_;              // page tree nodes and xref stream
+  bool compact_text_;                // one TJ per textline in the text layer
+  int compression_level_;            // zlib level of the streams
+  jbig2ctx* jbig2_;                  // the JBIG2 encoder of the document
+  // Pages waiting for their image to be compressed, in page order. Their
+  // object numbers are taken but they are not in offsets_ yet.
+  GenericVector<PDFPendingPage*> pending_pages_;
+  // The threads that compress the images of the pending pages, or NULL.
+  PDFImageWorkers* image_workers_;
   // Bookkeeping only. DIY = Do It Yourself.
   void AppendPDFObjectDIY(size_t objectsize);
   // Bookkeeping + emit data.
   void AppendPDFObject(const char *data);
-  // Create the /Contents object for an entire page.
-  char* GetPDFTextObjects(TessBaseAPI* api, double width, double height);
-  // Turn an image into a PDF object. Only transcode if we have to.
-  static bool imageToPDFObj(Pix *pix, char *filename, long int objnum,
-                          char **pdf_object, long int *pdf_object_size);
+  // Create the /Contents object for an entire page, which starts with the
+  // given operators that paint its images.
+  char* GetPDFTextObjects(TessBaseAPI* api, double width, double height,
+                          const char* image_ops);
+  // Turn an image into a PDF object, appended to pdf_object. Only transcode
+  // if we have to.
+  static bool imageToPDFObj(Pix *pix, const char *filename, long int objnum,
+                            GenericVector<char>* pdf_object);
+  // Makes the image objects of a PDFPendingPage and signals that it is done.
+  static void CompressImages(PDFPendingPage* page);
+  // Thread body that compresses the pages queued for a PDFImageWorkers.
+  static void* ImageWorkerThread(void* arg);
+  // Starts image worker threads up to image_threads_.
+  void StartImageWorkers();
+  // Stops the image worker threads. There must be no queued pages left.
+  void StopImageWorkers();
+  // Writes the page tree node with the given reserved object number, which
+  // has num_kids kids from kids[first_kid] on and count pages under it. The
+  // root has no parent (0).
+  bool WritePageTreeNode(long int objnum, long int parent,
+                         const GenericVector<long int>& kids, int first_kid,
+                         int num_kids, int count);
+  // Ends the document with a cross-reference stream, which holds the
+  // offsets of all the objects as compressed binary.
+  bool WriteXRefStream();
+  // Writes out the oldest pending page once its image is ready.
+  bool WriteFirstPendingPage();
+  // Makes the JBIG2 images of all the pending pages, which can only be done
+  // once every page has been added, and writes out the pages followed by
+  // their symbol dictionary.
+  bool WriteJBIG2Pages();
 };
 
 
@@ -224,6 +445,7 @@ class TESS_API TessPDFRenderer : public TessResultRenderer {
 class TESS_API TessUnlvRenderer : public TessResultRenderer {
  public:
   explicit TessUnlvRenderer(const char *outputbase);
+  explicit TessUnlvRenderer(TessResultSink* sink);
 
  protected:
   virtual bool AddImageHandler(TessBaseAPI* api);
@@ -235,6 +457,7 @@ class TESS_API TessUnlvRenderer : public TessResultRenderer {
 class TESS_API TessBoxTextRenderer : public TessResultRenderer {
  public:
   explicit TessBoxTextRenderer(const char *outputbase);
+  explicit TessBoxTextRenderer(TessResultSink* sink);
 
  protected:
   virtual bool AddImageHandler(TessBaseAPI* api);
@@ -246,6 +469,7 @@ class TESS_API TessBoxTextRenderer : public TessResultRenderer {
 class TESS_API TessOsdRenderer : public TessResultRenderer {
  public:
   explicit TessOsdRenderer(const char* outputbase);
+  explicit TessOsdRenderer(TessResultSink* sink);
 
  protected:
   virtual bool AddImageHandler(TessBaseAPI* api);
@@ -28,6 +28,7 @@
 #include "baseapi.h"
 #include "basedir.h"
 #include "dict.h"
+#include "ocrserver.h"
 #include "openclwrapper.h"
 #include "osdetect.h"
 #include "renderer.h"
@@ -103,8 +104,10 @@ void PrintUsage(const char* program) {
       "  %s --help | --help-psm | --help-oem | --version\n"
       "  %s --list-langs [--tessdata-dir PATH]\n"
       "  %s --print-parameters [options...] [configfile...]\n"
-      "  %s imagename|stdin outputbase|stdout [options...] [configfile...]\n",
-      program, program, program, program);
+      "  %s imagename|stdin outputbase|stdout [options...] [configfile...]\n"
+      "  %s --serve SOCKET [--serve-threads NUM] [--serve-langs LANGS]\n"
+      "      [options...] [configfile...]\n",
+      program, program, program, program, program);
 }
 
 void PrintHelpForPSM() {
@@ -170,6 +173,15 @@ void PrintHelpMessage(const char* program) {
       "  --print-parameters    Print tesseract parameters to stdout.\n";
 
   printf("\n%s", single_options);
+
+  const char* serve_options =
+      "Server options:\n"
+      "  --serve SOCKET        Keep the engines loaded and take OCR jobs over\n"
+      "                        the Unix domain socket SOCKET until stopped.\n"
+      "  --serve-threads NUM   Recognize up to NUM jobs at once (default 1).\n"
+      "  --serve-langs LANGS   Also serve jobs in the comma-separated LANGS.\n";
+
+  printf("\n%s", serve_options);
 }
 
 void SetVariablesFromCLArgs(tesseract::TessBaseAPI* api, int argc,
@@ -196,6 +208,25 @@ void SetVariablesFromCLArgs(tesseract::TessBaseAPI* api, int argc,
   }
 }
 
+// Adds the -c VAR=VALUE arguments to the variables given to Init, for the
+// engines of the server, which are not made here.
+void AddVariablesFromCLArgs(int argc, char** argv,
+                            GenericVector<STRING>* vars_vec,
+                            GenericVector<STRING>* vars_values) {
+  for (int i = 0; i + 1 < argc; i++) {
+    if (strcmp(argv[i], "-c") == 0) {
+      const char* p = strchr(argv[i + 1], '=');
+      if (!p) {
+        fprintf(stderr, "Missing = in configvar assignment\n");
+        exit(1);
+      }
+      vars_vec->push_back(STRING(argv[i + 1], p - argv[i + 1]));
+      vars_values->push_back(p + 1);
+      ++i;
+    }
+  }
+}
+
 void PrintLangsList(tesseract::TessBaseAPI* api) {
   GenericVector<STRING> languages;
   api->GetAvailableLanguagesAsVector(&languages);
@@ -236,6 +267,8 @@ void FixPageSegMode(tesseract::TessBaseAPI* api,
 void ParseArgs(const int argc, char** argv, const char** lang,
                const char** image, const char** outputbase,
                const char** datapath, bool* list_langs, bool* print_parameters,
+               const char** serve_socket, int* serve_threads,
+               const char** serve_langs,
                GenericVector<STRING>* vars_vec,
                GenericVector<STRING>* vars_values, int* arg_i,
                tesseract::PageSegMode* pagesegmode,
@@ -266,7 +299,10 @@ void ParseArgs(const int argc, char** argv, const char** lang,
 
   bool noocr = false;
   int i = 1;
-  while (i < argc && (*outputbase == NULL || argv[i][0] == '-')) {
+  // The server takes no image or outputbase, so only the configfiles
+  // follow its options.
+  while (i < argc && ((*outputbase == NULL && *serve_socket == NULL) ||
+                      argv[i][0] == '-')) {
     if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
       *lang = argv[i + 1];
       ++i;
@@ -295,6 +331,16 @@ void ParseArgs(const int argc, char** argv, const char** lang,
     } else if (strcmp(argv[i], "--oem") == 0 && i + 1 < argc) {
       *enginemode = static_cast<tesseract::OcrEngineMode>(atoi(argv[i + 1]));
       ++i;
+    } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+      noocr = true;
+      *serve_socket = argv[i + 1];
+      ++i;
+    } else if (strcmp(argv[i], "--serve-threads") == 0 && i + 1 < argc) {
+      *serve_threads = atoi(argv[i + 1]);
+      ++i;
+    } else if (strcmp(argv[i], "--serve-langs") == 0 && i + 1 < argc) {
+      *serve_langs = argv[i + 1];
+      ++i;
     } else if (strcmp(argv[i], "--print-parameters") == 0) {
       noocr = true;
       *print_parameters = true;
@@ -350,8 +396,27 @@ void PreloadRenderers(
     if (b) {
       bool textonly;
       api->GetBoolVariable("textonly_pdf", &textonly);
-      renderers->push_back(new tesseract::TessPDFRenderer(
-          outputbase, api->GetDatapath(), textonly));
+      tesseract::TessPDFRenderer* pdf_renderer = new tesseract::TessPDFRenderer(
+          outputbase, api->GetDatapath(), textonly);
+      int image_threads;
+      if (api->GetIntVariable("pdf_image_threads", &image_threads))
+        pdf_renderer->set_image_threads(image_threads);
+      bool jbig2;
+      if (api->GetBoolVariable("pdf_jbig2", &jbig2))
+        pdf_renderer->set_jbig2_images(jbig2);
+      bool mrc;
+      if (api->GetBoolVariable("pdf_mrc", &mrc))
+        pdf_renderer->set_mrc_images(mrc);
+      bool large_document;
+      if (api->GetBoolVariable("pdf_large_document", &large_document))
+        pdf_renderer->set_large_document(large_document);
+      bool compact_text;
+      if (api->GetBoolVariable("pdf_compact_text", &compact_text))
+        pdf_renderer->set_compact_text(compact_text);
+      int compression_level;
+      if (api->GetIntVariable("pdf_compression_level", &compression_level))
+        pdf_renderer->set_compression_level(compression_level);
+      renderers->push_back(pdf_renderer);
     }
 
     api->GetBoolVariable("tessedit_write_unlv", &b);
@@ -392,6 +457,9 @@ int main(int argc, char** argv) {
   const char* datapath = NULL;
   bool list_langs = false;
   bool print_parameters = false;
+  const char* serve_socket = NULL;
+  int serve_threads = 1;
+  const char* serve_langs = NULL;
   int arg_i = 1;
   tesseract::PageSegMode pagesegmode = tesseract::PSM_AUTO;
   tesseract::OcrEngineMode enginemode = tesseract::OEM_DEFAULT;
@@ -412,8 +480,8 @@ int main(int argc, char** argv) {
 #endif /* HAVE_TIFFIO_H &&  _WIN32 */
 
   ParseArgs(argc, argv, &lang, &image, &outputbase, &datapath, &list_langs,
-            &print_parameters, &vars_vec, &vars_values, &arg_i, &pagesegmode,
-            &enginemode);
+            &print_parameters, &serve_socket, &serve_threads, &serve_langs,
+            &vars_vec, &vars_values, &arg_i, &pagesegmode, &enginemode);
 
   bool banner = false;
   if (outputbase != NULL && strcmp(outputbase, "-") &&
@@ -428,6 +496,28 @@ int main(int argc, char** argv) {
   // first TessBaseAPI must be destructed, DawgCache must be the last object.
   tesseract::Dict::GlobalDawgCache();
 
+  if (serve_socket != NULL) {
+    if (serve_threads < 1) {
+      fprintf(stderr, "--serve-threads must be at least 1\n");
+      return EXIT_FAILURE;
+    }
+    static tesseract::OcrServerOptions options;
+    options.socket_path = serve_socket;
+    options.num_threads = serve_threads;
+    options.datapath = datapath;
+    options.lang = lang;
+    options.extra_langs = serve_langs;
+    options.enginemode = enginemode;
+    options.pagesegmode = pagesegmode;
+    options.configs = &(argv[arg_i]);
+    options.configs_size = argc - arg_i;
+    options.vars_vec = vars_vec;
+    options.vars_values = vars_values;
+    AddVariablesFromCLArgs(argc, argv, &options.vars_vec,
+                           &options.vars_values);
+    return tesseract::RunOcrServer(options);
+  }
+
   // Avoid memory leak caused by auto variable when exit() is called.
   static tesseract::TessBaseAPI api;
 
@@ -151,6 +151,8 @@ void Tesseract::SetupAllWordsPassN(int pass_n,
   PAGE_RES_IT page_res_it(page_res);
   for (page_res_it.restart_page(); page_res_it.word() != NULL;
        page_res_it.forward()) {
+    if (pass_n > 1 && page_res_it.block()->skip_refinement)
+      continue;
     if (target_word_box == NULL ||
         ProcessTargetWord(page_res_it.word()->word->bounding_box(),
                           *target_word_box, word_config, 1)) {
@@ -269,6 +271,36 @@ bool Tesseract::RecogAllWordsPassN(int pass_n, ETEXT_DESC* monitor,
   return true;
 }
 
+int Tesseract::MarkConfidentBlocks(PAGE_RES* page_res) {
+  int num_marked = 0;
+  BLOCK_RES_IT block_it(&page_res->block_res_list);
+  for (block_it.mark_cycle_pt(); !block_it.cycled_list(); block_it.forward()) {
+    BLOCK_RES* block = block_it.data();
+    bool confident = true;
+    int num_words = 0;
+    ROW_RES_IT row_it(&block->row_res_list);
+    for (row_it.mark_cycle_pt(); confident && !row_it.cycled_list();
+         row_it.forward()) {
+      WERD_RES_IT word_it(&row_it.data()->word_res_list);
+      for (word_it.mark_cycle_pt(); confident && !word_it.cycled_list();
+           word_it.forward()) {
+        WERD_RES* word = word_it.data();
+        if (word->part_of_combo) continue;
+        ++num_words;
+        confident = word->tess_accepted && !word->tess_failed &&
+                    word->best_choice != NULL &&
+                    word->best_choice->certainty() >=
+                        tessedit_early_exit_certainty &&
+                    !word->word->flag(W_FUZZY_SP) &&
+                    !word->word->flag(W_FUZZY_NON);
+      }
+    }
+    block->skip_refinement = confident && num_words > 0;
+    if (block->skip_refinement) ++num_marked;
+  }
+  return num_marked;
+}
+
 /**
  * recog_all_words()
  *
@@ -367,6 +399,13 @@ bool Tesseract::recog_all_words(PAGE_RES* page_res,
 
   if (dopasses == 1) return true;
 
+  stats_.early_exit_blocks = 0;
+  stats_.pass2_words = 0;
+  stats_.fuzzy_space_words = 0;
+  stats_.dict_correction_words = 0;
+  if (tessedit_early_exit && AnyTessLang())
+    stats_.early_exit_blocks = MarkConfidentBlocks(page_res);
+
   // ****************** Pass 2 *******************
   if (tessedit_tess_adaption_mode != 0x0 && !tessedit_test_adaption &&
       AnyTessLang()) {
@@ -376,6 +415,7 @@ bool Tesseract::recog_all_words(PAGE_RES* page_res,
     if (tessedit_parallelize) {
       PrerecAllWordsPar(words);
     }
+    stats_.pass2_words = words.size();
     most_recently_used_ = this;
     // Run pass 2 word recognition.
     if (!RecogAllWordsPassN(2, monitor, &page_res_it, &words)) return false;
@@ -416,6 +456,13 @@ bool Tesseract::recog_all_words(PAGE_RES* page_res,
     blamer_pass(page_res);
     script_pos_pass(page_res);
   }
+  if (tessedit_pass_stats) {
+    tprintf("Pass stats: %d words, %d blocks skipped after pass 1,"
+            " pass 2: %d words, fuzzy spaces: %d words,"
+            " dictionary correction: %d words\n",
+            stats_.word_count, stats_.early_exit_blocks, stats_.pass2_words,
+            stats_.fuzzy_space_words, stats_.dict_correction_words);
+  }
 
   // Write results pass.
   set_global_loc_code(LOC_WRITE_RESULTS);
@@ -2021,6 +2068,9 @@ void Tesseract::dictionary_correction_pass(PAGE_RES *page_res) {
   PAGE_RES_IT word_it(page_res);
   for (WERD_RES* word = word_it.word(); word != NULL;
        word = word_it.forward()) {
+    if (word_it.block()->skip_refinement)
+      continue;  // Confident in pass 1.
+    ++stats_.dict_correction_words;
     if (word->best_choices.singleton())
       continue;  // There are no alternates.
 
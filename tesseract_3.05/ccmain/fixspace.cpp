@@ -62,6 +62,8 @@ void Tesseract::fix_fuzzy_spaces(ETEXT_DESC *monitor,
   word_index = 0;
   for (block_res_it.mark_cycle_pt(); !block_res_it.cycled_list();
        block_res_it.forward()) {
+    if (block_res_it.data()->skip_refinement)
+      continue;  // Confident in pass 1.
     row_res_it.set_to_list(&block_res_it.data()->row_res_list);
     for (row_res_it.mark_cycle_pt(); !row_res_it.cycled_list();
          row_res_it.forward()) {
@@ -76,6 +78,7 @@ void Tesseract::fix_fuzzy_spaces(ETEXT_DESC *monitor,
                          block_res_it.data()->block);
           word_res = word_res_it_from.forward();
           word_index++;
+          ++stats_.fuzzy_space_words;
           if (monitor != NULL) {
             monitor->ocr_alive = TRUE;
             monitor->progress = 90 + 5 * word_index / word_count;
@@ -94,6 +97,7 @@ void Tesseract::fix_fuzzy_spaces(ETEXT_DESC *monitor,
             debug_fix_space_level.set_value(10);
           word_res_it_to.forward();
           word_index++;
+          ++stats_.fuzzy_space_words;
           if (monitor != NULL) {
             monitor->ocr_alive = TRUE;
             monitor->progress = 90 + 5 * word_index / word_count;
@@ -120,6 +124,8 @@ void Tesseract::fix_fuzzy_spaces(ETEXT_DESC *monitor,
           } else {
             fuzzy_space_words.assign_to_sublist(&word_res_it_from,
                                                 &word_res_it_to);
+            // The first word of the run has already been counted.
+            stats_.fuzzy_space_words += fuzzy_space_words.length() - 1;
             fix_fuzzy_space_list(fuzzy_space_words,
                                  row_res_it.data()->row,
                                  block_res_it.data()->block);
@@ -136,6 +142,7 @@ void Tesseract::fix_fuzzy_spaces(ETEXT_DESC *monitor,
         }
         fix_sp_fp_word(word_res_it_from, row_res_it.data()->row,
                        block_res_it.data()->block);
+        ++stats_.fuzzy_space_words;
         // Last word in row
       }
     }
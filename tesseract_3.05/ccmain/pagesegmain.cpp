@@ -176,6 +176,36 @@ int Tesseract::SegmentPage(const STRING* input_file, BLOCK_LIST* blocks,
   return auto_page_seg_ret_val;
 }
 
+// Segments each of the given blocks, which cover regions of the thresholded
+// image, on its own according to tessedit_pageseg_mode, which must be a mode
+// without layout analysis. Used to recognize many small regions of a page
+// in a single pass. Returns -1 on error.
+int Tesseract::SegmentBlocks(BLOCK_LIST* blocks) {
+  ASSERT_HOST(pix_binary_ != NULL);
+  PageSegMode pageseg_mode = static_cast<PageSegMode>(
+      static_cast<int>(tessedit_pageseg_mode));
+  if (PSM_OSD_ENABLED(pageseg_mode) || PSM_BLOCK_FIND_ENABLED(pageseg_mode) ||
+      PSM_SPARSE(pageseg_mode) || pageseg_mode == PSM_CIRCLE_WORD) {
+    tprintf("Page segmentation mode %d can't be used on separate blocks\n",
+            pageseg_mode);
+    return -1;
+  }
+  if (blocks->empty())
+    return 0;
+  deskew_ = FCOORD(1.0f, 0.0f);
+  reskew_ = FCOORD(1.0f, 0.0f);
+  bool splitting =
+      pageseg_devanagari_split_strategy != ShiroRekhaSplitter::NO_SPLIT;
+  bool cjk_mode = textord_use_cjk_fp_model;
+  BLOBNBOX_LIST diacritic_blobs;
+  TO_BLOCK_LIST to_blocks;
+  textord_.TextordPage(pageseg_mode, reskew_, pixGetWidth(pix_binary_),
+                       pixGetHeight(pix_binary_), pix_binary_,
+                       pix_thresholds_, pix_grey_, splitting || cjk_mode,
+                       &diacritic_blobs, blocks, &to_blocks);
+  return 0;
+}
+
 // Helper writes a grey image to a file for use by scrollviewer.
 // Normally for speed we don't display the image in the layout debug windows.
 // If textord_debug_images is true, we draw the image as a background to some
@@ -54,6 +54,12 @@ bool ResultIterator::ParagraphIsLtr() const {
   return current_paragraph_is_ltr_;
 }
 
+int ResultIterator::SpacesBeforeWord() const {
+  if (it_->word() == NULL) return 0;
+  if (preserve_interword_spaces_) return it_->word()->word->space();
+  return IsAtBeginningOf(RIL_TEXTLINE) ? 0 : 1;
+}
+
 bool ResultIterator::CurrentParagraphIsLtr() const {
   if (!it_->word())
     return true;  // doesn't matter.
@@ -556,44 +562,49 @@ bool ResultIterator::IsAtFinalElement(PageIteratorLevel level,
 char* ResultIterator::GetUTF8Text(PageIteratorLevel level) const {
   if (it_->word() == NULL) return NULL;  // Already at the end!
   STRING text;
+  AppendUTF8Text(level, &text);
+  int length = text.length() + 1;
+  char* result = new char[length];
+  strncpy(result, text.string(), length);
+  return result;
+}
+
+void ResultIterator::AppendUTF8Text(PageIteratorLevel level,
+                                    STRING* text) const {
+  if (it_->word() == NULL) return;  // Already at the end!
   switch (level) {
     case RIL_BLOCK:
       {
         ResultIterator pp(*this);
         do {
-          pp.AppendUTF8ParagraphText(&text);
+          pp.AppendUTF8ParagraphText(text);
         } while (pp.Next(RIL_PARA) && pp.it_->block() == it_->block());
       }
       break;
     case RIL_PARA:
-      AppendUTF8ParagraphText(&text);
+      AppendUTF8ParagraphText(text);
       break;
     case RIL_TEXTLINE:
       {
         ResultIterator it(*this);
         it.MoveToLogicalStartOfTextline();
-        it.IterateAndAppendUTF8TextlineText(&text);
+        it.IterateAndAppendUTF8TextlineText(text);
       }
       break;
     case RIL_WORD:
-      AppendUTF8WordText(&text);
+      AppendUTF8WordText(text);
       break;
     case RIL_SYMBOL:
       {
+        // A symbol does not get the direction mark of a minor run that it
+        // starts, only the suffix marks of the word that it ends.
         bool reading_direction_is_ltr =
           current_paragraph_is_ltr_ ^ in_minor_direction_;
-        if (at_beginning_of_minor_run_) {
-          text += reading_direction_is_ltr ? kLRM : kRLM;
-        }
-        text = it_->word()->BestUTF8(blob_index_, !reading_direction_is_ltr);
-        if (IsAtFinalSymbolOfWord()) AppendSuffixMarks(&text);
+        *text += it_->word()->BestUTF8(blob_index_, !reading_direction_is_ltr);
+        if (IsAtFinalSymbolOfWord()) AppendSuffixMarks(text);
       }
       break;
   }
-  int length = text.length() + 1;
-  char* result = new char[length];
-  strncpy(result, text.string(), length);
-  return result;
 }
 
 void ResultIterator::AppendUTF8WordText(STRING *text) const {
@@ -90,12 +90,24 @@ class TESS_API ResultIterator : public LTRResultIterator {
   */
   virtual char* GetUTF8Text(PageIteratorLevel level) const;
 
+  /**
+   * Appends the text that GetUTF8Text returns for the current object at the
+   * given level to text, without allocating a separate string for it.
+   */
+  void AppendUTF8Text(PageIteratorLevel level, STRING* text) const;
+
   /**
    * Return whether the current paragraph's dominant reading direction
    * is left-to-right (as opposed to right-to-left).
   */
   bool ParagraphIsLtr() const;
 
+  /**
+   * Returns the number of spaces that GetUTF8Text puts in front of the
+   * current word in the text of its textline.
+   */
+  int SpacesBeforeWord() const;
+
   // ============= Exposed only for testing =============.
 
   /**
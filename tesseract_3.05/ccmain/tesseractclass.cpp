@@ -156,6 +156,17 @@ Tesseract::Tesseract()
       INT_MEMBER(tessedit_bigram_debug, 0,
                  "Amount of debug output for bigram correction.",
                  this->params()),
+      BOOL_MEMBER(tessedit_early_exit, false,
+                  "Skip pass 2, fuzzy space fixing and dictionary correction"
+                  " on blocks where every word was confidently accepted in"
+                  " pass 1", this->params()),
+      double_MEMBER(tessedit_early_exit_certainty, -2.0,
+                    "Min certainty of every word in a block for"
+                    " tessedit_early_exit to skip its later passes",
+                    this->params()),
+      BOOL_MEMBER(tessedit_pass_stats, false,
+                  "Print the number of words touched by each recognition pass",
+                  this->params()),
       BOOL_MEMBER(enable_noise_removal, true,
                   "Remove and conditionally reassign small outlines when they"
                   " confuse layout analysis, determining diacritics vs noise",
@@ -391,6 +402,28 @@ Tesseract::Tesseract()
                   this->params()),
       BOOL_MEMBER(textonly_pdf, false, "Create PDF with only one invisible text layer",
                   this->params()),
+      INT_MEMBER(pdf_image_threads, 1,
+                 "Threads that compress PDF page images while the next page is"
+                 " recognized (0 = compress in line)", this->params()),
+      BOOL_MEMBER(pdf_jbig2, false,
+                  "Compress the PDF page images as JBIG2, with a symbol"
+                  " dictionary shared by all the pages (needs jbig2enc)",
+                  this->params()),
+      BOOL_MEMBER(pdf_mrc, false,
+                  "Write colour and grey PDF page images as a low resolution"
+                  " background, the image regions and a mask of the text",
+                  this->params()),
+      BOOL_MEMBER(pdf_large_document, false,
+                  "Lay out the PDF for very many pages, with a page tree and"
+                  " a compressed cross-reference stream (PDF 1.5)",
+                  this->params()),
+      BOOL_MEMBER(pdf_compact_text, false,
+                  "Show each textline of the PDF text layer with one TJ",
+                  this->params()),
+      INT_MEMBER(pdf_compression_level, -1,
+                 "zlib level of the PDF page contents, CIDToGIDMap and xref"
+                 " stream (0-9, -1 = default)",
+                 this->params()),
       STRING_MEMBER(unrecognised_char, "|",
                     "Output char for unidentified blobs", this->params()),
       INT_MEMBER(suspect_level, 99, "Suspect marker level", this->params()),
@@ -683,11 +716,13 @@ void Tesseract::SetBlackAndWhitelist() {
   unicharset.set_black_and_whitelist(tessedit_char_blacklist.string(),
                                      tessedit_char_whitelist.string(),
                                      tessedit_char_unblacklist.string());
+  SetupEnabledClasses();
   // Black and white lists should apply to all loaded classifiers.
   for (int i = 0; i < sub_langs_.size(); ++i) {
     sub_langs_[i]->unicharset.set_black_and_whitelist(
         tessedit_char_blacklist.string(), tessedit_char_whitelist.string(),
         tessedit_char_unblacklist.string());
+    sub_langs_[i]->SetupEnabledClasses();
   }
 }
 
@@ -119,6 +119,10 @@ struct TesseractStats {
       doc_good_char_quality(0),
       word_count(0),
       dict_words(0),
+      early_exit_blocks(0),
+      pass2_words(0),
+      fuzzy_space_words(0),
+      dict_correction_words(0),
       tilde_crunch_written(false),
       last_char_was_newline(true),
       last_char_was_tilde(false),
@@ -132,6 +136,11 @@ struct TesseractStats {
   inT16 doc_good_char_quality;
   inT32 word_count;  // count of word in the document
   inT32 dict_words;  // number of dicitionary words in the document
+  // Counts of the work done by the passes after pass 1 on the current page.
+  inT32 early_exit_blocks;      // blocks that skipped the later passes
+  inT32 pass2_words;            // words recognized again in pass 2
+  inT32 fuzzy_space_words;      // words visited by fix_fuzzy_spaces
+  inT32 dict_correction_words;  // words checked by dictionary correction
   STRING dump_words_str;  // accumulator used by dump_words()
   // Flags used by write_results()
   bool tilde_crunch_written;
@@ -286,6 +295,11 @@ class Tesseract : public Wordrec {
 
   int SegmentPage(const STRING* input_file, BLOCK_LIST* blocks,
                   Tesseract* osd_tess, OSResults* osr);
+  // Segments each of the given blocks, which cover regions of the thresholded
+  // image, on its own according to tessedit_pageseg_mode, which must be a mode
+  // without layout analysis. Used to recognize many small regions of a page
+  // in a single pass. Returns -1 on error.
+  int SegmentBlocks(BLOCK_LIST* blocks);
   void SetupWordScripts(BLOCK_LIST* blocks);
   int AutoPageSeg(PageSegMode pageseg_mode, BLOCK_LIST* blocks,
                   TO_BLOCK_LIST* to_blocks, BLOBNBOX_LIST* diacritic_blobs,
@@ -322,6 +336,11 @@ class Tesseract : public Wordrec {
                         const TBOX* target_word_box,
                         const char* word_config);
   void bigram_correction_pass(PAGE_RES *page_res);
+  // Sets skip_refinement on the blocks in which every word was accepted by
+  // the stopper (Dict::AcceptableResult via tess_accepted) in pass 1 with a
+  // certainty of at least tessedit_early_exit_certainty, and no word has a
+  // fuzzy space. Returns the number of blocks marked.
+  int MarkConfidentBlocks(PAGE_RES* page_res);
   void blamer_pass(PAGE_RES* page_res);
   // Sets script positions and detects smallcaps on all output words.
   void script_pos_pass(PAGE_RES* page_res);
@@ -850,6 +869,14 @@ class Tesseract : public Wordrec {
              "Enable single word correction based on the dictionary.");
   INT_VAR_H(tessedit_bigram_debug, 0, "Amount of debug output for bigram "
             "correction.");
+  BOOL_VAR_H(tessedit_early_exit, false,
+             "Skip pass 2, fuzzy space fixing and dictionary correction on"
+             " blocks where every word was confidently accepted in pass 1");
+  double_VAR_H(tessedit_early_exit_certainty, -2.0,
+               "Min certainty of every word in a block for tessedit_early_exit"
+               " to skip its later passes");
+  BOOL_VAR_H(tessedit_pass_stats, false,
+             "Print the number of words touched by each recognition pass");
   BOOL_VAR_H(enable_noise_removal, true,
              "Remove and conditionally reassign small outlines when they"
              " confuse layout analysis, determining diacritics vs noise");
@@ -1010,6 +1037,23 @@ class Tesseract : public Wordrec {
   BOOL_VAR_H(tessedit_create_tsv, false, "Write .tsv output file");
   BOOL_VAR_H(tessedit_create_pdf, false, "Write .pdf output file");
   BOOL_VAR_H(textonly_pdf, false, "Create PDF with only one invisible text layer");
+  INT_VAR_H(pdf_image_threads, 1,
+            "Threads that compress PDF page images while the next page is"
+            " recognized (0 = compress in line)");
+  BOOL_VAR_H(pdf_jbig2, false,
+             "Compress the PDF page images as JBIG2, with a symbol dictionary"
+             " shared by all the pages (needs jbig2enc)");
+  BOOL_VAR_H(pdf_mrc, false,
+             "Write colour and grey PDF page images as a low resolution"
+             " background, the image regions and a mask of the text");
+  BOOL_VAR_H(pdf_large_document, false,
+             "Lay out the PDF for very many pages, with a page tree and a"
+             " compressed cross-reference stream (PDF 1.5)");
+  BOOL_VAR_H(pdf_compact_text, false,
+             "Show each textline of the PDF text layer with one TJ");
+  INT_VAR_H(pdf_compression_level, -1,
+            "zlib level of the PDF page contents, CIDToGIDMap and xref"
+            " stream (0-9, -1 = default)");
   STRING_VAR_H(unrecognised_char, "|",
                "Output char for unidentified blobs");
   INT_VAR_H(suspect_level, 99, "Suspect marker level");
@@ -532,12 +532,15 @@ void TBLOB::plot(ScrollView* window, ScrollView::Color color,
 // 2nd moment normalizations. Returns the outline length.
 // The input denorm should be the normalizations that have been applied from
 // the image to the current state of this TBLOB.
-int TBLOB::ComputeMoments(FCOORD* center, FCOORD* second_moments) const {
+int TBLOB::ComputeMoments(FCOORD* center, FCOORD* second_moments,
+                          TBOX* precise_box) const {
   // Compute 1st and 2nd moments of the original outline.
   LLSQ accumulator;
   TBOX box = bounding_box();
   // Iterate the outlines, accumulating edges relative the box.botleft().
-  CollectEdges(box, NULL, &accumulator, NULL, NULL);
+  if (precise_box != NULL) *precise_box = TBOX();
+  CollectEdges(box, precise_box, &accumulator, NULL, NULL);
+  if (precise_box != NULL) precise_box->move(box.botleft());
   *center = accumulator.mean_point() + box.botleft();
   // The 2nd moments are just the standard deviation of the point positions.
   double x2nd = sqrt(accumulator.x_variance());
@@ -357,7 +357,10 @@ struct TBLOB {
   // 2nd moment normalizations. Returns the outline length.
   // The input denorm should be the normalizations that have been applied from
   // the image to the current state of this TBLOB.
-  int ComputeMoments(FCOORD* center, FCOORD* second_moments) const;
+  // If precise_box is not NULL, it also receives the result of
+  // GetPreciseBoundingBox, computed in the same walk over the edges.
+  int ComputeMoments(FCOORD* center, FCOORD* second_moments,
+                     TBOX* precise_box = NULL) const;
   // Computes the precise bounding box of the coords that are generated by
   // GetEdgeCoords. This may be different from the bounding box of the polygon.
   void GetPreciseBoundingBox(TBOX* precise_box) const;
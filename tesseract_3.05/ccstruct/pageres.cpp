@@ -92,6 +92,7 @@ BLOCK_RES::BLOCK_RES(bool merge_similar_words, BLOCK *the_block) {
   font_assigned = FALSE;
   bold = FALSE;
   italic = FALSE;
+  skip_refinement = FALSE;
   row_count = 0;
 
   block = the_block;
@@ -106,6 +106,9 @@ class BLOCK_RES:public ELIST_LINK {
   //      processed
   BOOL8 bold;                  // all bold
   BOOL8 italic;                // all italic
+  // Set after pass 1 if the block is confident enough to skip the later
+  // recognition passes. See Tesseract::MarkConfidentBlocks.
+  BOOL8 skip_refinement;
 
   ROW_RES_LIST row_res_list;
 
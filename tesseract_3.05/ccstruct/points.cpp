@@ -111,11 +111,32 @@ void ICOORD::setup_render(ICOORD* major_step, ICOORD* minor_step,
 uinT8 FCOORD::to_direction() const {
   return binary_angle_plus_pi(angle());
 }
+
+// Table of the unit vectors of all 256 standard feature directions, as
+// from_direction is called for every outline step in feature extraction.
+// The values are computed exactly as the direct calculation would.
+class DirectionVectorTable {
+ public:
+  DirectionVectorTable() {
+    for (int direction = 0; direction < 256; ++direction) {
+      double radians = FCOORD::angle_from_direction(direction);
+      x_[direction] = cos(radians);
+      y_[direction] = sin(radians);
+    }
+  }
+  float x(uinT8 direction) const { return x_[direction]; }
+  float y(uinT8 direction) const { return y_[direction]; }
+
+ private:
+  float x_[256];
+  float y_[256];
+};
+static const DirectionVectorTable direction_vectors;
+
 // Sets this with a unit vector in the given standard feature direction.
 void FCOORD::from_direction(uinT8 direction) {
-  double radians = angle_from_direction(direction);
-  xcoord = cos(radians);
-  ycoord = sin(radians);
+  xcoord = direction_vectors.x(direction);
+  ycoord = direction_vectors.y(direction);
 }
 
 // Converts an angle in radians (from ICOORD::angle or FCOORD::angle) to a
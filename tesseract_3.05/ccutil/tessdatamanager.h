@@ -47,6 +47,7 @@ static const char kShapeTableFileSuffix[] = "shapetable";
 static const char kBigramDawgFileSuffix[] = "bigram-dawg";
 static const char kUnambigDawgFileSuffix[] = "unambig-dawg";
 static const char kParamsModelFileSuffix[] = "params-model";
+static const char kCharNgramFileSuffix[] = "char-ngram";
 
 namespace tesseract {
 
@@ -68,6 +69,7 @@ enum TessdataType {
   TESSDATA_BIGRAM_DAWG,         // 14
   TESSDATA_UNAMBIG_DAWG,        // 15
   TESSDATA_PARAMS_MODEL,        // 16
+  TESSDATA_CHAR_NGRAM,          // 17
 
   TESSDATA_NUM_ENTRIES
 };
@@ -94,6 +96,7 @@ static const char *const kTessdataFileSuffixes[] = {
     kBigramDawgFileSuffix,        // 14
     kUnambigDawgFileSuffix,       // 15
     kParamsModelFileSuffix,       // 16
+    kCharNgramFileSuffix,         // 17
 };
 
 /**
@@ -118,6 +121,7 @@ static const bool kTessdataFileIsText[] = {
     false,  // 14
     false,  // 15
     true,   // 16
+    false,  // 17
 };
 
 /**
@@ -485,6 +485,8 @@ void Classify::EndAdaptiveClassifier() {
     free_int_templates(PreTrainedTemplates);
     PreTrainedTemplates = NULL;
   }
+  enabled_classes_.truncate(0);
+  enabled_pruners_.truncate(0);
   getDict().EndDangerousAmbigs();
   FreeNormProtos();
   if (AllProtosOn != NULL) {
@@ -1377,6 +1379,32 @@ int Classify::CharNormTrainingSample(bool pruner_only,
   results->clear();
   ADAPT_RESULTS* adapt_results = new ADAPT_RESULTS();
   adapt_results->Initialize();
+  TrainingSampleStages(keep_this, sample,
+                       pruner_only ? TSS_CLASS_PRUNER : TSS_SHAPE_LOOKUP,
+                       adapt_results);
+  if (pruner_only) {
+    // Convert pruner results to output format.
+    for (int i = 0; i < adapt_results->CPResults.size(); ++i) {
+      int class_id = adapt_results->CPResults[i].Class;
+      results->push_back(
+          UnicharRating(class_id, 1.0f - adapt_results->CPResults[i].Rating));
+    }
+  } else {
+    // Convert master matcher results to output format.
+    for (int i = 0; i < adapt_results->match.size(); i++) {
+      results->push_back(adapt_results->match[i]);
+    }
+    results->sort(&UnicharRating::SortDescendingRating);
+  }
+  delete adapt_results;
+  return sample.num_features();
+}                                /* CharNormTrainingSample */
+
+// Runs the stages of CharNormTrainingSample up to and including last_stage.
+void Classify::TrainingSampleStages(int keep_this,
+                                    const TrainingSample& sample,
+                                    TrainingSampleStage last_stage,
+                                    ADAPT_RESULTS* adapt_results) {
   // Compute the bounding box of the features.
   int num_features = sample.num_features();
   // Only the top and bottom of the blob_box are used by MasterMatcher, so
@@ -1394,38 +1422,49 @@ int Classify::CharNormTrainingSample(bool pruner_only,
   ComputeCharNormArrays(norm_feature, PreTrainedTemplates, char_norm_array,
                         pruner_norm_array);
 
-  PruneClasses(PreTrainedTemplates, num_features, keep_this, sample.features(),
-               pruner_norm_array,
-               shape_table_ != NULL ? &shapetable_cutoffs_[0] : CharNormCutoffs,
-               &adapt_results->CPResults);
-  delete [] pruner_norm_array;
-  if (keep_this >= 0) {
-    adapt_results->CPResults[0].Class = keep_this;
-    adapt_results->CPResults.truncate(1);
+  if (last_stage >= TSS_CLASS_PRUNER) {
+    PruneClasses(PreTrainedTemplates, num_features, keep_this,
+                 sample.features(), pruner_norm_array,
+                 shape_table_ != NULL ? &shapetable_cutoffs_[0]
+                                      : CharNormCutoffs,
+                 &adapt_results->CPResults);
+    if (keep_this >= 0) {
+      adapt_results->CPResults[0].Class = keep_this;
+      adapt_results->CPResults.truncate(1);
+    }
   }
-  if (pruner_only) {
-    // Convert pruner results to output format.
-    for (int i = 0; i < adapt_results->CPResults.size(); ++i) {
-      int class_id = adapt_results->CPResults[i].Class;
-      results->push_back(
-          UnicharRating(class_id, 1.0f - adapt_results->CPResults[i].Rating));
+  delete [] pruner_norm_array;
+  if (last_stage == TSS_INT_MATCHER) {
+    // Just the matching part of MasterMatcher.
+    UnicharRating int_result;
+    for (int c = 0; c < adapt_results->CPResults.size(); ++c) {
+      CLASS_ID class_id = adapt_results->CPResults[c].Class;
+      int_result.unichar_id = class_id;
+      im_.Match(ClassForClassId(PreTrainedTemplates, class_id),
+                AllProtosOn, AllConfigsOn, num_features, sample.features(),
+                &int_result, classify_adapt_feature_threshold,
+                matcher_debug_flags, matcher_debug_separate_windows);
     }
-  } else {
+  } else if (last_stage >= TSS_SHAPE_LOOKUP) {
     MasterMatcher(PreTrainedTemplates, num_features, sample.features(),
                   char_norm_array,
                   NULL, matcher_debug_flags,
                   classify_integer_matcher_multiplier,
                   blob_box, adapt_results->CPResults, adapt_results);
-    // Convert master matcher results to output format.
-    for (int i = 0; i < adapt_results->match.size(); i++) {
-      results->push_back(adapt_results->match[i]);
-    }
-    results->sort(&UnicharRating::SortDescendingRating);
   }
   delete [] char_norm_array;
+}
+
+int Classify::TrainingSampleStages(const TrainingSample& sample,
+                                   TrainingSampleStage last_stage) {
+  ADAPT_RESULTS* adapt_results = new ADAPT_RESULTS();
+  adapt_results->Initialize();
+  TrainingSampleStages(-1, sample, last_stage, adapt_results);
+  int num_results = last_stage >= TSS_SHAPE_LOOKUP
+      ? adapt_results->match.size() : adapt_results->CPResults.size();
   delete adapt_results;
-  return num_features;
-}                                /* CharNormTrainingSample */
+  return num_results;
+}
 
 
 /*---------------------------------------------------------------------------*/
@@ -150,6 +150,9 @@ Classify::Classify()
                  "Class Pruner CutoffStrength:         ", this->params()),
       INT_MEMBER(classify_integer_matcher_multiplier, 10,
                  "Integer Matcher Multiplier  0-255:   ", this->params()),
+      BOOL_MEMBER(classify_prune_disabled_classes, true,
+                  "Skip the static classes that can only output characters"
+                  " disabled by a black/whitelist", this->params()),
       EnableLearning(true),
       INT_MEMBER(il1_adaption_test, 0,
                  "Don't adapt to i/I at beginning of word", this->params()),
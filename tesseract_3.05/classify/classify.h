@@ -58,6 +58,15 @@ enum CharSegmentationType {
   CST_NGRAM      // Multiple characters.
 };
 
+// The stages of Classify::CharNormTrainingSample, in the order they run.
+enum TrainingSampleStage {
+  TSS_CHAR_NORM,     // Char norm feature to normalization arrays.
+  TSS_CLASS_PRUNER,  // Class pruner short-list.
+  TSS_INT_MATCHER,   // Integer matcher on the short-listed classes.
+  TSS_SHAPE_LOOKUP,  // Shape table expansion and rating corrections.
+  TSS_COUNT
+};
+
 class Classify : public CCStruct {
  public:
   Classify();
@@ -103,6 +112,10 @@ class Classify : public CCStruct {
                    const uinT8* normalization_factors,
                    const uinT16* expected_num_features,
                    GenericVector<CP_RESULT_STRUCT>* results);
+  // Restricts the static templates used by PruneClasses to the classes that
+  // can output a unichar enabled in the unicharset. Must be called after the
+  // black/whitelist of the unicharset changes.
+  void SetupEnabledClasses();
   void ReadNewCutoffs(FILE *CutoffFile, bool swap, inT64 end_offset,
                       CLASS_CUTOFF_ARRAY Cutoffs);
   void PrintAdaptedTemplates(FILE *File, ADAPT_TEMPLATES Templates);
@@ -251,6 +264,18 @@ class Classify : public CCStruct {
   int CharNormTrainingSample(bool pruner_only, int keep_this,
                              const TrainingSample& sample,
                              GenericVector<UnicharRating>* results);
+  // Runs the stages of CharNormTrainingSample up to and including last_stage
+  // on the given sample, leaving the short-list in adapt_results->CPResults
+  // and, if last_stage is TSS_SHAPE_LOOKUP, the unichar results in
+  // adapt_results->match. Stopping early allows the cost of each stage to be
+  // measured, as by classifier_tester.
+  void TrainingSampleStages(int keep_this, const TrainingSample& sample,
+                            TrainingSampleStage last_stage,
+                            ADAPT_RESULTS* adapt_results);
+  // As above, but for callers that don't need the results. Returns the
+  // number of results output by last_stage.
+  int TrainingSampleStages(const TrainingSample& sample,
+                           TrainingSampleStage last_stage);
   UNICHAR_ID *GetAmbiguities(TBLOB *Blob, CLASS_ID CorrectClass);
   void DoAdaptiveMatch(TBLOB *Blob, ADAPT_RESULTS *Results);
   void AdaptToChar(TBLOB* Blob, CLASS_ID ClassId, int FontinfoId,
@@ -467,6 +492,9 @@ class Classify : public CCStruct {
             "Class Pruner CutoffStrength:         ");
   INT_VAR_H(classify_integer_matcher_multiplier, 10,
             "Integer Matcher Multiplier  0-255:   ");
+  BOOL_VAR_H(classify_prune_disabled_classes, true,
+             "Skip the static classes that can only output characters"
+             " disabled by a black/whitelist");
 
   // Use class variables to hold onto built-in templates and adapted templates.
   INT_TEMPLATES PreTrainedTemplates;
@@ -533,6 +561,12 @@ class Classify : public CCStruct {
   uinT16* CharNormCutoffs;
   uinT16* BaselineCutoffs;
   GenericVector<uinT16> shapetable_cutoffs_;
+  // If some unichars are disabled, enabled_classes_ holds, for each class of
+  // PreTrainedTemplates, whether it can output an enabled unichar, and
+  // enabled_pruners_ the indices of the class pruners that hold an enabled
+  // class. Both are empty when everything is enabled.
+  GenericVector<bool> enabled_classes_;
+  GenericVector<int> enabled_pruners_;
   ScrollView* learn_debug_win_;
   ScrollView* learn_fragmented_word_debug_win_;
   ScrollView* learn_fragments_debug_win_;
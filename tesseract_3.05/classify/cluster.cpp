@@ -22,6 +22,7 @@
 #include "helpers.h"
 #include "kdpair.h"
 #include "matrix.h"
+#include "svutil.h"
 #include "tprintf.h"
 #include "danerror.h"
 #include "freelist.h"
@@ -1877,9 +1878,12 @@ ComputeChiSquared (uinT16 DegreesOfFreedom, FLOAT64 Alpha)
 #define MINALPHA  (1e-200)
 {
   static LIST ChiWith[MAXDEGREESOFFREEDOM + 1];
+  // Protects ChiWith, as the training programs cluster classes in parallel.
+  static SVMutex ChiWithMutex;
 
   CHISTRUCT *OldChiSquared;
   CHISTRUCT SearchKey;
+  SVAutoLock lock(&ChiWithMutex);
 
   // limit the minimum alpha that can be used - if alpha is too small
   //      it may not be possible to compute chi-squared.
@@ -2472,9 +2476,7 @@ MultipleCharSamples (CLUSTERER * Clusterer,
 CLUSTER * Cluster, FLOAT32 MaxIllegal)
 #define ILLEGAL_CHAR    2
 {
-  static BOOL8 *CharFlags = NULL;
-  static inT32 NumFlags = 0;
-  int i;
+  GenericVector<BOOL8> CharFlags;
   LIST SearchState;
   SAMPLE *Sample;
   inT32 CharID;
@@ -2486,15 +2488,7 @@ CLUSTER * Cluster, FLOAT32 MaxIllegal)
   NumCharInCluster = Cluster->SampleCount;
   NumIllegalInCluster = 0;
 
-  if (Clusterer->NumChar > NumFlags) {
-    if (CharFlags != NULL)
-      memfree(CharFlags);
-    NumFlags = Clusterer->NumChar;
-    CharFlags = (BOOL8 *) Emalloc (NumFlags * sizeof (BOOL8));
-  }
-
-  for (i = 0; i < NumFlags; i++)
-    CharFlags[i] = FALSE;
+  CharFlags.init_to_size(Clusterer->NumChar, FALSE);
 
   // find each sample in the cluster and check if we have seen it before
   InitSampleSearch(SearchState, Cluster);
@@ -22,10 +22,27 @@
 
 namespace tesseract {
 
+// Bits of the entries in IntFeatureDist::features_.
+const uinT8 kFeatureBit = 1;
+const uinT8 kDeltaOneBit = 2;
+const uinT8 kDeltaTwoBit = 4;
+// Reduction of the misses for each combination of the above bits: the
+// exact feature takes precedence over the offset ones.
+static const double kMatchWeights[8] = {
+  0.0, 2.0, 1.5, 2.0, 1.0, 2.0, 1.5, 2.0
+};
+
+// Sets or clears the given bits of *entry.
+static inline void SetBits(uinT8 bits, bool value, uinT8* entry) {
+  if (value)
+    *entry |= bits;
+  else
+    *entry &= ~bits;
+}
+
 IntFeatureDist::IntFeatureDist()
   : size_(0), total_feature_weight_(0.0),
-    feature_map_(NULL), features_(NULL),
-    features_delta_one_(NULL), features_delta_two_(NULL) {
+    feature_map_(NULL), features_(NULL) {
 }
 
 IntFeatureDist::~IntFeatureDist() {
@@ -37,12 +54,8 @@ void IntFeatureDist::Init(const IntFeatureMap* feature_map) {
   size_ = feature_map->sparse_size();
   Clear();
   feature_map_ = feature_map;
-  features_ = new bool[size_];
-  features_delta_one_ = new bool[size_];
-  features_delta_two_ = new bool[size_];
-  memset(features_, false, size_ * sizeof(features_[0]));
-  memset(features_delta_one_, false, size_ * sizeof(features_delta_one_[0]));
-  memset(features_delta_two_, false, size_ * sizeof(features_delta_two_[0]));
+  features_ = new uinT8[size_];
+  memset(features_, 0, size_ * sizeof(features_[0]));
   total_feature_weight_ = 0.0;
 }
 
@@ -53,17 +66,17 @@ void IntFeatureDist::Set(const GenericVector<int>& indexed_features,
   total_feature_weight_ = canonical_count;
   for (int i = 0; i < indexed_features.size(); ++i) {
     int f = indexed_features[i];
-    features_[f] = value;
+    SetBits(kFeatureBit, value, &features_[f]);
     for (int dir = -kNumOffsetMaps; dir <= kNumOffsetMaps; ++dir) {
       if (dir == 0) continue;
       int mapped_f = feature_map_->OffsetFeature(f, dir);
       if (mapped_f >= 0) {
-        features_delta_one_[mapped_f] = value;
+        SetBits(kDeltaOneBit, value, &features_[mapped_f]);
         for (int dir2 = -kNumOffsetMaps; dir2 <= kNumOffsetMaps; ++dir2) {
           if (dir2 == 0) continue;
           int mapped_f2 = feature_map_->OffsetFeature(mapped_f, dir2);
           if (mapped_f2 >= 0)
-            features_delta_two_[mapped_f2] = value;
+            SetBits(kDeltaTwoBit, value, &features_[mapped_f2]);
         }
       }
     }
@@ -78,17 +91,8 @@ double IntFeatureDist::FeatureDistance(
   double denominator = total_feature_weight_ + num_test_features;
   double misses = denominator;
   for (int i = 0; i < num_test_features; ++i) {
-    int index = features[i];
-    double weight = 1.0;
-    if (features_[index]) {
-      // A perfect match.
-      misses -= 2.0 * weight;
-    } else if (features_delta_one_[index]) {
-      misses -= 1.5 * weight;
-    } else if (features_delta_two_[index]) {
-      // A near miss.
-      misses -= 1.0 * weight;
-    }
+    // 2 for a perfect match, 1 for a near miss.
+    misses -= kMatchWeights[features_[features[i]]];
   }
   return misses / denominator;
 }
@@ -106,14 +110,14 @@ double IntFeatureDist::DebugFeatureDistance(
     INT_FEATURE_STRUCT f = feature_map_->InverseMapFeature(features[i]);
     tprintf("Testing feature weight %g:", weight);
     f.print();
-    if (features_[index]) {
+    if (features_[index] & kFeatureBit) {
       // A perfect match.
       misses -= 2.0 * weight;
       tprintf("Perfect hit\n");
-    } else if (features_delta_one_[index]) {
+    } else if (features_[index] & kDeltaOneBit) {
       misses -= 1.5 * weight;
       tprintf("-1 hit\n");
-    } else if (features_delta_two_[index]) {
+    } else if (features_[index] & kDeltaTwoBit) {
       // A near miss.
       misses -= 1.0 * weight;
       tprintf("-2 hit\n");
@@ -123,21 +127,21 @@ double IntFeatureDist::DebugFeatureDistance(
   }
   tprintf("Features present:");
   for (int i = 0; i < size_; ++i) {
-    if (features_[i]) {
+    if (features_[i] & kFeatureBit) {
       INT_FEATURE_STRUCT f = feature_map_->InverseMapFeature(i);
       f.print();
     }
   }
   tprintf("\nMinus one features:");
   for (int i = 0; i < size_; ++i) {
-    if (features_delta_one_[i]) {
+    if (features_[i] & kDeltaOneBit) {
       INT_FEATURE_STRUCT f = feature_map_->InverseMapFeature(i);
       f.print();
     }
   }
   tprintf("\nMinus two features:");
   for (int i = 0; i < size_; ++i) {
-    if (features_delta_two_[i]) {
+    if (features_[i] & kDeltaTwoBit) {
       INT_FEATURE_STRUCT f = feature_map_->InverseMapFeature(i);
       f.print();
     }
@@ -150,10 +154,6 @@ double IntFeatureDist::DebugFeatureDistance(
 void IntFeatureDist::Clear() {
   delete [] features_;
   features_ = NULL;
-  delete [] features_delta_one_;
-  features_delta_one_ = NULL;
-  delete [] features_delta_two_;
-  features_delta_two_ = NULL;
 }
 
 }  // namespace tesseract
@@ -29,9 +29,9 @@ class IntFeatureMap;
 // Feature distance calculator designed to provide a fast distance calculation
 // based on set difference between a given feature set and many other feature
 // sets in turn.
-// Representation of a feature set as an array of bools that are sparsely
-// true, and companion arrays that allow fast feature set distance
-// calculations with allowance of offsets in position.
+// Representation of a feature set as an array of bit masks that are sparsely
+// non-zero, with bits that allow fast feature set distance calculations with
+// allowance of offsets in position.
 // Init is expensive, so for greatest efficiency, to re-initialize for a new
 // feature set, use Set(..., false) on the SAME feature set as was used to
 // setup with Set(..., true), to return to its initialized state before
@@ -41,7 +41,7 @@ class IntFeatureDist {
   IntFeatureDist();
   ~IntFeatureDist();
 
-  // Initialize the bool array to the given size of feature space.
+  // Initialize the array to the given size of feature space.
   // The feature_map is just borrowed, and must exist for the entire
   // lifetime of the IntFeatureDist.
   void Init(const IntFeatureMap* feature_map);
@@ -67,12 +67,11 @@ class IntFeatureDist {
   double total_feature_weight_;
   // Pointer to IntFeatureMap given at Init to find offset features.
   const IntFeatureMap* feature_map_;
-  // Array of bools indicating presence of a feature.
-  bool* features_;
-  // Array indicating the presence of a feature offset by one unit.
-  bool* features_delta_one_;
-  // Array indicating the presence of a feature offset by two units.
-  bool* features_delta_two_;
+  // Array of bit masks indicating the presence of a feature (kFeatureBit),
+  // of a feature offset by one unit (kDeltaOneBit) and of a feature offset
+  // by two units (kDeltaTwoBit), so FeatureDistance needs a single lookup
+  // per test feature.
+  uinT8* features_;
 };
 
 }  // namespace tesseract
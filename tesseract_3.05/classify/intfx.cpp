@@ -133,9 +133,12 @@ TrainingSample* BlobToTrainingSample(
 void Classify::SetupBLCNDenorms(const TBLOB& blob, bool nonlinear_norm,
                                 DENORM* bl_denorm, DENORM* cn_denorm,
                                 INT_FX_RESULT_STRUCT* fx_info) {
-  // Compute 1st and 2nd moments of the original outline.
+  // Compute 1st and 2nd moments of the original outline, and for the
+  // non-linear normalization, the precise bounding box in the same pass.
   FCOORD center, second_moments;
-  int length = blob.ComputeMoments(&center, &second_moments);
+  TBOX box;
+  int length = blob.ComputeMoments(&center, &second_moments,
+                                   nonlinear_norm ? &box : NULL);
   if (fx_info != NULL) {
     fx_info->Length = length;
     fx_info->Rx = IntCastRounded(second_moments.y());
@@ -151,8 +154,6 @@ void Classify::SetupBLCNDenorms(const TBLOB& blob, bool nonlinear_norm,
   if (nonlinear_norm) {
     GenericVector<GenericVector<int> > x_coords;
     GenericVector<GenericVector<int> > y_coords;
-    TBOX box;
-    blob.GetPreciseBoundingBox(&box);
     box.pad(1, 1);
     blob.GetEdgeCoords(box, &x_coords, &y_coords);
     cn_denorm->SetupNonLinear(&blob.denorm(), box, MAX_UINT8, MAX_UINT8,
@@ -181,6 +182,21 @@ uinT8 NormalizeDirection(uinT8 dir, const FCOORD& unnormed_pos,
   return normed_end.to_direction();
 }
 
+// As NormalizeDirection, but takes normed_pos, the already normalized
+// unnormed_pos, so only the end of the direction vector needs transforming.
+static uinT8 NormalizeDirectionAt(uinT8 dir, const FCOORD& unnormed_pos,
+                                  const FCOORD& normed_pos,
+                                  const DENORM& denorm,
+                                  const DENORM* root_denorm) {
+  FCOORD unnormed_end;
+  unnormed_end.from_direction(dir);
+  unnormed_end += unnormed_pos;
+  FCOORD normed_end;
+  denorm.NormTransform(root_denorm, unnormed_end, &normed_end);
+  normed_end -= normed_pos;
+  return normed_end.to_direction();
+}
+
 // Helper returns the mean direction vector from the given stats. Use the
 // mean direction from dirs if there is information available, otherwise, use
 // the fit_vector from point_diffs.
@@ -310,7 +326,8 @@ static int GatherPoints(const C_OUTLINE* outline, double feature_length,
     points->add(pos_normed->x(), pos_normed->y(), edge_weight);
     int direction = outline->direction_at_index(index % step_length);
     if (direction >= 0) {
-      direction = NormalizeDirection(direction, f_pos, denorm, root_denorm);
+      direction = NormalizeDirectionAt(direction, f_pos, *pos_normed, denorm,
+                                       root_denorm);
       // Use both the direction and direction +128 so we are not trying to
       // take the mean of something straddling the wrap-around point.
       dirs->add(direction, Modulo(direction + 128, 256));
@@ -481,9 +498,10 @@ void Classify::ExtractFeatures(const TBLOB& blob,
   }
   results->NumBL = bl_features->size();
   results->NumCN = cn_features->size();
-  results->YBottom = blob.bounding_box().bottom();
-  results->YTop = blob.bounding_box().top();
-  results->Width = blob.bounding_box().width();
+  TBOX box = blob.bounding_box();
+  results->YBottom = box.bottom();
+  results->YTop = box.top();
+  results->Width = box.width();
 }
 
 }  // namespace tesseract
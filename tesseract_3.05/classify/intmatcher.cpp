@@ -137,20 +137,25 @@ class ClassPruner {
 
   /// Computes the scores for every class in the character set, by summing the
   /// weights for each feature and stores the sums internally in class_count_.
+  /// If pruner_sets is not NULL, only the listed CLASS_PRUNER_STRUCTs are
+  /// evaluated, and the scores of all the other classes stay at zero.
   void ComputeScores(const INT_TEMPLATES_STRUCT* int_templates,
-                     int num_features, const INT_FEATURE_STRUCT* features) {
+                     int num_features, const INT_FEATURE_STRUCT* features,
+                     const GenericVector<int>* pruner_sets) {
     num_features_ = num_features;
-    int num_pruners = int_templates->NumClassPruners;
+    int num_pruners = pruner_sets != NULL ? pruner_sets->size()
+                                          : int_templates->NumClassPruners;
     for (int f = 0; f < num_features; ++f) {
       const INT_FEATURE_STRUCT* feature = &features[f];
       // Quantize the feature to NUM_CP_BUCKETS*NUM_CP_BUCKETS*NUM_CP_BUCKETS.
       int x = feature->X * NUM_CP_BUCKETS >> 8;
       int y = feature->Y * NUM_CP_BUCKETS >> 8;
       int theta = feature->Theta * NUM_CP_BUCKETS >> 8;
-      int class_id = 0;
       // Each CLASS_PRUNER_STRUCT only covers CLASSES_PER_CP(32) classes, so
       // we need a collection of them, indexed by pruner_set.
-      for (int pruner_set = 0; pruner_set < num_pruners; ++pruner_set) {
+      for (int p = 0; p < num_pruners; ++p) {
+        int pruner_set = pruner_sets != NULL ? (*pruner_sets)[p] : p;
+        int class_id = pruner_set * CLASSES_PER_CP;
         // Look up quantized feature in a 3-D array, an array of weights for
         // each class.
         const uinT32* pruner_word_ptr =
@@ -228,6 +233,15 @@ class ClassPruner {
     }
   }
 
+  /// Zeros the scores for classes that are false in enabled_classes.
+  /// Used with templates whose class ids are not unichar ids.
+  void DisableClasses(const GenericVector<bool>& enabled_classes) {
+    for (int class_id = 0; class_id < max_classes_; ++class_id) {
+      if (!enabled_classes[class_id])
+        class_count_[class_id] = 0;
+    }
+  }
+
   /** Zeros the scores of fragments. */
   void DisableFragments(const UNICHARSET& unicharset) {
     for (int class_id = 0; class_id < max_classes_; ++class_id) {
@@ -416,13 +430,20 @@ int Classify::PruneClasses(const INT_TEMPLATES_STRUCT* int_templates,
                            const uinT16* expected_num_features,
                            GenericVector<CP_RESULT_STRUCT>* results) {
   ClassPruner pruner(int_templates->NumClasses);
+  // With a black/whitelist, the static templates are restricted to the
+  // classes that can output an enabled unichar. See SetupEnabledClasses.
+  bool use_enabled_classes = int_templates == PreTrainedTemplates &&
+      enabled_classes_.size() == int_templates->NumClasses;
   // Compute initial match scores for all classes.
-  pruner.ComputeScores(int_templates, num_features, features);
+  pruner.ComputeScores(int_templates, num_features, features,
+                       use_enabled_classes ? &enabled_pruners_ : NULL);
   // Adjust match scores for number of expected features.
   pruner.AdjustForExpectedNumFeatures(expected_num_features,
                                       classify_cp_cutoff_strength);
   // Apply disabled classes in unicharset - only works without a shape_table.
-  if (shape_table_ == NULL)
+  if (use_enabled_classes)
+    pruner.DisableClasses(enabled_classes_);
+  else if (shape_table_ == NULL)
     pruner.DisableDisabledClasses(unicharset);
   // If fragments are disabled, remove them, also only without a shape table.
   if (disable_character_fragments && shape_table_ == NULL)
@@ -451,6 +472,71 @@ int Classify::PruneClasses(const INT_TEMPLATES_STRUCT* int_templates,
   return pruner.SetupResults(results);
 }
 
+/**
+ * Builds the restricted view of PreTrainedTemplates used by PruneClasses
+ * while some unichars are disabled by a black or whitelist: a class is kept
+ * if any of the unichars it can output (through the shape_table_ if there is
+ * one) is enabled, and only the class pruners holding a kept class are
+ * evaluated. This means the class pruner and the IntegerMatcher do an amount
+ * of work proportional to the size of the whitelist instead of the whole
+ * character set. Must be called whenever the enabled flags of the unicharset
+ * change.
+ */
+void Classify::SetupEnabledClasses() {
+  enabled_classes_.truncate(0);
+  enabled_pruners_.truncate(0);
+  if (!classify_prune_disabled_classes || PreTrainedTemplates == NULL)
+    return;
+  int unichar_id = 0;
+  while (unichar_id < unicharset.size() && unicharset.get_enabled(unichar_id))
+    ++unichar_id;
+  if (unichar_id == unicharset.size())
+    return;  // Nothing is disabled.
+  int num_classes = PreTrainedTemplates->NumClasses;
+  enabled_classes_.init_to_size(num_classes, false);
+  int num_enabled = 0;
+  for (int class_id = 0; class_id < num_classes; ++class_id) {
+    bool enabled = false;
+    if (shape_table_ == NULL) {
+      enabled = class_id < unicharset.size() &&
+                unicharset.get_enabled(class_id);
+    } else if (PreTrainedTemplates->Class[class_id]->font_set_id < 0) {
+      enabled = true;  // No way to tell, so keep it.
+    } else {
+      int num_configs = PreTrainedTemplates->Class[class_id]->NumConfigs;
+      for (int config = 0; config < num_configs && !enabled; ++config) {
+        int shape_id = ClassAndConfigIDToFontOrShapeID(class_id, config);
+        const Shape& shape = shape_table_->GetShape(shape_id);
+        for (int c = 0; c < shape.size() && !enabled; ++c)
+          enabled = unicharset.get_enabled(shape[c].unichar_id);
+      }
+    }
+    enabled_classes_[class_id] = enabled;
+    if (enabled) ++num_enabled;
+  }
+  if (num_enabled == num_classes) {
+    // Nothing is disabled, so there is nothing to gain.
+    enabled_classes_.truncate(0);
+    return;
+  }
+  for (int pruner_set = 0; pruner_set < PreTrainedTemplates->NumClassPruners;
+       ++pruner_set) {
+    int end = MIN(num_classes, (pruner_set + 1) * CLASSES_PER_CP);
+    for (int class_id = pruner_set * CLASSES_PER_CP; class_id < end;
+         ++class_id) {
+      if (enabled_classes_[class_id]) {
+        enabled_pruners_.push_back(pruner_set);
+        break;
+      }
+    }
+  }
+  if (classify_debug_level > 0) {
+    tprintf("Restricted static templates to %d of %d classes, %d of %d"
+            " class pruners\n", num_enabled, num_classes,
+            enabled_pruners_.size(), PreTrainedTemplates->NumClassPruners);
+  }
+}
+
 }  // namespace tesseract
 
 /**
@@ -37,6 +37,15 @@
 #define MINSEARCH -MAX_FLOAT32
 #define MAXSEARCH MAX_FLOAT32
 
+// The nodes of a tree are allocated a block at a time, and deleted nodes are
+// kept on the free list of the tree, as clustering deletes and re-stores
+// nodes many times over.
+struct KDNODE_BLOCK {
+  static const int kNumNodes = 256;
+  KDNODE_BLOCK *Next;
+  KDNODE Nodes[kNumNodes];
+};
+
 // Helper function to find the next essential dimension in a cycle.
 static int NextLevel(KDTREE *tree, int level) {
   do {
@@ -200,6 +209,8 @@ KDTREE *MakeKDTree(inT16 KeySize, const PARAM_DESC KeyDesc[]) {
   KDTree->KeySize = KeySize;
   KDTree->Root.Left = NULL;
   KDTree->Root.Right = NULL;
+  KDTree->FreeNodes = NULL;
+  KDTree->NodeBlocks = NULL;
   return KDTree;
 }
 
@@ -294,7 +305,7 @@ KDDelete (KDTREE * Tree, FLOAT32 Key[], void *Data) {
 
     InsertNodes(Tree, Current->Left);
     InsertNodes(Tree, Current->Right);
-    FreeSubTree(Current);
+    FreeSubTree(Tree, Current);
   }
 }                                /* KDDelete */
 
@@ -348,7 +359,11 @@ void KDWalk(KDTREE *Tree, void_proc action, void *context) {
  * @note History: 5/26/89, DSJ, Created.
  */
 void FreeKDTree(KDTREE *Tree) {
-  FreeSubTree(Tree->Root.Left);
+  while (Tree->NodeBlocks != NULL) {
+    KDNODE_BLOCK *Block = Tree->NodeBlocks;
+    Tree->NodeBlocks = Block->Next;
+    delete Block;
+  }
   memfree(Tree);
 }                                /* FreeKDTree */
 
@@ -371,9 +386,15 @@ void FreeKDTree(KDTREE *Tree) {
  * @note History: 3/11/89, DSJ, Created.
  */
 KDNODE *MakeKDNode(KDTREE *tree, FLOAT32 Key[], void *Data, int Index) {
-  KDNODE *NewNode;
-
-  NewNode = (KDNODE *) Emalloc (sizeof (KDNODE));
+  if (tree->FreeNodes == NULL) {
+    KDNODE_BLOCK *Block = new KDNODE_BLOCK;
+    Block->Next = tree->NodeBlocks;
+    tree->NodeBlocks = Block;
+    for (int i = 0; i < KDNODE_BLOCK::kNumNodes; ++i)
+      FreeKDNode(tree, &Block->Nodes[i]);
+  }
+  KDNODE *NewNode = tree->FreeNodes;
+  tree->FreeNodes = NewNode->Left;
 
   NewNode->Key = Key;
   NewNode->Data = Data;
@@ -388,8 +409,10 @@ KDNODE *MakeKDNode(KDTREE *tree, FLOAT32 Key[], void *Data, int Index) {
 
 
 /*---------------------------------------------------------------------------*/
-void FreeKDNode(KDNODE *Node) {
-  memfree ((char *)Node);
+/** Returns Node to the free nodes of tree. */
+void FreeKDNode(KDTREE *tree, KDNODE *Node) {
+  Node->Left = tree->FreeNodes;
+  tree->FreeNodes = Node;
 }
 
 
@@ -552,10 +575,10 @@ void InsertNodes(KDTREE *tree, KDNODE *nodes) {
 }
 
 /** Free all of the nodes of a sub tree. */
-void FreeSubTree(KDNODE *sub_tree) {
+void FreeSubTree(KDTREE *tree, KDNODE *sub_tree) {
   if (sub_tree != NULL) {
-    FreeSubTree(sub_tree->Left);
-    FreeSubTree(sub_tree->Right);
-    memfree(sub_tree);
+    FreeSubTree(tree, sub_tree->Left);
+    FreeSubTree(tree, sub_tree->Right);
+    FreeKDNode(tree, sub_tree);
   }
 }
@@ -46,9 +46,14 @@ struct KDNODE {
   struct KDNODE *Right;
 };
 
+/** Block of nodes allocated at once, to save a malloc for every node. */
+struct KDNODE_BLOCK;
+
 struct KDTREE {
   inT16 KeySize;                 /* number of dimensions in the tree */
   KDNODE Root;                   /* Root.Left points to actual root node */
+  KDNODE *FreeNodes;             /* unused nodes, linked through Left */
+  KDNODE_BLOCK *NodeBlocks;      /* all the node blocks owned by the tree */
   PARAM_DESC KeyDesc[1];         /* description of each dimension */
 };
 
@@ -79,7 +84,7 @@ void FreeKDTree(KDTREE *Tree);
 -----------------------------------------------------------------------------*/
 KDNODE *MakeKDNode(KDTREE *tree, FLOAT32 Key[], void *Data, int Index);
 
-void FreeKDNode(KDNODE *Node);
+void FreeKDNode(KDTREE *tree, KDNODE *Node);
 
 FLOAT32 DistanceSquared(int k, PARAM_DESC *dim, FLOAT32 p1[], FLOAT32 p2[]);
 
@@ -92,5 +97,5 @@ void Walk(KDTREE *tree, void_proc action, void *context,
 
 void InsertNodes(KDTREE *tree, KDNODE *nodes);
 
-void FreeSubTree(KDNODE *SubTree);
+void FreeSubTree(KDTREE *tree, KDNODE *SubTree);
 #endif
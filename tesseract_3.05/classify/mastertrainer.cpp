@@ -37,6 +37,7 @@
 #include "shapeclassifier.h"
 #include "shapetable.h"
 #include "svmnode.h"
+#include "svutil.h"
 
 #include "scanutils.h"
 
@@ -48,6 +49,10 @@ namespace tesseract {
 const int kMinClusteredShapes = 1;
 // Max number of unichars in any individual cluster.
 const int kMaxUnicharsPerCluster = 2000;
+// Magic number at the start of a binary (.trb) sample file, as written
+// natively and after an endian swap.
+const inT32 kBinaryTrMagic = 0x31425254;  // "TRB1"
+const inT32 kBinaryTrMagicSwapped = 0x54524231;
 // Mean font distance below which to merge fonts and unichars.
 const float kFontMergeDistance = 0.025;
 
@@ -60,7 +65,8 @@ MasterTrainer::MasterTrainer(NormalizationMode norm_mode,
     charsetsize_(0),
     enable_shape_anaylsis_(shape_analysis),
     enable_replication_(replicate_samples),
-    fragments_(NULL), prev_unichar_id_(-1), debug_level_(debug_level) {
+    fragments_(NULL), prev_unichar_id_(-1), debug_level_(debug_level),
+    num_threads_(1) {
 }
 
 MasterTrainer::~MasterTrainer() {
@@ -128,26 +134,66 @@ void MasterTrainer::LoadUnicharset(const char* filename) {
   verify_samples_.LoadUnicharset(filename);
 }
 
-// Reads the samples and their features from the given .tr format file,
+// Reads the samples and their features from the given .tr or .trb file,
 // adding them to the trainer with the font_id from the content of the file.
 // See mftraining.cpp for a description of the file format.
 // If verification, then these are verification samples, not training.
 void MasterTrainer::ReadTrainingSamples(const char* page_name,
                                         const FEATURE_DEFS_STRUCT& feature_defs,
                                         bool verification) {
+  TrFileSamples samples;
+  if (ReadTrFile(page_name, feature_defs, &samples))
+    AddTrFileSamples(page_name, verification, &samples);
+}
+
+// Reads the samples of the given .tr or .trb file into *samples. The
+// format is detected from the content of the file.
+bool MasterTrainer::ReadTrFile(const char* page_name,
+                               const FEATURE_DEFS_STRUCT& feature_defs,
+                               TrFileSamples* samples) {
+  FILE* fp = Efopen(page_name, "rb");
+  if (fp == NULL) {
+    tprintf("Failed to open tr file: %s\n", page_name);
+    return false;
+  }
+  bool result = ReadTrFile(fp, feature_defs, samples);
+  fclose(fp);
+  if (!result)
+    tprintf("Failed to read binary tr file: %s\n", page_name);
+  return result;
+}
+
+// As ReadTrFile, but reads from an open file.
+bool MasterTrainer::ReadTrFile(FILE* fp,
+                               const FEATURE_DEFS_STRUCT& feature_defs,
+                               TrFileSamples* samples) {
+  inT32 magic = 0;
+  if (fread(&magic, sizeof(magic), 1, fp) == 1) {
+    bool swap = magic == kBinaryTrMagicSwapped;
+    if (magic == kBinaryTrMagic || swap) {
+      inT32 num_samples;
+      if (fread(&num_samples, sizeof(num_samples), 1, fp) != 1) return false;
+      if (swap) ReverseN(&num_samples, sizeof(num_samples));
+      for (int s = 0; s < num_samples; ++s) {
+        STRING font_name, unichar;
+        if (!font_name.DeSerialize(swap, fp)) return false;
+        if (!unichar.DeSerialize(swap, fp)) return false;
+        TrainingSample* sample = TrainingSample::DeSerializeCreate(swap, fp);
+        if (sample == NULL) return false;
+        samples->font_names.push_back(font_name);
+        samples->unichars.push_back(unichar);
+        samples->samples.push_back(sample);
+      }
+      return true;
+    }
+  }
+  rewind(fp);
   char buffer[2048];
   int int_feature_type = ShortNameToFeatureType(feature_defs, kIntFeatureType);
   int micro_feature_type = ShortNameToFeatureType(feature_defs,
                                                   kMicroFeatureType);
   int cn_feature_type = ShortNameToFeatureType(feature_defs, kCNFeatureType);
   int geo_feature_type = ShortNameToFeatureType(feature_defs, kGeoFeatureType);
-
-  FILE* fp = Efopen(page_name, "rb");
-  if (fp == NULL) {
-    tprintf("Failed to open tr file: %s\n", page_name);
-    return;
-  }
-  tr_filenames_.push_back(STRING(page_name));
   while (fgets(buffer, sizeof(buffer), fp) != NULL) {
     if (buffer[0] == '\n')
       continue;
@@ -158,8 +204,6 @@ void MasterTrainer::ReadTrainingSamples(const char* page_name,
       continue;
     }
     *space++ = '\0';
-    int font_id = GetFontInfoId(buffer);
-    if (font_id < 0) font_id = 0;
     int page_number;
     STRING unichar;
     TBOX bounding_box;
@@ -169,16 +213,67 @@ void MasterTrainer::ReadTrainingSamples(const char* page_name,
     }
     CHAR_DESC char_desc = ReadCharDescription(feature_defs, fp);
     TrainingSample* sample = new TrainingSample;
-    sample->set_font_id(font_id);
-    sample->set_page_num(page_number + page_images_.size());
+    sample->set_page_num(page_number);
     sample->set_bounding_box(bounding_box);
     sample->ExtractCharDesc(int_feature_type, micro_feature_type,
                             cn_feature_type, geo_feature_type, char_desc);
-    AddSample(verification, unichar.string(), sample);
     FreeCharDescription(char_desc);
+    samples->font_names.push_back(STRING(buffer));
+    samples->unichars.push_back(unichar);
+    samples->samples.push_back(sample);
   }
+  return true;
+}
+
+// Returns true if fp is at the start of a binary .trb file.
+bool MasterTrainer::IsBinaryTrFile(FILE* fp) {
+  inT32 magic = 0;
+  bool binary = fread(&magic, sizeof(magic), 1, fp) == 1 &&
+                (magic == kBinaryTrMagic || magic == kBinaryTrMagicSwapped);
+  rewind(fp);
+  return binary;
+}
+
+// Writes the samples to the given file in the binary .trb format.
+bool MasterTrainer::WriteBinaryTrFile(const TrFileSamples& samples,
+                                      const char* filename) {
+  FILE* fp = fopen(filename, "wb");
+  if (fp == NULL) {
+    tprintf("Failed to create binary tr file: %s\n", filename);
+    return false;
+  }
+  bool result = true;
+  inT32 num_samples = samples.samples.size();
+  if (fwrite(&kBinaryTrMagic, sizeof(kBinaryTrMagic), 1, fp) != 1 ||
+      fwrite(&num_samples, sizeof(num_samples), 1, fp) != 1)
+    result = false;
+  for (int s = 0; result && s < num_samples; ++s) {
+    result = samples.font_names[s].Serialize(fp) &&
+             samples.unichars[s].Serialize(fp) &&
+             samples.samples[s]->Serialize(fp);
+  }
+  if (fclose(fp) != 0) result = false;
+  if (!result)
+    tprintf("Failed to write binary tr file: %s\n", filename);
+  return result;
+}
+
+// Adds the samples read by ReadTrFile from the given page_name to the
+// trainer, and takes ownership of them.
+void MasterTrainer::AddTrFileSamples(const char* page_name, bool verification,
+                                     TrFileSamples* samples) {
+  tr_filenames_.push_back(STRING(page_name));
+  for (int s = 0; s < samples->samples.size(); ++s) {
+    TrainingSample* sample = samples->samples[s];
+    samples->samples[s] = NULL;
+    int font_id = GetFontInfoId(samples->font_names[s].string());
+    if (font_id < 0) font_id = 0;
+    sample->set_font_id(font_id);
+    sample->set_page_num(sample->page_num() + page_images_.size());
+    AddSample(verification, samples->unichars[s].string(), sample);
+  }
+  samples->samples.truncate(0);
   charsetsize_ = unicharset_.size();
-  fclose(fp);
 }
 
 // Adds the given single sample to the trainer, setting the classid
@@ -773,13 +868,13 @@ void MasterTrainer::TestClassifierVOld(bool replicate_samples,
 
 // Tests the given test_classifier on the internal samples.
 // See TestClassifier for details.
-void MasterTrainer::TestClassifierOnSamples(CountTypes error_mode,
-                                            int report_level,
-                                            bool replicate_samples,
-                                            ShapeClassifier* test_classifier,
-                                            STRING* report_string) {
-  TestClassifier(error_mode, report_level, replicate_samples, &samples_,
-                 test_classifier, report_string);
+double MasterTrainer::TestClassifierOnSamples(CountTypes error_mode,
+                                              int report_level,
+                                              bool replicate_samples,
+                                              ShapeClassifier* test_classifier,
+                                              STRING* report_string) {
+  return TestClassifier(error_mode, report_level, replicate_samples, &samples_,
+                        test_classifier, report_string);
 }
 
 // Tests the given test_classifier on the given samples.
@@ -913,74 +1008,167 @@ void MasterTrainer::ReplaceFragmentedSamples() {
   fragments_ = NULL;
 }
 
+const float kInfiniteDist = 999.0f;
+
+// Shape distances to be computed in parallel by ClusterShapes.
+struct ShapeDistTasks {
+  MasterTrainer* trainer;
+  const ShapeTable* shapes;
+  // Upper triangle of the distance matrix: shape_dists[s1][s2 - s1 - 1] is
+  // the distance between s1 and s2 > s1.
+  GenericVector<ShapeDist>* shape_dists;
+  int num_shapes;
+  // For the updates after a merge, the merged shape, and the shapes to
+  // compute its distance to, with the results.
+  int merged_shape;
+  GenericVector<int> other_shapes;
+  GenericVector<float> distances;
+};
+
+// Computes the row shape_dists[s1] of the distance matrix.
+static void ComputeShapeDistRow(void* arg, int s1) {
+  ShapeDistTasks* tasks = static_cast<ShapeDistTasks*>(arg);
+  GenericVector<ShapeDist>* row = &tasks->shape_dists[s1];
+  row->reserve(tasks->num_shapes - s1 - 1);
+  for (int s2 = s1 + 1; s2 < tasks->num_shapes; ++s2) {
+    row->push_back(ShapeDist(s1, s2, tasks->trainer->ShapeDistance(
+        *tasks->shapes, s1, s2)));
+  }
+  tprintf(" %d", s1);
+}
+
+// Computes the distance between the merged shape and other_shapes[index].
+static void ComputeMergedShapeDist(void* arg, int index) {
+  ShapeDistTasks* tasks = static_cast<ShapeDistTasks*>(arg);
+  int s1 = tasks->merged_shape;
+  int s2 = tasks->other_shapes[index];
+  if (s2 < s1) Swap(&s1, &s2);
+  tasks->distances[index] =
+      tasks->trainer->ShapeDistance(*tasks->shapes, s1, s2);
+}
+
+// Sets *best to the index of the first smallest distance in the row that is
+// less than kInfiniteDist, or -1 if there is none.
+static void FindBestShapeDist(const GenericVector<ShapeDist>& row,
+                              int* best) {
+  *best = -1;
+  float min_dist = kInfiniteDist;
+  for (int i = 0; i < row.size(); ++i) {
+    if (row[i].distance < min_dist) {
+      min_dist = row[i].distance;
+      *best = i;
+    }
+  }
+}
+
+// Sets row[index] to dist, updating *best (as set by FindBestShapeDist)
+// without a rescan of the row unless the best distance got worse.
+static void UpdateShapeDist(int index, float dist,
+                            GenericVector<ShapeDist>* row, int* best) {
+  float old_dist = (*row)[index].distance;
+  (*row)[index].distance = dist;
+  if (*best == index) {
+    if (dist > old_dist) FindBestShapeDist(*row, best);
+  } else if (dist < kInfiniteDist &&
+             (*best < 0 || dist < (*row)[*best].distance ||
+              (dist == (*row)[*best].distance && index < *best))) {
+    *best = index;
+  }
+}
+
 // Runs a hierarchical agglomerative clustering to merge shapes in the given
 // shape_table, while satisfying the given constraints:
 // * End with at least min_shapes left in shape_table,
 // * No shape shall have more than max_shape_unichars in it,
 // * Don't merge shapes where the distance between them exceeds max_dist.
-const float kInfiniteDist = 999.0f;
+// The distance matrix is computed once on num_threads_ threads, and after
+// each merge only the distances to the merged shape are recomputed. The
+// minimum of each row is kept up to date to find the next merge quickly.
 void MasterTrainer::ClusterShapes(int min_shapes,  int max_shape_unichars,
                                   float max_dist, ShapeTable* shapes) {
   int num_shapes = shapes->NumShapes();
   int max_merges = num_shapes - min_shapes;
   GenericVector<ShapeDist>* shape_dists =
       new GenericVector<ShapeDist>[num_shapes];
+  ShapeDistTasks tasks;
+  tasks.trainer = this;
+  tasks.shapes = shapes;
+  tasks.shape_dists = shape_dists;
+  tasks.num_shapes = num_shapes;
+  tprintf("Computing shape distances...");
+  SVSync::ParallelFor(num_shapes, num_threads_, ComputeShapeDistRow, &tasks);
+  tprintf("\n");
+  // Index of the smallest distance in each row of shape_dists.
+  GenericVector<int> row_best;
+  row_best.init_to_size(num_shapes, -1);
+  for (int s1 = 0; s1 < num_shapes; ++s1)
+    FindBestShapeDist(shape_dists[s1], &row_best[s1]);
   float min_dist = kInfiniteDist;
   int min_s1 = 0;
   int min_s2 = 0;
-  tprintf("Computing shape distances...");
   for (int s1 = 0; s1 < num_shapes; ++s1) {
-    for (int s2 = s1 + 1; s2 < num_shapes; ++s2) {
-      ShapeDist dist(s1, s2, ShapeDistance(*shapes, s1, s2));
-      shape_dists[s1].push_back(dist);
-      if (dist.distance < min_dist) {
-        min_dist = dist.distance;
-        min_s1 = s1;
-        min_s2 = s2;
-      }
+    int best = row_best[s1];
+    if (best >= 0 && shape_dists[s1][best].distance < min_dist) {
+      min_dist = shape_dists[s1][best].distance;
+      min_s1 = s1;
+      min_s2 = s1 + 1 + best;
     }
-    tprintf(" %d", s1);
   }
-  tprintf("\n");
   int num_merged = 0;
   while (num_merged < max_merges && min_dist < max_dist) {
     tprintf("Distance = %f: ", min_dist);
     int num_unichars = shapes->MergedUnicharCount(min_s1, min_s2);
-    shape_dists[min_s1][min_s2 - min_s1 - 1].distance = kInfiniteDist;
+    UpdateShapeDist(min_s2 - min_s1 - 1, kInfiniteDist,
+                    &shape_dists[min_s1], &row_best[min_s1]);
     if (num_unichars > max_shape_unichars) {
       tprintf("Merge of %d and %d with %d would exceed max of %d unichars\n",
               min_s1, min_s2, num_unichars, max_shape_unichars);
     } else {
       shapes->MergeShapes(min_s1, min_s2);
       shape_dists[min_s2].clear();
+      row_best[min_s2] = -1;
       ++num_merged;
 
+      // Recompute the distances from the merged shape to the rest.
+      tasks.merged_shape = min_s1;
+      tasks.other_shapes.truncate(0);
       for (int s = 0; s < min_s1; ++s) {
-        if (!shape_dists[s].empty()) {
-          shape_dists[s][min_s1 - s - 1].distance =
-              ShapeDistance(*shapes, s, min_s1);
-          shape_dists[s][min_s2 - s -1].distance = kInfiniteDist;
-        }
+        if (!shape_dists[s].empty())
+          tasks.other_shapes.push_back(s);
       }
       for (int s2 = min_s1 + 1; s2 < num_shapes; ++s2) {
         if (shape_dists[min_s1][s2 - min_s1 - 1].distance < kInfiniteDist)
-          shape_dists[min_s1][s2 - min_s1 - 1].distance =
-              ShapeDistance(*shapes, min_s1, s2);
+          tasks.other_shapes.push_back(s2);
       }
+      tasks.distances.init_to_size(tasks.other_shapes.size(), 0.0f);
+      SVSync::ParallelFor(tasks.other_shapes.size(), num_threads_,
+                          ComputeMergedShapeDist, &tasks);
+      for (int i = 0; i < tasks.other_shapes.size(); ++i) {
+        int s = tasks.other_shapes[i];
+        if (s < min_s1) {
+          UpdateShapeDist(min_s1 - s - 1, tasks.distances[i],
+                          &shape_dists[s], &row_best[s]);
+          UpdateShapeDist(min_s2 - s - 1, kInfiniteDist,
+                          &shape_dists[s], &row_best[s]);
+        } else {
+          shape_dists[min_s1][s - min_s1 - 1].distance = tasks.distances[i];
+        }
+      }
+      FindBestShapeDist(shape_dists[min_s1], &row_best[min_s1]);
       for (int s = min_s1 + 1; s < min_s2; ++s) {
         if (!shape_dists[s].empty()) {
-          shape_dists[s][min_s2 - s - 1].distance = kInfiniteDist;
+          UpdateShapeDist(min_s2 - s - 1, kInfiniteDist,
+                          &shape_dists[s], &row_best[s]);
         }
       }
     }
     min_dist = kInfiniteDist;
     for (int s1 = 0; s1 < num_shapes; ++s1) {
-      for (int i = 0; i < shape_dists[s1].size(); ++i) {
-        if (shape_dists[s1][i].distance < min_dist) {
-          min_dist = shape_dists[s1][i].distance;
-          min_s1 = s1;
-          min_s2 = s1 + 1 + i;
-        }
+      int best = row_best[s1];
+      if (best >= 0 && shape_dists[s1][best].distance < min_dist) {
+        min_dist = shape_dists[s1][best].distance;
+        min_s1 = s1;
+        min_s2 = s1 + 1 + best;
       }
     }
   }
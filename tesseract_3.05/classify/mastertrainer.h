@@ -46,6 +46,19 @@ namespace tesseract {
 
 class ShapeClassifier;
 
+// The samples of one .tr (text) or .trb (binary) file, as read by
+// MasterTrainer::ReadTrFile, before they are added to a MasterTrainer with
+// AddTrFileSamples. The font ids of the samples are not set, and their page
+// numbers are relative to the file.
+struct TrFileSamples {
+  TrFileSamples() {}
+  ~TrFileSamples() { samples.delete_data_pointers(); }
+
+  GenericVector<STRING> font_names;
+  GenericVector<STRING> unichars;
+  GenericVector<TrainingSample*> samples;
+};
+
 // Simple struct to hold the distance between two shapes during clustering.
 struct ShapeDist {
   ShapeDist() : shape1(0), shape2(0), distance(0.0f) {}
@@ -81,6 +94,9 @@ class TESS_API MasterTrainer {
   // Loads an initial unicharset, or sets one up if the file cannot be read.
   void LoadUnicharset(const char* filename);
 
+  // Sets the number of threads used to compute the shape distances.
+  void set_num_threads(int num_threads) { num_threads_ = num_threads; }
+
   // Sets the feature space definition.
   void SetFeatureSpace(const IntFeatureSpace& fs) {
     feature_space_ = fs;
@@ -94,6 +110,30 @@ class TESS_API MasterTrainer {
                            const FEATURE_DEFS_STRUCT& feature_defs,
                            bool verification);
 
+  // Reads the samples of the given .tr or .trb file into *samples. The
+  // format is detected from the content of the file. Does not touch any
+  // trainer, so several files may be read at once on different threads.
+  // Returns false if the file cannot be opened or a binary file is
+  // truncated.
+  static bool ReadTrFile(const char* page_name,
+                         const FEATURE_DEFS_STRUCT& feature_defs,
+                         TrFileSamples* samples);
+  // As ReadTrFile, but reads from an open file.
+  static bool ReadTrFile(FILE* fp, const FEATURE_DEFS_STRUCT& feature_defs,
+                         TrFileSamples* samples);
+  // Returns true if fp is at the start of a binary .trb file. Leaves fp at
+  // the start of the file.
+  static bool IsBinaryTrFile(FILE* fp);
+  // Writes the samples to the given file in the binary .trb format, which
+  // ReadTrFile reads without any text parsing. Returns false on error.
+  static bool WriteBinaryTrFile(const TrFileSamples& samples,
+                                const char* filename);
+
+  // Adds the samples read by ReadTrFile from the given page_name to the
+  // trainer, as ReadTrainingSamples does, and takes ownership of them.
+  void AddTrFileSamples(const char* page_name, bool verification,
+                        TrFileSamples* samples);
+
   // Adds the given single sample to the trainer, setting the classid
   // appropriately from the given unichar_str.
   void AddSample(bool verification, const char* unichar_str,
@@ -218,13 +258,13 @@ class TESS_API MasterTrainer {
                           ShapeClassifier* test_classifier,
                           ShapeClassifier* old_classifier);
 
-  // Tests the given test_classifier on the internal samples.
-  // See TestClassifier for details.
-  void TestClassifierOnSamples(CountTypes error_mode,
-                               int report_level,
-                               bool replicate_samples,
-                               ShapeClassifier* test_classifier,
-                               STRING* report_string);
+  // Tests the given test_classifier on the internal samples and returns the
+  // error rate. See TestClassifier for details.
+  double TestClassifierOnSamples(CountTypes error_mode,
+                                 int report_level,
+                                 bool replicate_samples,
+                                 ShapeClassifier* test_classifier,
+                                 STRING* report_string);
   // Tests the given test_classifier on the given samples
   // error_mode indicates what counts as an error.
   // report_levels:
@@ -296,6 +336,8 @@ class TESS_API MasterTrainer {
   int prev_unichar_id_;
   // Debug output control.
   int debug_level_;
+  // Number of threads to compute shape distances with.
+  int num_threads_;
   // Feature map used to construct reduced feature spaces for compact
   // classifiers.
   IntFeatureMap feature_map_;
@@ -293,6 +293,9 @@ float TrainingSampleSet::UnicharDistance(const UnicharAndFonts& uf1,
 // Returns the distance between the given pair of font/class pairs.
 // Finds in cache or computes and caches.
 // OrganizeByFontAndClass must have been already called.
+// May be called concurrently from several threads: the caches are only
+// accessed with distance_cache_mutex_ held, but the distance is computed
+// without it.
 float TrainingSampleSet::ClusterDistance(int font_id1, int class_id1,
                                          int font_id2, int class_id2,
                                          const IntFeatureMap& feature_map) {
@@ -302,65 +305,87 @@ float TrainingSampleSet::ClusterDistance(int font_id1, int class_id1,
   if (font_index1 < 0 || font_index2 < 0)
     return 0.0f;
   FontClassInfo& fc_info = (*font_class_array_)(font_index1, class_id1);
+  FontClassInfo& fc_info2 = (*font_class_array_)(font_index2, class_id2);
   if (font_id1 == font_id2) {
     // Special case cache for speed.
-    if (fc_info.unichar_distance_cache.size() == 0)
-      fc_info.unichar_distance_cache.init_to_size(unicharset_size_, -1.0f);
-    if (fc_info.unichar_distance_cache[class_id2] < 0) {
-      // Distance has to be calculated.
-      float result = ComputeClusterDistance(font_id1, class_id1,
-                                            font_id2, class_id2,
-                                            feature_map);
-      fc_info.unichar_distance_cache[class_id2] = result;
-      // Copy to the symmetric cache entry.
-      FontClassInfo& fc_info2 = (*font_class_array_)(font_index2, class_id2);
-      if (fc_info2.unichar_distance_cache.size() == 0)
-        fc_info2.unichar_distance_cache.init_to_size(unicharset_size_, -1.0f);
-      fc_info2.unichar_distance_cache[class_id1] = result;
+    {
+      SVAutoLock lock(&distance_cache_mutex_);
+      if (fc_info.unichar_distance_cache.size() == 0)
+        fc_info.unichar_distance_cache.init_to_size(unicharset_size_, -1.0f);
+      if (fc_info.unichar_distance_cache[class_id2] >= 0)
+        return fc_info.unichar_distance_cache[class_id2];
     }
-    return fc_info.unichar_distance_cache[class_id2];
+    // Distance has to be calculated.
+    float result = ComputeClusterDistance(font_id1, class_id1,
+                                          font_id2, class_id2,
+                                          feature_map);
+    SVAutoLock lock(&distance_cache_mutex_);
+    fc_info.unichar_distance_cache[class_id2] = result;
+    // Copy to the symmetric cache entry.
+    if (fc_info2.unichar_distance_cache.size() == 0)
+      fc_info2.unichar_distance_cache.init_to_size(unicharset_size_, -1.0f);
+    fc_info2.unichar_distance_cache[class_id1] = result;
+    return result;
   } else if (class_id1 == class_id2) {
     // Another special-case cache for equal class-id.
-    if (fc_info.font_distance_cache.size() == 0)
-      fc_info.font_distance_cache.init_to_size(font_id_map_.CompactSize(),
-                                               -1.0f);
-    if (fc_info.font_distance_cache[font_index2] < 0) {
-      // Distance has to be calculated.
-      float result = ComputeClusterDistance(font_id1, class_id1,
-                                            font_id2, class_id2,
-                                            feature_map);
-      fc_info.font_distance_cache[font_index2] = result;
-      // Copy to the symmetric cache entry.
-      FontClassInfo& fc_info2 = (*font_class_array_)(font_index2, class_id2);
-      if (fc_info2.font_distance_cache.size() == 0)
-        fc_info2.font_distance_cache.init_to_size(font_id_map_.CompactSize(),
-                                                  -1.0f);
-      fc_info2.font_distance_cache[font_index1] = result;
+    {
+      SVAutoLock lock(&distance_cache_mutex_);
+      if (fc_info.font_distance_cache.size() == 0)
+        fc_info.font_distance_cache.init_to_size(font_id_map_.CompactSize(),
+                                                 -1.0f);
+      if (fc_info.font_distance_cache[font_index2] >= 0)
+        return fc_info.font_distance_cache[font_index2];
     }
-    return fc_info.font_distance_cache[font_index2];
-  }
-  // Both font and class are different. Linear search for class_id2/font_id2
-  // in what is a hopefully short list of distances.
-  int cache_index = 0;
-  while (cache_index < fc_info.distance_cache.size() &&
-         (fc_info.distance_cache[cache_index].unichar_id != class_id2 ||
-          fc_info.distance_cache[cache_index].font_id != font_id2))
-    ++cache_index;
-  if (cache_index == fc_info.distance_cache.size()) {
     // Distance has to be calculated.
     float result = ComputeClusterDistance(font_id1, class_id1,
                                           font_id2, class_id2,
                                           feature_map);
+    SVAutoLock lock(&distance_cache_mutex_);
+    fc_info.font_distance_cache[font_index2] = result;
+    // Copy to the symmetric cache entry.
+    if (fc_info2.font_distance_cache.size() == 0)
+      fc_info2.font_distance_cache.init_to_size(font_id_map_.CompactSize(),
+                                                -1.0f);
+    fc_info2.font_distance_cache[font_index1] = result;
+    return result;
+  }
+  // Both font and class are different. Linear search for class_id2/font_id2
+  // in what is a hopefully short list of distances.
+  {
+    SVAutoLock lock(&distance_cache_mutex_);
+    int cache_index = FindDistanceCacheEntry(fc_info, font_id2, class_id2);
+    if (cache_index >= 0)
+      return fc_info.distance_cache[cache_index].distance;
+  }
+  // Distance has to be calculated.
+  float result = ComputeClusterDistance(font_id1, class_id1,
+                                        font_id2, class_id2,
+                                        feature_map);
+  SVAutoLock lock(&distance_cache_mutex_);
+  // Another thread may have got there first, in which case it also made
+  // the symmetric entry.
+  if (FindDistanceCacheEntry(fc_info, font_id2, class_id2) < 0) {
     FontClassDistance fc_dist = { class_id2, font_id2, result };
     fc_info.distance_cache.push_back(fc_dist);
     // Copy to the symmetric cache entry. We know it isn't there already, as
     // we always copy to the symmetric entry.
-    FontClassInfo& fc_info2 = (*font_class_array_)(font_index2, class_id2);
     fc_dist.unichar_id = class_id1;
     fc_dist.font_id = font_id1;
     fc_info2.distance_cache.push_back(fc_dist);
   }
-  return fc_info.distance_cache[cache_index].distance;
+  return result;
+}
+
+// Returns the index of the entry for font_id/class_id in the distance_cache
+// of fc_info, or -1 if there is none.
+int TrainingSampleSet::FindDistanceCacheEntry(const FontClassInfo& fc_info,
+                                              int font_id, int class_id) {
+  for (int i = 0; i < fc_info.distance_cache.size(); ++i) {
+    if (fc_info.distance_cache[i].unichar_id == class_id &&
+        fc_info.distance_cache[i].font_id == font_id)
+      return i;
+  }
+  return -1;
 }
 
 // Computes the distance between the given pair of font/class pairs.
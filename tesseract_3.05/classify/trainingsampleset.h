@@ -21,6 +21,7 @@
 #include "indexmapbidi.h"
 #include "matrix.h"
 #include "shapetable.h"
+#include "svutil.h"
 #include "trainingsample.h"
 
 class UNICHARSET;
@@ -119,7 +120,7 @@ class TrainingSampleSet {
                         bool matched_fonts, const IntFeatureMap& feature_map);
 
   // Returns the distance between the given pair of font/class pairs.
-  // Finds in cache or computes and caches.
+  // Finds in cache or computes and caches. Thread-safe.
   // OrganizeByFontAndClass must have been already called.
   float ClusterDistance(int font_id1, int class_id1,
                         int font_id2, int class_id2,
@@ -267,6 +268,11 @@ class TrainingSampleSet {
     GenericVector<FontClassDistance> distance_cache;
   };
 
+  // Returns the index of the entry for font_id/class_id in the
+  // distance_cache of fc_info, or -1 if there is none.
+  static int FindDistanceCacheEntry(const FontClassInfo& fc_info,
+                                    int font_id, int class_id);
+
   PointerVector<TrainingSample> samples_;
   // Number of samples before replication/randomization.
   int num_raw_samples_;
@@ -281,6 +287,9 @@ class TrainingSampleSet {
   // A 2-d array of FontClassInfo holding information related to each
   // (font_id, class_id) pair.
   GENERIC_2D_ARRAY<FontClassInfo>* font_class_array_;
+  // Protects the distance caches in font_class_array_, so ClusterDistance
+  // can be called from several threads.
+  SVMutex distance_cache_mutex_;
 
   // Reference to the fontinfo_table_ in MasterTrainer. Provides names
   // for font_ids in the samples. Not serialized!
@@ -0,0 +1,255 @@
+///////////////////////////////////////////////////////////////////////
+// File:        charngram.cpp
+// Description: Compact, hashed character ngram model.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////
+
+#include "charngram.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "hashfn.h"
+#include "helpers.h"
+#include "unichar.h"
+
+namespace tesseract {
+
+// Identifies a serialized CharNgram (and its format version).
+static const inT32 kCharNgramMagic = 0x4d474e31;  // "1NGM"
+// Seeds of the ngram hashes and (in training only) of the context hashes.
+static const uinT64 kNgramSeed = 0xcbf29ce484222325ULL;
+static const uinT64 kContextSeed = 0x84222325cbf29ce4ULL;
+// Multiplier used to combine a character with a hash.
+static const uinT64 kHashPrime = 0x100000001b3ULL;
+// Stupid backoff penalty: P is multiplied by this for each shorter context.
+static const double kBackoffFactor = 0.4;
+// Fraction of the hash table that may be filled.
+static const double kMaxLoadFactor = 0.75;
+
+const double CharNgram::kMaxCost = 32.0;
+
+// Returns a key for the UTF-8 character of the given length in bytes.
+static inline uinT32 CharKey(const char* utf8, int length) {
+  uinT32 key = 0;
+  for (int i = 0; i < length && i < 4; ++i) {
+    key = (key << 8) | static_cast<unsigned char>(utf8[i]);
+  }
+  return key;
+}
+
+// Appends the character with the given key to the hash.
+static inline uinT64 ExtendHash(uinT64 hash, uinT32 char_key) {
+  hash = (hash ^ char_key) * kHashPrime;
+  return hash ^ (hash >> 32);
+}
+
+// Final mix of the hash bits before they are used to index the table.
+static inline uinT64 FinalizeHash(uinT64 hash) {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+static inline uinT32 Fingerprint(uinT64 final_hash) {
+  uinT32 fingerprint = static_cast<uinT32>(final_hash >> 32);
+  return fingerprint == 0 ? 1 : fingerprint;
+}
+
+// Converts a cost in bits to the quantized representation.
+static inline int QuantizeCost(double cost, double max_cost) {
+  int q = IntCastRounded(cost * MAX_UINT8 / max_cost);
+  return ClipToRange(q, 0, static_cast<int>(MAX_UINT8));
+}
+
+CharNgram::CharNgram()
+  : order_(0), backoff_cost_(0), unseen_cost_(MAX_UINT8), num_entries_(0) {}
+
+// Counts collected for one ngram during training.
+struct CharNgramCount {
+  CharNgramCount() : count(0), context_hash(0), context_length(0) {}
+  int count;
+  uinT64 context_hash;
+  int context_length;
+};
+
+void CharNgram::Train(const GenericVector<STRING>& lines, int order,
+                      int min_count) {
+  order_ = ClipToRange(order, 1, static_cast<int>(kMaxOrder));
+  TessHashMap<uinT64, CharNgramCount> ngram_counts;
+  TessHashMap<uinT64, int> context_counts;
+  GenericVector<uinT32> chars;
+  int total_chars = 0;
+  for (int l = 0; l < lines.size(); ++l) {
+    chars.truncate(0);
+    chars.push_back(CharKey(" ", 1));
+    const char* ptr = lines[l].string();
+    const char* end = ptr + lines[l].length();
+    while (ptr < end) {
+      int step = UNICHAR::utf8_step(ptr);
+      if (step <= 0 || ptr + step > end) {
+        ++ptr;  // Skip invalid UTF-8.
+        continue;
+      }
+      if (*ptr != '\n' && *ptr != '\r') chars.push_back(CharKey(ptr, step));
+      ptr += step;
+    }
+    for (int i = 1; i < chars.size(); ++i) {
+      uinT64 hash = ExtendHash(kNgramSeed, chars[i]);
+      uinT64 context_hash = kContextSeed;
+      for (int k = 0; k < order_ && k <= i; ++k) {
+        if (k > 0) {
+          hash = ExtendHash(hash, chars[i - k]);
+          context_hash = ExtendHash(context_hash, chars[i - k]);
+        }
+        CharNgramCount& ngram = ngram_counts[hash];
+        ++ngram.count;
+        ngram.context_hash = context_hash;
+        ngram.context_length = k;
+        ++context_counts[context_hash];
+      }
+      ++total_chars;
+    }
+  }
+
+  backoff_cost_ = QuantizeCost(-log2(kBackoffFactor), kMaxCost);
+  unseen_cost_ = QuantizeCost(log2(total_chars + 1.0), kMaxCost);
+  int num_kept = 0;
+  TessHashMap<uinT64, CharNgramCount>::const_iterator it;
+  for (it = ngram_counts.begin(); it != ngram_counts.end(); ++it) {
+    if (it->second.context_length == 0 || it->second.count >= min_count)
+      ++num_kept;
+  }
+  int table_size = 16;
+  while (table_size * kMaxLoadFactor < num_kept) table_size *= 2;
+  fingerprints_.init_to_size(table_size, 0);
+  costs_.init_to_size(table_size, 0);
+  num_entries_ = 0;
+  for (it = ngram_counts.begin(); it != ngram_counts.end(); ++it) {
+    const CharNgramCount& ngram = it->second;
+    if (ngram.context_length > 0 && ngram.count < min_count) continue;
+    double cost = -log2(static_cast<double>(ngram.count) /
+                        context_counts[ngram.context_hash]);
+    Insert(it->first, QuantizeCost(cost, kMaxCost));
+  }
+}
+
+double CharNgram::Probability(const char* context, int context_bytes,
+                              const char* character,
+                              int character_bytes) const {
+  if (empty() || character_bytes == 0) return 0.0;
+  int char_step = UNICHAR::utf8_step(character);
+  if (char_step <= 0) return 0.0;
+  if (character_bytes > 0 && char_step > character_bytes) return 0.0;
+  // hashes[k] is the hash of the ngram with k characters of context.
+  uinT64 hashes[kMaxOrder];
+  hashes[0] = ExtendHash(kNgramSeed, CharKey(character, char_step));
+  int num_context = 0;
+  if (context != NULL) {
+    if (context_bytes < 0) context_bytes = strlen(context);
+    const char* char_end = context + context_bytes;
+    while (num_context + 1 < order_ && char_end > context) {
+      const char* char_start = char_end - 1;
+      while (char_start > context &&
+             (static_cast<unsigned char>(*char_start) & 0xc0) == 0x80) {
+        --char_start;
+      }
+      hashes[num_context + 1] =
+          ExtendHash(hashes[num_context],
+                     CharKey(char_start, char_end - char_start));
+      ++num_context;
+      char_end = char_start;
+    }
+  }
+  int cost = unseen_cost_;
+  for (int k = num_context; k >= 0; --k) {
+    int ngram_cost = Lookup(hashes[k]);
+    if (ngram_cost >= 0) {
+      cost = ngram_cost + backoff_cost_ * (num_context - k);
+      break;
+    }
+  }
+  return pow(2.0, -cost * kMaxCost / MAX_UINT8);
+}
+
+int CharNgram::Lookup(uinT64 hash) const {
+  uinT64 final_hash = FinalizeHash(hash);
+  uinT32 fingerprint = Fingerprint(final_hash);
+  int mask = fingerprints_.size() - 1;
+  for (int index = final_hash & mask; fingerprints_[index] != 0;
+       index = (index + 1) & mask) {
+    if (fingerprints_[index] == fingerprint) return costs_[index];
+  }
+  return -1;
+}
+
+void CharNgram::Insert(uinT64 hash, uinT8 quantized_cost) {
+  uinT64 final_hash = FinalizeHash(hash);
+  uinT32 fingerprint = Fingerprint(final_hash);
+  int mask = fingerprints_.size() - 1;
+  int index = final_hash & mask;
+  while (fingerprints_[index] != 0) {
+    // On a fingerprint collision the first ngram inserted wins.
+    if (fingerprints_[index] == fingerprint) return;
+    index = (index + 1) & mask;
+  }
+  fingerprints_[index] = fingerprint;
+  costs_[index] = quantized_cost;
+  ++num_entries_;
+}
+
+bool CharNgram::Serialize(FILE* fp) const {
+  if (fwrite(&kCharNgramMagic, sizeof(kCharNgramMagic), 1, fp) != 1)
+    return false;
+  if (fwrite(&order_, sizeof(order_), 1, fp) != 1) return false;
+  if (fwrite(&backoff_cost_, sizeof(backoff_cost_), 1, fp) != 1) return false;
+  if (fwrite(&unseen_cost_, sizeof(unseen_cost_), 1, fp) != 1) return false;
+  if (fwrite(&num_entries_, sizeof(num_entries_), 1, fp) != 1) return false;
+  if (!fingerprints_.Serialize(fp)) return false;
+  if (!costs_.Serialize(fp)) return false;
+  return true;
+}
+
+bool CharNgram::DeSerialize(bool swap, FILE* fp) {
+  inT32 magic;
+  if (fread(&magic, sizeof(magic), 1, fp) != 1) return false;
+  if (fread(&order_, sizeof(order_), 1, fp) != 1) return false;
+  if (fread(&backoff_cost_, sizeof(backoff_cost_), 1, fp) != 1) return false;
+  if (fread(&unseen_cost_, sizeof(unseen_cost_), 1, fp) != 1) return false;
+  if (fread(&num_entries_, sizeof(num_entries_), 1, fp) != 1) return false;
+  if (swap) {
+    ReverseN(&magic, sizeof(magic));
+    ReverseN(&order_, sizeof(order_));
+    ReverseN(&backoff_cost_, sizeof(backoff_cost_));
+    ReverseN(&unseen_cost_, sizeof(unseen_cost_));
+    ReverseN(&num_entries_, sizeof(num_entries_));
+  }
+  if (magic != kCharNgramMagic || order_ < 1 || order_ > kMaxOrder) {
+    num_entries_ = 0;
+    return false;
+  }
+  if (!fingerprints_.DeSerialize(swap, fp)) return false;
+  if (!costs_.DeSerialize(swap, fp)) return false;
+  int table_size = fingerprints_.size();
+  if (table_size == 0 || (table_size & (table_size - 1)) != 0 ||
+      costs_.size() != table_size || num_entries_ >= table_size) {
+    num_entries_ = 0;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace tesseract
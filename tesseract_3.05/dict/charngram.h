@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////
+// File:        charngram.h
+// Description: Compact, hashed character ngram model.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////
+
+#ifndef TESSERACT_DICT_CHARNGRAM_H_
+#define TESSERACT_DICT_CHARNGRAM_H_
+
+#include <stdio.h>
+
+#include "genericvector.h"
+#include "host.h"
+#include "strngs.h"
+
+namespace tesseract {
+
+// Character ngram model that can be stored as the char-ngram component of a
+// traineddata file and used as the Dict::probability_in_context_ function
+// (see Dict::char_ngram_probability_in_context).
+//
+// Characters are UTF-8 code points. The ngrams are not stored as strings:
+// each ngram is reduced to a 64 bit hash that is built up one character at a
+// time, starting at the predicted character and walking back through the
+// context, so a query computes the keys of all the orders in one pass over
+// the context bytes without copying them. The table keeps a 32 bit
+// fingerprint of the hash and the conditional cost -log2(P(c | context))
+// quantized to 8 bits, i.e. 5 bytes per ngram. Fingerprint collisions are
+// possible but rare, and only make an unseen ngram look seen.
+//
+// Unseen ngrams back off to shorter contexts, paying a fixed cost per
+// backoff step ("stupid backoff"), and characters that were never seen get
+// the cost of a character with count 1 in the training text.
+class CharNgram {
+ public:
+  // Longest ngram (context + predicted character) that can be stored.
+  static const int kMaxOrder = 8;
+
+  CharNgram();
+  ~CharNgram() {}
+
+  bool empty() const { return num_entries_ == 0; }
+  int order() const { return order_; }
+  int num_entries() const { return num_entries_; }
+
+  // Builds the model from the given text. Every line is treated as if it
+  // was preceded by a space, as the language model supplies a space as the
+  // context at the start of a line. Ngrams seen fewer than min_count times
+  // are dropped (unigrams are always kept).
+  void Train(const GenericVector<STRING>& lines, int order, int min_count);
+
+  // Returns P(character | context) estimated by the model. Only the last
+  // order() - 1 characters of the context are used. If context_bytes is
+  // negative, context is treated as a null-terminated string. The character
+  // may contain several UTF-8 code points, in which case only the first one
+  // is predicted.
+  double Probability(const char* context, int context_bytes,
+                     const char* character, int character_bytes) const;
+
+  // Writes to the given file. Returns false in case of error.
+  bool Serialize(FILE* fp) const;
+  // Reads from the given file. Returns false in case of error, including
+  // the case where the data at fp is not a character ngram model.
+  // If swap is true, assumes a big/little-endian swap is needed.
+  bool DeSerialize(bool swap, FILE* fp);
+
+ private:
+  // Returns the quantized cost stored for the ngram with the given hash, or
+  // -1 if it is not in the table.
+  int Lookup(uinT64 hash) const;
+  // Adds the given ngram hash to the table. The table must have room.
+  void Insert(uinT64 hash, uinT8 quantized_cost);
+
+  // Maximum cost that can be represented after quantization.
+  static const double kMaxCost;
+
+  // Ngram order used to build the model.
+  inT32 order_;
+  // Cost of each backoff to a shorter context (in quantized units).
+  inT32 backoff_cost_;
+  // Cost of a character that is not in the model (in quantized units).
+  inT32 unseen_cost_;
+  // Number of ngrams stored in the table.
+  inT32 num_entries_;
+  // Open addressing hash table (size is a power of 2). fingerprints_ holds
+  // the upper 32 bits of the ngram hash (0 for an empty slot) and costs_ the
+  // quantized -log2(P(c | context)).
+  GenericVector<uinT32> fingerprints_;
+  GenericVector<uinT8> costs_;
+};
+
+}  // namespace tesseract
+
+#endif  // TESSERACT_DICT_CHARNGRAM_H_
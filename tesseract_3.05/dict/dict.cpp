@@ -65,6 +65,10 @@ Dict::Dict(CCUtil *ccutil)
                        "Load dawg with special word "
                        "bigrams.",
                        getCCUtil()->params()),
+      BOOL_INIT_MEMBER(load_char_ngram, true,
+                       "Load character ngram model (used by the language"
+                       " model when language_model_ngram_on is set).",
+                       getCCUtil()->params()),
       double_MEMBER(xheight_penalty_subscripts, 0.125,
                     "Score penalty (0.1 = 10%) added if there are subscripts "
                     "or superscripts in a word, but it is otherwise OK.",
@@ -178,6 +182,7 @@ Dict::Dict(CCUtil *ccutil)
   last_word_on_line_ = false;
   hyphen_unichar_id_ = INVALID_UNICHAR_ID;
   document_words_ = NULL;
+  char_ngram_ = NULL;
   dawg_cache_ = NULL;
   dawg_cache_is_ours_ = false;
   pending_words_ = NULL;
@@ -254,6 +259,8 @@ void Dict::Load(const char *data_file_name, const STRING &lang) {
     if (unambig_dawg_) dawgs_ += unambig_dawg_;
   }
 
+  if (load_char_ngram) LoadCharNgram(data_file_name);
+
   STRING name;
   if (((STRING &)user_words_suffix).length() > 0 ||
       ((STRING &)user_words_file).length() > 0) {
@@ -324,7 +331,36 @@ bool Dict::FinishLoad() {
   return true;
 }
 
+// Loads the character ngram model from the traineddata, if it has one, and
+// makes it the probability_in_context_ function, unless the latter was
+// already replaced by another implementation.
+void Dict::LoadCharNgram(const char *data_file_name) {
+  if (char_ngram_ != NULL) return;  // Already loaded.
+  TessdataManager data_loader;
+  if (!data_loader.Init(data_file_name, dawg_debug_level)) return;
+  if (data_loader.SeekToStart(TESSDATA_CHAR_NGRAM)) {
+    char_ngram_ = new CharNgram;
+    if (!char_ngram_->DeSerialize(data_loader.swap(),
+                                  data_loader.GetDataFilePtr())) {
+      tprintf("Error: failed to load the character ngram model\n");
+      delete char_ngram_;
+      char_ngram_ = NULL;
+    } else if (probability_in_context_ ==
+               &tesseract::Dict::def_probability_in_context) {
+      probability_in_context_ =
+          &tesseract::Dict::char_ngram_probability_in_context;
+    }
+  }
+  data_loader.End();
+}
+
 void Dict::End() {
+  if (probability_in_context_ ==
+      &tesseract::Dict::char_ngram_probability_in_context) {
+    probability_in_context_ = &tesseract::Dict::def_probability_in_context;
+  }
+  delete char_ngram_;
+  char_ngram_ = NULL;
   if (dawgs_.length() == 0)
     return;  // Not safe to call twice.
   for (int i = 0; i < dawgs_.size(); i++) {
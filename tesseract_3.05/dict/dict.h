@@ -20,6 +20,7 @@
 #define TESSERACT_DICT_DICT_H_
 
 #include "ambigs.h"
+#include "charngram.h"
 #include "dawg.h"
 #include "dawg_cache.h"
 #include "host.h"
@@ -302,6 +303,8 @@ class Dict {
   // Completes the loading process after Load().
   // Returns false if no dictionaries were loaded.
   bool FinishLoad();
+  // Loads the char-ngram component of the given traineddata, if present.
+  void LoadCharNgram(const char *data_file_name);
   void End();
 
   // Resets the document dictionary analogous to ResetAdaptiveClassifier.
@@ -388,6 +391,15 @@ class Dict {
     (void)character_bytes;
     return 0.0;
   }
+  /// Implementation of probability in context function that uses the
+  /// character ngram model loaded from the char-ngram tessdata component.
+  double char_ngram_probability_in_context(
+      const char* lang, const char* context, int context_bytes,
+      const char* character, int character_bytes) {
+    (void)lang;
+    return char_ngram_->Probability(context, context_bytes,
+                                    character, character_bytes);
+  }
   double ngram_probability_in_context(const char* lang,
                                       const char* context,
                                       int context_bytes,
@@ -542,6 +554,8 @@ class Dict {
   Dawg *unambig_dawg_;
   Dawg *punc_dawg_;
   Trie *document_words_;
+  /// Character ngram model (owned), NULL if the traineddata has none.
+  CharNgram *char_ngram_;
   /// Current segmentation cost adjust factor for word rating.
   /// See comments in incorporate_segcost.
   float wordseg_rating_adjust_factor_;
@@ -567,6 +581,9 @@ class Dict {
   BOOL_VAR_H(load_number_dawg, true, "Load dawg with number patterns.");
   BOOL_VAR_H(load_bigram_dawg, true,
              "Load dawg with special word bigrams.");
+  BOOL_VAR_H(load_char_ngram, true,
+             "Load character ngram model (used by the language model"
+             " when language_model_ngram_on is set).");
   double_VAR_H(xheight_penalty_subscripts, 0.125,
                "Score penalty (0.1 = 10%) added if there are subscripts "
                "or superscripts in a word, but it is otherwise OK.");
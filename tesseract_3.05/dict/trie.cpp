@@ -37,6 +37,7 @@
 #include "genericvector.h"
 #include "helpers.h"
 #include "kdpair.h"
+#include "svutil.h"
 
 namespace tesseract {
 
@@ -307,23 +308,13 @@ bool Trie::read_word_list(const char *filename,
   word_file = fopen(filename, "rb");
   if (word_file == NULL) return false;
 
+  WERD_CHOICE word(&unicharset);
   while (fgets(string, CHARS_PER_LINE, word_file) != NULL) {
-    chomp_string(string);  // remove newline
-    WERD_CHOICE word(string, unicharset);
-    if ((reverse_policy == RRP_REVERSE_IF_HAS_RTL &&
-        word.has_rtl_unichar_id()) ||
-        reverse_policy == RRP_FORCE_REVERSE) {
-      word.reverse_and_mirror_unichar_ids();
-    }
     ++word_count;
     if (debug_level_ && word_count % 10000 == 0)
       tprintf("Read %d words so far\n", word_count);
-    if (word.length() != 0 && !word.contains_unichar_id(INVALID_UNICHAR_ID)) {
+    if (word_from_line(string, unicharset, reverse_policy, &word))
       words->push_back(word.unichar_string());
-    } else if (debug_level_) {
-      tprintf("Skipping invalid word %s\n", string);
-      if (debug_level_ >= 3) word.print();
-    }
   }
   if (debug_level_)
     tprintf("Read %d words total.\n", word_count);
@@ -331,6 +322,25 @@ bool Trie::read_word_list(const char *filename,
   return true;
 }
 
+bool Trie::word_from_line(char *line, const UNICHARSET &unicharset,
+                          Trie::RTLReversePolicy reverse_policy,
+                          WERD_CHOICE *word) const {
+  chomp_string(line);  // remove newline
+  *word = WERD_CHOICE(line, unicharset);
+  if ((reverse_policy == RRP_REVERSE_IF_HAS_RTL &&
+      word->has_rtl_unichar_id()) ||
+      reverse_policy == RRP_FORCE_REVERSE) {
+    word->reverse_and_mirror_unichar_ids();
+  }
+  if (word->length() != 0 && !word->contains_unichar_id(INVALID_UNICHAR_ID))
+    return true;
+  if (debug_level_) {
+    tprintf("Skipping invalid word %s\n", line);
+    if (debug_level_ >= 3) word->print();
+  }
+  return false;
+}
+
 bool Trie::add_word_list(const GenericVector<STRING>& words,
                    const UNICHARSET &unicharset) {
   for (int i = 0; i < words.size(); ++i) {
@@ -508,6 +518,151 @@ void Trie::remove_edge_linkage(NODE_REF node1, NODE_REF node2, int direction,
   --num_edges_;
 }
 
+// Each unichar id of a word is encoded in kWordKeyBytes bytes of 7 bits with
+// the top bit set, so that the keys of words contain no zero bytes and
+// strcmp orders them by their unichar ids.
+const int kWordKeyBytes = 3;
+
+static void EncodeWordKey(const WERD_CHOICE &word, STRING *key) {
+  *key = "";
+  for (int i = 0; i < word.length(); ++i) {
+    UNICHAR_ID unichar_id = word.unichar_id(i);
+    for (int b = kWordKeyBytes - 1; b >= 0; --b)
+      *key += static_cast<char>(0x80 | ((unichar_id >> (7 * b)) & 0x7f));
+  }
+}
+
+static void DecodeWordKey(const STRING &key, WERD_CHOICE *word) {
+  const char *bytes = key.string();
+  for (int i = 0; i + kWordKeyBytes <= key.length(); i += kWordKeyBytes) {
+    UNICHAR_ID unichar_id = 0;
+    for (int b = 0; b < kWordKeyBytes; ++b)
+      unichar_id = (unichar_id << 7) | (bytes[i + b] & 0x7f);
+    word->append_unichar_id(unichar_id, 1, 0.0, 0.0);
+  }
+}
+
+// Sort function to sort word keys by unichar ids.
+static int sort_word_keys(const void* v1, const void* v2) {
+  const STRING* s1 = reinterpret_cast<const STRING*>(v1);
+  const STRING* s2 = reinterpret_cast<const STRING*>(v2);
+  return strcmp(s1->string(), s2->string());
+}
+
+// The parts of a sorted word list that are built in parallel, each holding
+// the words with a given first unichar.
+struct DawgBuildTasks {
+  const UNICHARSET *unicharset;
+  const GenericVector<STRING> *keys;
+  GenericVector<int> part_starts;
+  GenericVector<MinimalDawgBuilder *> builders;
+};
+
+// Builds the dawg of the words of tasks->part_starts[index].
+static void BuildDawgPart(void *arg, int index) {
+  DawgBuildTasks *tasks = static_cast<DawgBuildTasks *>(arg);
+  MinimalDawgBuilder *builder = new MinimalDawgBuilder;
+  for (int i = tasks->part_starts[index]; i < tasks->part_starts[index + 1];
+       ++i) {
+    WERD_CHOICE word(tasks->unicharset);
+    DecodeWordKey((*tasks->keys)[i], &word);
+    builder->add_word(word);
+  }
+  builder->finish();
+  tasks->builders[index] = builder;
+}
+
+SquishedDawg *Trie::read_word_list_to_dawg(
+    const char *filename, const UNICHARSET &unicharset,
+    Trie::RTLReversePolicy reverse_policy, int num_threads) {
+  FILE *word_file = fopen(filename, "rb");
+  if (word_file == NULL) return NULL;
+  char string[CHARS_PER_LINE];
+  int word_count = 0;
+  WERD_CHOICE word(&unicharset);
+  if (num_threads <= 1) {
+    MinimalDawgBuilder builder;
+    bool in_order = true;
+    while (in_order && fgets(string, CHARS_PER_LINE, word_file) != NULL) {
+      ++word_count;
+      if (debug_level_ && word_count % 10000 == 0)
+        tprintf("Read %d words so far\n", word_count);
+      if (word_from_line(string, unicharset, reverse_policy, &word))
+        in_order = builder.add_word(word);
+    }
+    if (in_order) {
+      if (debug_level_)
+        tprintf("Read %d words total.\n", word_count);
+      fclose(word_file);
+      builder.finish();
+      return minimal_dawg_to_squished(builder);
+    }
+    tprintf("Word list is not sorted at line %d, sorting it in memory\n",
+            word_count);
+    rewind(word_file);
+    word_count = 0;
+  }
+  GenericVector<STRING> keys;
+  while (fgets(string, CHARS_PER_LINE, word_file) != NULL) {
+    ++word_count;
+    if (debug_level_ && word_count % 10000 == 0)
+      tprintf("Read %d words so far\n", word_count);
+    if (word_from_line(string, unicharset, reverse_policy, &word)) {
+      keys.push_back(STRING());
+      EncodeWordKey(word, &keys.back());
+    }
+  }
+  if (debug_level_)
+    tprintf("Read %d words total.\n", word_count);
+  fclose(word_file);
+  keys.sort(sort_word_keys);
+  DawgBuildTasks tasks;
+  tasks.unicharset = &unicharset;
+  tasks.keys = &keys;
+  for (int i = 0; i < keys.size(); ++i) {
+    if (i == 0 || strncmp(keys[i].string(), keys[i - 1].string(),
+                          kWordKeyBytes) != 0)
+      tasks.part_starts.push_back(i);
+  }
+  int num_parts = tasks.part_starts.size();
+  tasks.part_starts.push_back(keys.size());
+  tasks.builders.init_to_size(num_parts, NULL);
+  SVSync::ParallelFor(num_parts, num_threads, BuildDawgPart, &tasks);
+  MinimalDawgBuilder builder;
+  for (int p = 0; p < num_parts; ++p) {
+    builder.add_dawg(*tasks.builders[p]);
+    delete tasks.builders[p];
+  }
+  builder.finish();
+  return minimal_dawg_to_squished(builder);
+}
+
+SquishedDawg *Trie::minimal_dawg_to_squished(
+    const MinimalDawgBuilder &builder) {
+  // The root goes first, followed by the other nodes in order, so the
+  // EDGE_ARRAY index of a node is its edge index in the builder plus the
+  // number of root edges.
+  int num_root_edges = builder.node_end(0) - builder.node_start(0);
+  int num_edges = builder.num_edges();
+  EDGE_ARRAY edge_array = new EDGE_RECORD[num_edges];
+  EDGE_ARRAY edge_array_ptr = edge_array;
+  for (int node = 0; node < builder.num_nodes(); ++node) {
+    int start = builder.node_start(node);
+    int end = builder.node_end(node);
+    for (int e = start; e < end; ++e) {
+      int target = builder.edge_target(e);
+      NODE_REF node_ref =
+          target == 0 ? 0 : num_root_edges + builder.node_start(target);
+      link_edge(edge_array_ptr, node_ref, false, FORWARD_EDGE,
+                builder.edge_word_end(e), builder.edge_unichar_id(e));
+      if (e == end - 1) set_marker_flag_in_edge_rec(edge_array_ptr);
+      ++edge_array_ptr;
+    }
+  }
+  return new SquishedDawg(edge_array, num_edges, type_, lang_,
+                          perm_, unicharset_size_, debug_level_);
+}
+
 // Some optimizations employed in add_word_to_dawg and trie_to_dawg:
 // 1 Avoid insertion sorting or bubble sorting the tail root node
 //   (back links on node 0, a list of all the leaves.). The node is
@@ -733,4 +888,148 @@ void Trie::print_node(NODE_REF node, int max_num_edges) const {
   }
 }
 
+// Initial size of the hash table of the final nodes. Must be a power of 2.
+const int kInitialNodeTableSize = 1024;
+
+MinimalDawgBuilder::MinimalDawgBuilder() : finished_(false) {
+  node_starts_.push_back(0);  // The root.
+  node_table_.init_to_size(kInitialNodeTableSize, 0);
+  active_nodes_.push_back(GenericVector<uinT64>());
+  pending_word_ends_.push_back(false);
+}
+
+bool MinimalDawgBuilder::add_word(const WERD_CHOICE &word) {
+  ASSERT_HOST(!finished_);
+  int length = word.length();
+  if (length == 0) return true;
+  int prefix = 0;
+  while (prefix < length && prefix < last_word_.size() &&
+         word.unichar_id(prefix) == last_word_[prefix]) {
+    ++prefix;
+  }
+  if (prefix == length) {
+    // A prefix of the last word (or the same word), which only needs its
+    // last edge to be marked as a word end.
+    freeze_word_suffix(length);
+    pending_word_ends_[length - 1] = true;
+    return true;
+  }
+  // The word is out of order if a word before the last one already went
+  // through the node at the end of the common prefix with the same unichar.
+  UNICHAR_ID next_id = word.unichar_id(prefix);
+  const GenericVector<uinT64> &node = active_nodes_[prefix];
+  for (int e = 0; e < node.size(); ++e) {
+    if (static_cast<UNICHAR_ID>(node[e] >> kUnicharShift) == next_id)
+      return false;
+  }
+  freeze_word_suffix(prefix);
+  for (int depth = prefix; depth < length; ++depth) {
+    last_word_.push_back(word.unichar_id(depth));
+    if (active_nodes_.size() <= depth + 1) {
+      active_nodes_.push_back(GenericVector<uinT64>());
+      pending_word_ends_.push_back(false);
+    }
+    pending_word_ends_[depth] = depth == length - 1;
+  }
+  return true;
+}
+
+void MinimalDawgBuilder::freeze_word_suffix(int depth) {
+  for (int d = last_word_.size(); d > depth; --d) {
+    int node = freeze_node(&active_nodes_[d]);
+    active_nodes_[d].truncate(0);
+    uinT64 edge = static_cast<uinT64>(last_word_[d - 1]) << kUnicharShift;
+    if (pending_word_ends_[d - 1]) edge |= kWordEndBit;
+    active_nodes_[d - 1].push_back(edge | node);
+  }
+  last_word_.truncate(depth);
+}
+
+bool MinimalDawgBuilder::add_dawg(const MinimalDawgBuilder &other) {
+  if (finished_ || !last_word_.empty() || !other.finished_) return false;
+  GenericVector<uinT64> &root = active_nodes_[0];
+  for (int e = other.node_start(0); e < other.node_end(0); ++e) {
+    for (int r = 0; r < root.size(); ++r) {
+      if ((root[r] >> kUnicharShift) == (other.edges_[e] >> kUnicharShift))
+        return false;
+    }
+  }
+  // Node numbers in other are in the order the nodes were frozen, so the
+  // targets of each node have been mapped before the node itself, and the
+  // root, which was frozen last, goes last.
+  GenericVector<int> node_map;
+  node_map.init_to_size(other.num_nodes(), 0);
+  GenericVector<uinT64> edges;
+  for (int n = 1; n <= other.num_nodes(); ++n) {
+    int node = n < other.num_nodes() ? n : 0;
+    edges.truncate(0);
+    for (int e = other.node_start(node); e < other.node_end(node); ++e) {
+      uinT64 edge = other.edges_[e];
+      edges.push_back((edge & ~kTargetMask) | node_map[edge & kTargetMask]);
+    }
+    if (node > 0) {
+      node_map[node] = freeze_node(&edges);
+    } else {
+      for (int e = 0; e < edges.size(); ++e) root.push_back(edges[e]);
+    }
+  }
+  return true;
+}
+
+void MinimalDawgBuilder::finish() {
+  if (finished_) return;
+  freeze_word_suffix(0);
+  GenericVector<uinT64> &root = active_nodes_[0];
+  root.sort();
+  node_starts_[0] = edges_.size();
+  for (int e = 0; e < root.size(); ++e) edges_.push_back(root[e]);
+  active_nodes_.clear();
+  pending_word_ends_.clear();
+  node_table_.clear();
+  finished_ = true;
+}
+
+int MinimalDawgBuilder::freeze_node(GenericVector<uinT64> *edges) {
+  int num_edges = edges->size();
+  if (num_edges == 0) return 0;
+  edges->sort();
+  const uinT64 *node_edges = &(*edges)[0];
+  int mask = node_table_.size() - 1;
+  int index = hash_edges(node_edges, num_edges) & mask;
+  for (; node_table_[index] != 0; index = (index + 1) & mask) {
+    int node = node_table_[index];
+    int start = node_starts_[node];
+    if (node_end(node) - start == num_edges &&
+        memcmp(&edges_[start], node_edges, num_edges * sizeof(uinT64)) == 0)
+      return node;
+  }
+  int node = node_starts_.size();
+  node_starts_.push_back(edges_.size());
+  for (int e = 0; e < num_edges; ++e) edges_.push_back(node_edges[e]);
+  node_table_[index] = node;
+  if (node * 2 > node_table_.size()) grow_table();
+  return node;
+}
+
+uinT64 MinimalDawgBuilder::hash_edges(const uinT64 *edges, int num_edges) {
+  uinT64 hash = num_edges;
+  for (int e = 0; e < num_edges; ++e) {
+    hash = (hash ^ edges[e]) * 0x100000001b3ULL;
+    hash ^= hash >> 29;
+  }
+  return hash;
+}
+
+void MinimalDawgBuilder::grow_table() {
+  int size = node_table_.size() * 2;
+  node_table_.init_to_size(size, 0);
+  int mask = size - 1;
+  for (int node = 1; node < node_starts_.size(); ++node) {
+    int start = node_starts_[node];
+    int index = hash_edges(&edges_[start], node_end(node) - start) & mask;
+    while (node_table_[index] != 0) index = (index + 1) & mask;
+    node_table_[index] = node;
+  }
+}
+
 }  // namespace tesseract
@@ -53,6 +53,93 @@ typedef GenericVector<TRIE_NODE_RECORD *> TRIE_NODES;
 
 namespace tesseract {
 
+/**
+ * Builds the minimal dawg of a list of words one word at a time, with the
+ * algorithm for sorted input of Daciuk et al., "Incremental Construction of
+ * Minimal Acyclic Finite-State Automata" (2000), instead of building a Trie
+ * and reducing it. The words must arrive grouped by prefix (in terms of
+ * unichar ids), as they do when they are sorted. Then the nodes that the
+ * last word does not pass through can never change again, so each is
+ * replaced by an equivalent node if one exists as soon as the words have
+ * moved past it. Apart from the current word, the memory used is just that
+ * of the minimal dawg.
+ * The builder is turned into a SquishedDawg by Trie::minimal_dawg_to_squished.
+ */
+class MinimalDawgBuilder {
+ public:
+  MinimalDawgBuilder();
+
+  // Adds the given word. Returns false if the word is out of order, ie if
+  // an earlier word with a different next unichar at some point was not a
+  // prefix of the previous word, in which case the word is not added.
+  // Duplicates of the previous word are ignored.
+  bool add_word(const WERD_CHOICE &word);
+  // Adds the words of the given finished builder, replacing its nodes by
+  // equivalent nodes of this builder where there are any. The words must
+  // start with different unichars than those already added with add_dawg,
+  // and no words may have been added with add_word. This allows a sorted
+  // word list to be split by first unichar and built in parallel.
+  // Returns false if any of the above does not hold.
+  bool add_dawg(const MinimalDawgBuilder &other);
+  // Finishes the nodes of the last word. No more words may be added.
+  void finish();
+
+  // Accessors for the finished dawg. Node 0 is the root. The other nodes
+  // are numbered from 1, and a target of 0 means an edge has no next node.
+  int num_nodes() const { return node_starts_.size(); }
+  int num_edges() const { return edges_.size(); }
+  int node_start(int node) const { return node_starts_[node]; }
+  int node_end(int node) const {
+    if (node > 0 && node + 1 < node_starts_.size())
+      return node_starts_[node + 1];
+    return node > 0 && finished_ ? node_starts_[0] : edges_.size();
+  }
+  UNICHAR_ID edge_unichar_id(int edge) const {
+    return static_cast<UNICHAR_ID>(edges_[edge] >> kUnicharShift);
+  }
+  bool edge_word_end(int edge) const {
+    return (edges_[edge] & kWordEndBit) != 0;
+  }
+  int edge_target(int edge) const {
+    return static_cast<int>(edges_[edge] & kTargetMask);
+  }
+
+ private:
+  // An edge is packed into a uinT64 as the unichar id, the word end flag and
+  // the target node, so that sorting edges sorts them by unichar id.
+  static const int kUnicharShift = 33;
+  static const uinT64 kWordEndBit = 1ULL << 32;
+  static const uinT64 kTargetMask = kWordEndBit - 1;
+
+  // Makes the node of the given edges final, and returns its number, which
+  // is that of an existing equivalent node if there is one, or 0 if edges
+  // is empty.
+  int freeze_node(GenericVector<uinT64> *edges);
+  // Freezes the nodes of the last word deeper than the given depth.
+  void freeze_word_suffix(int depth);
+  // Returns a hash of the edges of a node.
+  static uinT64 hash_edges(const uinT64 *edges, int num_edges);
+  // Doubles the size of the hash table of the final nodes.
+  void grow_table();
+
+  // The edges of all the final nodes, and the first edge of each. The root
+  // is node 0, and its edges are added last, by finish().
+  GenericVector<uinT64> edges_;
+  GenericVector<int> node_starts_;
+  // Open addressing hash table of the numbers of the final nodes (except the
+  // root), with 0 for an empty slot.
+  GenericVector<int> node_table_;
+  // The edges of the nodes that the last word passes through, indexed by
+  // the depth in the word. These can still have edges added. The edge of
+  // each that the last word takes is not added until its target is frozen,
+  // so only its word end flag is kept, in pending_word_ends_.
+  GenericVector<GenericVector<uinT64> > active_nodes_;
+  GenericVector<bool> pending_word_ends_;
+  // The unichar ids of the last word.
+  GenericVector<UNICHAR_ID> last_word_;
+  bool finished_;
+};
+
 /**
  * Concrete class for Trie data structure that allows to store a list of
  * words (extends Dawg base class) as well as dynamically add new words.
@@ -189,6 +276,22 @@ class Trie : public Dawg {
   bool add_word_list(const GenericVector<STRING>& words,
                      const UNICHARSET &unicharset);
 
+  // Reads a list of words from the given file as read_word_list does, and
+  // returns the minimal SquishedDawg of them built with MinimalDawgBuilder,
+  // without adding them to the Trie. With num_threads <= 1 and a word list
+  // that is sorted (or at least grouped by prefix), the words are added as
+  // they are read, so only the dawg is held in memory. Otherwise the words
+  // are sorted in memory, split by first unichar and the parts are built
+  // on num_threads threads and then merged.
+  // Returns NULL on error.
+  SquishedDawg *read_word_list_to_dawg(const char *filename,
+                                       const UNICHARSET &unicharset,
+                                       Trie::RTLReversePolicy reverse_policy,
+                                       int num_threads);
+  // Writes the edges of the given finished builder to an EDGE_ARRAY and
+  // creates a SquishedDawg with the type, language and permuter of the Trie.
+  SquishedDawg *minimal_dawg_to_squished(const MinimalDawgBuilder &builder);
+
   // Inserts the list of patterns from the given file into the Trie.
   // The pattern list file should contain one pattern per line in UTF-8 format.
   //
@@ -286,6 +389,13 @@ class Trie : public Dawg {
   // the next node index).
   //
 
+  // Makes a word from a line of a word list, removing the newline and
+  // reversing it according to reverse_policy. Returns false if the word is
+  // empty or has unichars that are not in the unicharset.
+  bool word_from_line(char *line, const UNICHARSET &unicharset,
+                      Trie::RTLReversePolicy reverse_policy,
+                      WERD_CHOICE *word) const;
+
   // Returns the pointer to EDGE_RECORD after decoding the location
   // of the edge from the information in the given EDGE_REF.
   // This function assumes that EDGE_REF holds valid node/edge indices.
@@ -275,16 +275,21 @@ void Textord::TextordPage(PageSegMode pageseg_mode, const FCOORD& reskew,
   }
 
   TO_BLOCK_IT to_block_it(to_blocks);
-  TO_BLOCK* to_block = to_block_it.data();
   // Make the rows in the block.
   float gradient;
   // Do it the old fashioned way.
   if (PSM_LINE_FIND_ENABLED(pageseg_mode)) {
     gradient = make_rows(page_tr_, to_blocks);
   } else if (!PSM_SPARSE(pageseg_mode)) {
-    // RAW_LINE, SINGLE_LINE, SINGLE_WORD and SINGLE_CHAR all need a single row.
-    gradient = make_single_row(page_tr_, pageseg_mode != PSM_RAW_LINE,
-                               to_block, to_blocks);
+    // RAW_LINE, SINGLE_LINE, SINGLE_WORD and SINGLE_CHAR all need a single row
+    // per block. There is normally only one block, but the caller may supply
+    // several regions to be recognized together.
+    gradient = 0.0f;
+    for (to_block_it.mark_cycle_pt(); !to_block_it.cycled_list();
+         to_block_it.forward()) {
+      gradient = make_single_row(page_tr_, pageseg_mode != PSM_RAW_LINE,
+                                 to_block_it.data(), to_blocks);
+    }
   } else {
     gradient = 0.0f;
   }
@@ -302,9 +307,12 @@ void Textord::TextordPage(PageSegMode pageseg_mode, const FCOORD& reskew,
     // SINGLE_WORD and SINGLE_CHAR cram all the blobs into a
     // single word, and in SINGLE_CHAR mode, all the outlines
     // go in a single blob.
-    TO_BLOCK* to_block = to_block_it.data();
-    make_single_word(pageseg_mode == PSM_SINGLE_CHAR,
-                     to_block->get_rows(), to_block->block->row_list());
+    for (to_block_it.mark_cycle_pt(); !to_block_it.cycled_list();
+         to_block_it.forward()) {
+      TO_BLOCK* to_block = to_block_it.data();
+      make_single_word(pageseg_mode == PSM_SINGLE_CHAR,
+                       to_block->get_rows(), to_block->block->row_list());
+    }
   }
   // Remove empties.
   cleanup_blocks(PSM_WORD_FIND_ENABLED(pageseg_mode), blocks);
@@ -321,13 +329,15 @@ void Textord::TextordPage(PageSegMode pageseg_mode, const FCOORD& reskew,
 }
 
 // If we were supposed to return only a single textline, and there is more
-// than one, clean up and leave only the best.
+// than one, clean up and leave only the best. This is done separately for
+// each block, in case the caller supplied several regions.
 void Textord::CleanupSingleRowResult(PageSegMode pageseg_mode,
                                      PAGE_RES* page_res) {
   if (PSM_LINE_FIND_ENABLED(pageseg_mode) || PSM_SPARSE(pageseg_mode))
     return;  // No cleanup required.
   PAGE_RES_IT it(page_res);
-  // Find the best row, being the greatest mean word conf.
+  // Find the best row of each block, being the greatest mean word conf.
+  GenericVector<ROW_RES*> best_rows;
   float row_total_conf = 0.0f;
   int row_word_count = 0;
   ROW_RES* best_row = NULL;
@@ -345,10 +355,20 @@ void Textord::CleanupSingleRowResult(PageSegMode pageseg_mode,
       row_total_conf = 0.0f;
       row_word_count = 0;
     }
+    if (it.next_block() != it.block()) {
+      best_rows.push_back(best_row);
+      best_row = NULL;
+    }
   }
-  // Now eliminate any word not in the best row.
+  // Now eliminate any word not in the best row of its block.
+  int block_index = -1;
+  BLOCK_RES* block = NULL;
   for (it.restart_page(); it.word() != NULL; it.forward()) {
-    if (it.row() != best_row)
+    if (it.block() != block) {
+      block = it.block();
+      ++block_index;
+    }
+    if (it.row() != best_rows[block_index])
       it.DeleteCurrentWord();
   }
 }
@@ -0,0 +1,329 @@
+/**********************************************************************
+ * File:        augmentation.cpp
+ * Description: A configurable pipeline of image distortions for synthetic
+ *              training data, and extraction of training samples from the
+ *              distorted images without writing them to files.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **********************************************************************/
+
+#include "augmentation.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "allheaders.h"   // from leptonica
+#include "blobs.h"
+#include "classify.h"
+#include "degradeimage.h"
+#include "edgblob.h"
+#include "featdefs.h"
+#include "intfx.h"
+#include "mastertrainer.h"
+#include "mf.h"
+#include "normalis.h"
+#include "normfeat.h"
+#include "ocrblock.h"
+#include "ocrfeatures.h"
+#include "picofeat.h"
+#include "stepblob.h"
+#include "trainingsample.h"
+#include "tprintf.h"
+
+namespace tesseract {
+
+// Names of the AugmentationTypes in a spec, and the params of stages that do
+// not give one.
+static const char* const kStageNames[AT_COUNT] = {
+  "degrade", "invert", "noise", "saltpepper", "blur", "perspective",
+  "elastic", "jpeg"
+};
+static const float kDefaultParams[AT_COUNT] = {
+  0.0f, 0.0f, 8.0f, 0.001f, 0.0f, 0.0f, 2.0f, 50.0f
+};
+
+// The x-height of a line is taken to be the median height of the boxes on
+// the baseline that are no taller than kMaxXHeightFraction of the tallest,
+// or if there are none, kXHeightFraction of the tallest.
+const double kMaxXHeightFraction = 0.8;
+const double kXHeightFraction = 0.7;
+
+// Adds the stages of a comma-separated spec of the form
+// name[=param][@probability],...
+// Returns false, and leaves the pipeline unchanged, on a bad spec.
+bool AugmentationPipeline::ParseSpec(const char* spec) {
+  GenericVector<STRING> stage_specs;
+  STRING(spec).split(',', &stage_specs);
+  GenericVector<AugmentationStage> stages;
+  for (int s = 0; s < stage_specs.size(); ++s) {
+    if (stage_specs[s].length() == 0) continue;
+    STRING name = stage_specs[s];
+    float probability = 1.0f;
+    const char* at = strchr(name.string(), '@');
+    if (at != NULL) {
+      char* end;
+      probability = strtod(at + 1, &end);
+      if (end == at + 1 || *end != '\0' || probability < 0.0f ||
+          probability > 1.0f) {
+        tprintf("Bad probability in augmentation stage %s\n",
+                stage_specs[s].string());
+        return false;
+      }
+      name.truncate_at(at - name.string());
+    }
+    float param = 0.0f;
+    bool has_param = false;
+    const char* equals = strchr(name.string(), '=');
+    if (equals != NULL) {
+      char* end;
+      param = strtod(equals + 1, &end);
+      if (end == equals + 1 || *end != '\0') {
+        tprintf("Bad param in augmentation stage %s\n",
+                stage_specs[s].string());
+        return false;
+      }
+      has_param = true;
+      name.truncate_at(equals - name.string());
+    }
+    int type = 0;
+    while (type < AT_COUNT && name != kStageNames[type]) ++type;
+    if (type == AT_COUNT) {
+      tprintf("Unknown augmentation stage %s\n", stage_specs[s].string());
+      return false;
+    }
+    if (!has_param) param = kDefaultParams[type];
+    stages.push_back(AugmentationStage(static_cast<AugmentationType>(type),
+                                       probability, param));
+  }
+  stages_ += stages;
+  return true;
+}
+
+// Returns a new 8 bit grey or 32 bit color Pix made by applying the stages
+// in order to a copy of pix, moving the boxes with any spatial distortion.
+// Returns NULL on error. The returned Pix must be pixDestroyed.
+Pix* AugmentationPipeline::Apply(const Pix* pix, TRand* randomizer,
+                                 GenericVector<TBOX>* boxes) const {
+  Pix* result = NULL;
+  int depth = pixGetDepth(const_cast<Pix*>(pix));
+  if (depth == 8 || depth == 32)
+    result = pixCopy(NULL, const_cast<Pix*>(pix));
+  else
+    result = pixConvertTo8(const_cast<Pix*>(pix), false);
+  for (int s = 0; result != NULL && s < stages_.size(); ++s) {
+    const AugmentationStage& stage = stages_[s];
+    if (stage.probability < 1.0f &&
+        randomizer->UnsignedRand(1.0) >= stage.probability)
+      continue;
+    Pix* distorted = NULL;
+    switch (stage.type) {
+      case AT_DEGRADE:
+        // DegradeImage takes ownership of its input. Its rotation would move
+        // the glyphs away from the boxes, so it is not used here.
+        result = DegradeImage(result, IntCastRounded(stage.param), randomizer,
+                              NULL);
+        break;
+      case AT_INVERT:
+        pixInvert(result, result);
+        break;
+      case AT_GAUSSIAN_NOISE:
+        distorted = AddGaussianNoise(result, stage.param, randomizer);
+        break;
+      case AT_SALT_AND_PEPPER:
+        AddSaltAndPepperNoise(result, stage.param, randomizer);
+        break;
+      case AT_BLUR:
+        distorted = pixBlockconv(result, 1, 1);
+        break;
+      case AT_PERSPECTIVE:
+        GeneratePerspectiveDistortion(0, 0, randomizer, &result, boxes);
+        break;
+      case AT_ELASTIC:
+        GenerateElasticDistortion(stage.param, randomizer, &result, boxes);
+        break;
+      case AT_JPEG:
+        distorted = AddJpegArtifacts(result, IntCastRounded(stage.param));
+        if (distorted == NULL)
+          tprintf("JPEG augmentation failed, skipping it\n");
+        break;
+      case AT_COUNT:
+        break;
+    }
+    if (distorted != NULL) {
+      pixDestroy(&result);
+      result = distorted;
+    }
+  }
+  return result;
+}
+
+// Returns the median of the values, which must not be empty.
+static int Median(GenericVector<int>* values) {
+  values->sort();
+  return (*values)[values->size() / 2];
+}
+
+// Estimates the baseline and x-height of the text line of boxes[b] from the
+// boxes that overlap it vertically by at least half of the smaller height.
+static void EstimateLineMetrics(const GenericVector<TBOX>& boxes,
+                                const GenericVector<bool>& usable, int b,
+                                int* baseline, int* x_height) {
+  const TBOX& box = boxes[b];
+  GenericVector<int> bottoms;
+  GenericVector<TBOX> line_boxes;
+  for (int i = 0; i < boxes.size(); ++i) {
+    if (!usable[i]) continue;
+    const TBOX& other = boxes[i];
+    if (other.y_overlap(box) &&
+        other.y_gap(box) <= -MIN(other.height(), box.height()) / 2) {
+      bottoms.push_back(other.bottom());
+      line_boxes.push_back(other);
+    }
+  }
+  *baseline = Median(&bottoms);
+  // Only the boxes that sit on the baseline tell the x-height.
+  int max_height = 0;
+  for (int i = 0; i < line_boxes.size(); ++i) {
+    int tolerance = MAX(1, line_boxes[i].height() / 8);
+    if (abs(line_boxes[i].bottom() - *baseline) <= tolerance)
+      max_height = MAX(max_height, line_boxes[i].top() - *baseline);
+  }
+  GenericVector<int> heights;
+  for (int i = 0; i < line_boxes.size(); ++i) {
+    int tolerance = MAX(1, line_boxes[i].height() / 8);
+    int height = line_boxes[i].top() - *baseline;
+    if (abs(line_boxes[i].bottom() - *baseline) <= tolerance &&
+        height <= max_height * kMaxXHeightFraction)
+      heights.push_back(height);
+  }
+  if (heights.empty())
+    *x_height = IntCastRounded(max_height * kXHeightFraction);
+  else
+    *x_height = Median(&heights);
+  if (*x_height < 1) *x_height = MAX(1, box.height());
+}
+
+// Returns a single blob made of all the outlines of the thresholded image
+// inside the box, or NULL if there are none.
+static TBLOB* BlobFromBox(Pix* binary, const TBOX& box) {
+  BLOCK block("", TRUE, 0, 0, box.left(), box.bottom(), box.right(),
+              box.top());
+  extract_edges(binary, &block);
+  C_OUTLINE_LIST outlines;
+  C_OUTLINE_IT ol_it(&outlines);
+  C_BLOB_IT b_it(block.blob_list());
+  for (b_it.mark_cycle_pt(); !b_it.cycled_list(); b_it.forward())
+    ol_it.add_list_after(b_it.data()->out_list());
+  if (outlines.empty()) return NULL;
+  C_BLOB blob(&outlines);
+  return TBLOB::PolygonalCopy(false, &blob);
+}
+
+// Returns a TrainingSample of the baseline-normalized blob with all the
+// features that Classify::LearnBlob writes to a .tr file, built in the same
+// way as MasterTrainer::ReadTrFile builds it from that file, or NULL if the
+// blob has no valid features.
+static TrainingSample* BlobToLearnedSample(
+    const FEATURE_DEFS_STRUCT& feature_defs, TBLOB* blob) {
+  DENORM bl_denorm, cn_denorm;
+  INT_FX_RESULT_STRUCT fx_info;
+  Classify::SetupBLCNDenorms(*blob, false, &bl_denorm, &cn_denorm, &fx_info);
+  // BlobToTrainingSample gives the int and geo features, but not the
+  // micro-features used by mftraining.
+  INT_FX_RESULT_STRUCT int_fx_info(fx_info);
+  GenericVector<INT_FEATURE_STRUCT> bl_features;
+  TrainingSample* int_sample = BlobToTrainingSample(*blob, false, &int_fx_info,
+                                                    &bl_features);
+  if (int_sample == NULL) return NULL;
+  int int_type = ShortNameToFeatureType(feature_defs, kIntFeatureType);
+  int micro_type = ShortNameToFeatureType(feature_defs, kMicroFeatureType);
+  int cn_type = ShortNameToFeatureType(feature_defs, kCNFeatureType);
+  int geo_type = ShortNameToFeatureType(feature_defs, kGeoFeatureType);
+  CHAR_DESC char_desc = NewCharDescription(feature_defs);
+  FEATURE_SET int_features = NewFeatureSet(int_sample->num_features());
+  for (int f = 0; f < int_sample->num_features(); ++f) {
+    FEATURE feature = NewFeature(&IntFeatDesc);
+    feature->Params[IntX] = int_sample->features()[f].X;
+    feature->Params[IntY] = int_sample->features()[f].Y;
+    feature->Params[IntDir] = int_sample->features()[f].Theta;
+    AddFeature(int_features, feature);
+  }
+  FEATURE_SET geo_features = NewFeatureSet(1);
+  FEATURE geo_feature = NewFeature(&GeoFeatDesc);
+  geo_feature->Params[GeoBottom] = int_sample->geo_feature(GeoBottom);
+  geo_feature->Params[GeoTop] = int_sample->geo_feature(GeoTop);
+  geo_feature->Params[GeoWidth] = int_sample->geo_feature(GeoWidth);
+  AddFeature(geo_features, geo_feature);
+  delete int_sample;
+  char_desc->FeatureSets[int_type] = int_features;
+  char_desc->FeatureSets[micro_type] = ExtractMicros(blob, cn_denorm);
+  char_desc->FeatureSets[cn_type] = ExtractCharNormFeatures(fx_info);
+  char_desc->FeatureSets[geo_type] = geo_features;
+  TrainingSample* sample = NULL;
+  if (ValidCharDescription(feature_defs, char_desc)) {
+    sample = new TrainingSample;
+    sample->ExtractCharDesc(int_type, micro_type, cn_type, geo_type,
+                            char_desc);
+  }
+  FreeCharDescription(char_desc);
+  return sample;
+}
+
+// Extracts a training sample from each of the boxes of a rendered page, and
+// adds them to *samples with the given font name.
+bool ExtractPageSamples(Pix* pix, const GenericVector<TBOX>& boxes,
+                        const GenericVector<STRING>& unichars,
+                        const STRING& font_name, int page_number,
+                        TrFileSamples* samples) {
+  Pix* binary = pixConvertTo1(pix, 128);
+  if (binary == NULL) {
+    tprintf("Failed to threshold page %d for sample extraction\n",
+            page_number);
+    return false;
+  }
+  InitIntegerFX();
+  FEATURE_DEFS_STRUCT feature_defs;
+  InitFeatureDefs(&feature_defs);
+  TBOX page_box(0, 0, pixGetWidth(binary), pixGetHeight(binary));
+  GenericVector<bool> usable;
+  for (int b = 0; b < boxes.size(); ++b) {
+    const char* text = unichars[b].string();
+    usable.push_back(!boxes[b].null_box() && boxes[b].area() > 0 &&
+                     boxes[b].overlap(page_box) &&
+                     text[strspn(text, " \t\n")] != '\0');
+  }
+  for (int b = 0; b < boxes.size(); ++b) {
+    if (!usable[b]) continue;
+    TBLOB* blob = BlobFromBox(binary, boxes[b].intersection(page_box));
+    if (blob == NULL) continue;
+    int baseline, x_height;
+    EstimateLineMetrics(boxes, usable, b, &baseline, &x_height);
+    // Normalize as TWERD::BLNormalize does for a word in a row.
+    TBOX blob_box = blob->bounding_box();
+    float scale = static_cast<float>(kBlnXHeight) / x_height;
+    blob->Normalize(NULL, NULL, NULL,
+                    (blob_box.left() + blob_box.right()) / 2.0f, baseline,
+                    scale, scale, 0.0f, static_cast<float>(kBlnBaselineOffset),
+                    false, NULL);
+    TrainingSample* sample = BlobToLearnedSample(feature_defs, blob);
+    delete blob;
+    if (sample == NULL) continue;
+    sample->set_page_num(page_number);
+    sample->set_bounding_box(boxes[b]);
+    samples->font_names.push_back(font_name);
+    samples->unichars.push_back(unichars[b]);
+    samples->samples.push_back(sample);
+  }
+  pixDestroy(&binary);
+  return true;
+}
+
+}  // namespace tesseract
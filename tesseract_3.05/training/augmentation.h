@@ -0,0 +1,108 @@
+/**********************************************************************
+ * File:        augmentation.h
+ * Description: A configurable pipeline of image distortions for synthetic
+ *              training data, and extraction of training samples from the
+ *              distorted images without writing them to files.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ **********************************************************************/
+#ifndef TESSERACT_TRAINING_AUGMENTATION_H_
+#define TESSERACT_TRAINING_AUGMENTATION_H_
+
+#include "genericvector.h"
+#include "helpers.h"  // For TRand.
+#include "rect.h"
+#include "strngs.h"
+
+struct Pix;
+
+namespace tesseract {
+
+struct TrFileSamples;
+
+// The distortions that an AugmentationPipeline can apply.
+enum AugmentationType {
+  AT_DEGRADE,          // DegradeImage, param is the exposure.
+  AT_INVERT,           // White on black.
+  AT_GAUSSIAN_NOISE,   // Param is the standard deviation in grey levels.
+  AT_SALT_AND_PEPPER,  // Param is the fraction of pixels changed.
+  AT_BLUR,             // A 3x3 box filter.
+  AT_PERSPECTIVE,      // GeneratePerspectiveDistortion.
+  AT_ELASTIC,          // Param is the max displacement in pixels.
+  AT_JPEG,             // Param is the JPEG quality.
+
+  AT_COUNT
+};
+
+// One step of an AugmentationPipeline, applied to a page with the given
+// probability.
+struct AugmentationStage {
+  AugmentationStage() : type(AT_DEGRADE), probability(1.0f), param(0.0f) {}
+  AugmentationStage(AugmentationType t, float prob, float p)
+    : type(t), probability(prob), param(p) {}
+
+  AugmentationType type;
+  float probability;
+  float param;
+};
+
+// An ordered list of distortions to apply to rendered training pages.
+// All the randomness comes from the TRand given to Apply, so a pipeline
+// gives the same result for the same seed, and threads that each have their
+// own TRand do not affect each other.
+class AugmentationPipeline {
+ public:
+  AugmentationPipeline() {}
+
+  bool empty() const { return stages_.empty(); }
+  const GenericVector<AugmentationStage>& stages() const { return stages_; }
+
+  // Adds a stage to the end of the pipeline.
+  void AddStage(AugmentationType type, float probability, float param) {
+    stages_.push_back(AugmentationStage(type, probability, param));
+  }
+  // Adds the stages of a comma-separated spec of the form
+  // name[=param][@probability],... where the names are degrade, invert,
+  // noise, saltpepper, blur, perspective, elastic and jpeg. Stages without a
+  // param get a sensible default, and without a probability are always
+  // applied. Eg "degrade=1,elastic=3@0.5,jpeg=40@0.3".
+  // Returns false, and leaves the pipeline unchanged, on a bad spec.
+  bool ParseSpec(const char* spec);
+
+  // Returns a new 8 bit grey or 32 bit color Pix made by applying the stages
+  // in order to a copy of pix. If boxes is not NULL, the boxes (in tesseract
+  // coordinates) are moved with any spatial distortion. Returns NULL on
+  // error. The returned Pix must be pixDestroyed.
+  Pix* Apply(const Pix* pix, TRand* randomizer,
+             GenericVector<TBOX>* boxes) const;
+
+ private:
+  GenericVector<AugmentationStage> stages_;
+};
+
+// Extracts a training sample from each of the boxes of a rendered page, as
+// tesseract's box.train would after reading the page and its box file, and
+// adds them to *samples with the given font name, for
+// MasterTrainer::AddTrFileSamples or MasterTrainer::WriteBinaryTrFile.
+// The boxes are in tesseract coordinates, and unichars gives the text of
+// each box. Boxes that are empty or hold only whitespace are skipped. As
+// there is no layout analysis, the baseline and x-height of each glyph are
+// estimated from the boxes of its text line. Returns false if the pix could
+// not be thresholded.
+bool ExtractPageSamples(Pix* pix, const GenericVector<TBOX>& boxes,
+                        const GenericVector<STRING>& unichars,
+                        const STRING& font_name, int page_number,
+                        TrFileSamples* samples);
+
+}  // namespace tesseract
+
+#endif  // TESSERACT_TRAINING_AUGMENTATION_H_
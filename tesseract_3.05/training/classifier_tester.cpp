@@ -17,6 +17,7 @@
 //  Author:   Ray Smith
 
 #include <stdio.h>
+#include <chrono>
 #ifndef USE_STD_NAMESPACE
 #include "base/commandlineflags.h"
 #endif  // USE_STD_NAMESPACE
@@ -28,12 +29,19 @@
 #include "mastertrainer.h"
 #include "params.h"
 #include "strngs.h"
+#include "svutil.h"
 #include "tessclassifier.h"
+#include "trainingsampleset.h"
 
 STRING_PARAM_FLAG(classifier, "", "Classifier to test");
 STRING_PARAM_FLAG(lang, "eng", "Language to test");
 STRING_PARAM_FLAG(tessdata_dir, "", "Directory of traineddata files");
+STRING_PARAM_FLAG(benchmark_json, "",
+                  "File to write the classifier throughput to, as JSON");
+INT_PARAM_FLAG(benchmark_iterations, 1,
+               "Number of passes over the samples for each benchmark stage");
 DECLARE_INT_PARAM_FLAG(debug_level);
+DECLARE_INT_PARAM_FLAG(threads);
 DECLARE_STRING_PARAM_FLAG(T);
 
 enum ClassifierName {
@@ -125,6 +133,129 @@ static tesseract::ShapeClassifier* InitializeClassifier(
   return shape_classifier;
 }
 
+// Names of the TrainingSampleStages in the benchmark output.
+const char* kStageNames[] = {"char_norm", "class_pruner", "int_matcher",
+                             "shape_lookup"};
+// Number of samples that a benchmark thread claims at a time.
+const int kBenchmarkBatchSize = 64;
+
+// Samples run through the classifier stages in parallel by the benchmark.
+struct BenchmarkTasks {
+  tesseract::Classify* classify;
+  const tesseract::TrainingSampleSet* samples;
+  tesseract::TrainingSampleStage last_stage;
+};
+
+// Runs the samples of batch index up to tasks->last_stage.
+static void RunBenchmarkBatch(void* arg, int index) {
+  BenchmarkTasks* tasks = static_cast<BenchmarkTasks*>(arg);
+  int num_samples = tasks->samples->num_samples();
+  int start = index * kBenchmarkBatchSize;
+  int end = MIN(start + kBenchmarkBatchSize, num_samples);
+  for (int s = start; s < end; ++s) {
+    tasks->classify->TrainingSampleStages(*tasks->samples->GetSample(s),
+                                          tasks->last_stage);
+  }
+}
+
+// Returns the seconds since start.
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+// Returns str as a quoted JSON string.
+static STRING JsonString(const char* str) {
+  STRING result = "\"";
+  for (const char* p = str; *p != '\0'; ++p) {
+    unsigned char ch = *p;
+    if (ch == '"' || ch == '\\') {
+      result += '\\';
+      result += *p;
+    } else if (ch < 0x20) {
+      char escape[8];
+      snprintf(escape, sizeof(escape), "\\u%04x", ch);
+      result += escape;
+    } else {
+      result += *p;
+    }
+  }
+  result += '"';
+  return result;
+}
+
+// Measures the throughput of each classifier stage over all the samples on
+// FLAGS_threads threads and writes it with the accuracy_seconds and
+// error_rate of the accuracy test to FLAGS_benchmark_json. Each stage is
+// timed by running all the stages up to it, and its cost is the difference
+// from the time up to the previous stage. Returns false on error.
+static bool RunBenchmark(tesseract::Classify* classify,
+                         const tesseract::TrainingSampleSet* samples,
+                         double accuracy_seconds, double error_rate) {
+  int num_samples = samples->num_samples();
+  if (num_samples == 0) {
+    tprintf("No samples to benchmark!\n");
+    return false;
+  }
+  int iterations = MAX(FLAGS_benchmark_iterations, 1);
+  int num_batches =
+      (num_samples + kBenchmarkBatchSize - 1) / kBenchmarkBatchSize;
+  double total_samples = static_cast<double>(num_samples) * iterations;
+  BenchmarkTasks tasks;
+  tasks.classify = classify;
+  tasks.samples = samples;
+  double cumulative_seconds[tesseract::TSS_COUNT];
+  for (int stage = 0; stage < tesseract::TSS_COUNT; ++stage) {
+    tasks.last_stage = static_cast<tesseract::TrainingSampleStage>(stage);
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      SVSync::ParallelFor(num_batches, FLAGS_threads, RunBenchmarkBatch,
+                          &tasks);
+    }
+    cumulative_seconds[stage] = SecondsSince(start);
+  }
+  FILE* fp = fopen(FLAGS_benchmark_json.c_str(), "w");
+  if (fp == NULL) {
+    tprintf("Can't open %s for writing\n", FLAGS_benchmark_json.c_str());
+    return false;
+  }
+  fprintf(fp, "{\n  \"classifier\": %s,\n  \"lang\": %s,\n",
+          JsonString(FLAGS_classifier.c_str()).string(),
+          JsonString(FLAGS_lang.c_str()).string());
+  fprintf(fp, "  \"threads\": %d,\n  \"samples\": %d,\n"
+          "  \"iterations\": %d,\n", static_cast<int>(FLAGS_threads),
+          num_samples, iterations);
+  fprintf(fp, "  \"accuracy\": {\"unichar_error_rate\": %g, \"seconds\": %g,"
+          " \"samples_per_second\": %g},\n", error_rate, accuracy_seconds,
+          accuracy_seconds > 0.0 ? num_samples / accuracy_seconds : 0.0);
+  fprintf(fp, "  \"stages\": [\n");
+  tprintf("Benchmark of %d samples x %d on %d threads:\n", num_samples,
+          iterations, static_cast<int>(FLAGS_threads));
+  for (int stage = 0; stage < tesseract::TSS_COUNT; ++stage) {
+    double seconds = cumulative_seconds[stage];
+    if (stage > 0) seconds -= cumulative_seconds[stage - 1];
+    if (seconds < 0.0) seconds = 0.0;
+    double rate = seconds > 0.0 ? total_samples / seconds : 0.0;
+    fprintf(fp, "    {\"name\": %s, \"seconds\": %g,"
+            " \"samples_per_second\": %g}%s\n",
+            JsonString(kStageNames[stage]).string(), seconds, rate,
+            stage + 1 < tesseract::TSS_COUNT ? "," : "");
+    tprintf("  %-13s %8.3fs %12.0f samples/s\n", kStageNames[stage], seconds,
+            rate);
+  }
+  double total_seconds = cumulative_seconds[tesseract::TSS_COUNT - 1];
+  double total_rate = total_seconds > 0.0 ? total_samples / total_seconds : 0.0;
+  fprintf(fp, "  ],\n  \"total\": {\"seconds\": %g,"
+          " \"samples_per_second\": %g}\n}\n", total_seconds, total_rate);
+  tprintf("  %-13s %8.3fs %12.0f samples/s\n", "total", total_seconds,
+          total_rate);
+  bool ok = ferror(fp) == 0;
+  if (fclose(fp) != 0) ok = false;
+  if (!ok) tprintf("Error writing %s\n", FLAGS_benchmark_json.c_str());
+  return ok;
+}
+
 // This program has complex setup requirements, so here is some help:
 // Two different modes, tr files and serialized mastertrainer.
 // From tr files:
@@ -146,6 +277,12 @@ static tesseract::ShapeClassifier* InitializeClassifier(
 // cube     : Cube classifier. (Not possible with an input trainer.)
 // cubetess : Tesseract class pruner with rescoring by Cube.  (Not possible
 //            with an input trainer.)
+//
+// With -benchmark_json file, the throughput of each stage of the Tesseract
+// static classifier (char_norm, class_pruner, int_matcher and shape_lookup)
+// is also measured on -threads threads, repeating each stage
+// -benchmark_iterations times, and written to the file as JSON, with the
+// error rate and time of the accuracy test of the chosen classifier.
 int main(int argc, char **argv) {
   ParseArguments(&argc, &argv);
   STRING file_prefix;
@@ -165,14 +302,25 @@ int main(int argc, char **argv) {
   // We want to test with replicated samples too.
   trainer->ReplicateAndRandomizeSamplesIfRequired();
 
-  trainer->TestClassifierOnSamples(tesseract:: CT_UNICHAR_TOP1_ERR,
-                                   MAX(3, FLAGS_debug_level), false,
-                                   shape_classifier, NULL);
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  double error_rate = trainer->TestClassifierOnSamples(
+      tesseract::CT_UNICHAR_TOP1_ERR, MAX(3, FLAGS_debug_level), false,
+      shape_classifier, NULL);
+  double accuracy_seconds = SecondsSince(start);
+  int exit_code = 0;
+  if (!FLAGS_benchmark_json.empty()) {
+    tesseract::Classify* classify = reinterpret_cast<tesseract::Classify*>(
+        const_cast<tesseract::Tesseract*>(api->tesseract()));
+    if (!RunBenchmark(classify, trainer->GetSamples(), accuracy_seconds,
+                      error_rate))
+      exit_code = 1;
+  }
   delete shape_classifier;
   delete api;
   delete trainer;
 
-  return 0;
+  return exit_code;
 } /* main */
 
 
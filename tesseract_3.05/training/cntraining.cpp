@@ -36,10 +36,13 @@
 #include <math.h>
 #include "unichar.h"
 #include "commontraining.h"
+#include "genericvector.h"
+#include "svutil.h"
 
 #define PROGRAM_FEATURE_TYPE "cn"
 
 DECLARE_STRING_PARAM_FLAG(D);
+DECLARE_INT_PARAM_FLAG(threads);
 
 /*----------------------------------------------------------------------------
           Public Function Prototypes
@@ -55,6 +58,18 @@ int main (
 void WriteNormProtos(const char *Directory, LIST LabeledProtoList,
                      const FEATURE_DESC_STRUCT *feature_desc);
 
+// The classes to be clustered by ClusterOneClass and their results.
+struct CNClusteringTasks {
+  const FEATURE_DEFS_STRUCT* feature_defs;
+  GenericVector<LABELEDLIST> char_samples;
+  GenericVector<LIST> proto_lists;
+  // Set for the classes that could not be set up for clustering. Each task
+  // writes only its own entry, so no lock is needed.
+  GenericVector<bool> failed;
+};
+
+void ClusterOneClass(void* arg, int index);
+
 /*
 PARAMDESC *ConvertToPARAMDESC(
   PARAM_DESC* Param_Desc,
@@ -137,7 +152,6 @@ int main(int argc, char *argv[]) {
   const char  *PageName;
   FILE  *TrainingPage;
   LIST  CharList = NIL_LIST;
-  CLUSTERER  *Clusterer = NULL;
   LIST    ProtoList = NIL_LIST;
   LIST    NormProtoList = NIL_LIST;
   LIST pCharList;
@@ -159,39 +173,32 @@ int main(int argc, char *argv[]) {
   // To allow an individual font to form a separate cluster,
   // reduce the min samples:
   // Config.MinSamples = 0.5 / num_fonts;
+  // The classes are clustered in parallel, and then added to the
+  // NormProtoList in the original order.
+  CNClusteringTasks tasks;
+  tasks.feature_defs = &FeatureDefs;
   pCharList = CharList;
-  // The norm protos will count the source protos, so we keep them here in
-  // freeable_protos, so they can be freed later.
-  GenericVector<LIST> freeable_protos;
   iterate(pCharList) {
-    //Cluster
-    CharSample = (LABELEDLIST)first_node(pCharList);
-    Clusterer =
-      SetUpForClustering(FeatureDefs, CharSample, PROGRAM_FEATURE_TYPE);
-    if (Clusterer == NULL) {  // To avoid a SIGSEGV
+    tasks.char_samples.push_back((LABELEDLIST)first_node(pCharList));
+  }
+  tasks.proto_lists.init_to_size(tasks.char_samples.size(), NIL_LIST);
+  tasks.failed.init_to_size(tasks.char_samples.size(), false);
+  SVSync::ParallelFor(tasks.char_samples.size(), FLAGS_threads,
+                      ClusterOneClass, &tasks);
+  for (int i = 0; i < tasks.failed.size(); ++i) {
+    if (tasks.failed[i]) {  // To avoid a SIGSEGV
       fprintf(stderr, "Error: NULL clusterer!\n");
       return 1;
     }
-    float SavedMinSamples = Config.MinSamples;
-    // To disable the tendency to produce a single cluster for all fonts,
-    // make MagicSamples an impossible to achieve number:
-    // Config.MagicSamples = CharSample->SampleCount * 10;
-    Config.MagicSamples = CharSample->SampleCount;
-    while (Config.MinSamples > 0.001) {
-      ProtoList = ClusterSamples(Clusterer, &Config);
-      if (NumberOfProtos(ProtoList, 1, 0) > 0) {
-        break;
-      } else {
-        Config.MinSamples *= 0.95;
-        printf("0 significant protos for %s."
-               " Retrying clustering with MinSamples = %f%%\n",
-               CharSample->Label, Config.MinSamples);
-      }
-    }
-    Config.MinSamples = SavedMinSamples;
+  }
+  // The norm protos will count the source protos, so we keep them here in
+  // freeable_protos, so they can be freed later.
+  GenericVector<LIST> freeable_protos;
+  for (int i = 0; i < tasks.char_samples.size(); ++i) {
+    CharSample = tasks.char_samples[i];
+    ProtoList = tasks.proto_lists[i];
     AddToNormProtosList(&NormProtoList, ProtoList, CharSample->Label);
     freeable_protos.push_back(ProtoList);
-    FreeClusterer(Clusterer);
   }
   FreeTrainingSamples(CharList);
   int desc_index = ShortNameToFeatureType(FeatureDefs, PROGRAM_FEATURE_TYPE);
@@ -209,6 +216,45 @@ int main(int argc, char *argv[]) {
               Private Code
 ----------------------------------------------------------------------------*/
 
+/*----------------------------------------------------------------------------*/
+/**
+* Clusters the samples of the class tasks->char_samples[index] and stores the
+* resulting protos in tasks->proto_lists[index]. Each call uses its own copy
+* of the global Config, so the classes can be clustered in parallel.
+* @param arg  CNClusteringTasks to work on
+* @param index  index of the class to cluster
+* @return none
+*/
+void ClusterOneClass(void* arg, int index) {
+  CNClusteringTasks* tasks = static_cast<CNClusteringTasks*>(arg);
+  LABELEDLIST CharSample = tasks->char_samples[index];
+  CLUSTERER* Clusterer =
+    SetUpForClustering(*tasks->feature_defs, CharSample, PROGRAM_FEATURE_TYPE);
+  if (Clusterer == NULL) {
+    tasks->failed[index] = true;
+    return;
+  }
+  CLUSTERCONFIG ClassConfig = Config;
+  // To disable the tendency to produce a single cluster for all fonts,
+  // make MagicSamples an impossible to achieve number:
+  // ClassConfig.MagicSamples = CharSample->SampleCount * 10;
+  ClassConfig.MagicSamples = CharSample->SampleCount;
+  LIST ProtoList = NIL_LIST;
+  while (ClassConfig.MinSamples > 0.001) {
+    ProtoList = ClusterSamples(Clusterer, &ClassConfig);
+    if (NumberOfProtos(ProtoList, 1, 0) > 0) {
+      break;
+    } else {
+      ClassConfig.MinSamples *= 0.95;
+      printf("0 significant protos for %s."
+             " Retrying clustering with MinSamples = %f%%\n",
+             CharSample->Label, ClassConfig.MinSamples);
+    }
+  }
+  tasks->proto_lists[index] = ProtoList;
+  FreeClusterer(Clusterer);
+}  // ClusterOneClass
+
 /*----------------------------------------------------------------------------*/
 /**
 * This routine writes the specified samples into files which
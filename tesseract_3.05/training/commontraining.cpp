@@ -31,6 +31,7 @@
 #include "oldlist.h"
 #include "params.h"
 #include "shapetable.h"
+#include "svutil.h"
 #include "tessdatamanager.h"
 #include "tessopt.h"
 #include "tprintf.h"
@@ -62,6 +63,7 @@ STRING_PARAM_FLAG(O, "", "File to write unicharset to");
 STRING_PARAM_FLAG(T, "", "File to load trainer from");
 STRING_PARAM_FLAG(output_trainer, "", "File to write trainer to");
 STRING_PARAM_FLAG(test_ch, "", "UTF8 test character string");
+INT_PARAM_FLAG(threads, 1, "Number of threads to cluster with");
 DOUBLE_PARAM_FLAG(clusterconfig_min_samples_fraction, Config.MinSamples,
                   "Min number of samples per proto as % of total");
 DOUBLE_PARAM_FLAG(clusterconfig_max_illegal, Config.MaxIllegal,
@@ -156,6 +158,24 @@ void WriteShapeTable(const STRING& file_prefix, const ShapeTable& shape_table) {
   }
 }
 
+// The .tr files read in parallel by LoadTrainingData.
+struct TrFileTasks {
+  TrFileTasks() : feature_defs(NULL) {}
+
+  const FEATURE_DEFS_STRUCT* feature_defs;
+  GenericVector<STRING> page_names;
+  PointerVector<TrFileSamples> samples;
+  GenericVector<bool> results;
+};
+
+// Reads tasks->page_names[index] into tasks->samples[index].
+static void ReadOneTrFile(void* arg, int index) {
+  TrFileTasks* tasks = static_cast<TrFileTasks*>(arg);
+  tasks->results[index] = MasterTrainer::ReadTrFile(
+      tasks->page_names[index].string(), *tasks->feature_defs,
+      tasks->samples[index]);
+}
+
 /**
  * Creates a MasterTraininer and loads the training data into it:
  * Initializes feature_defs and IntegerFX.
@@ -198,6 +218,7 @@ MasterTrainer* LoadTrainingData(int argc, const char* const * argv,
                                              shape_analysis,
                                              replication,
                                              FLAGS_debug_level);
+  trainer->set_num_threads(FLAGS_threads);
   IntFeatureSpace fs;
   fs.Init(kBoostXYBuckets, kBoostXYBuckets, kBoostDirBuckets);
   if (FLAGS_T.empty()) {
@@ -216,27 +237,38 @@ MasterTrainer* LoadTrainingData(int argc, const char* const * argv,
       }
     }
     trainer->SetFeatureSpace(fs);
+    // Load training data from .tr/.trb files on the command line. The files
+    // are parsed in parallel, and then added to the trainer in order.
+    TrFileTasks tasks;
+    tasks.feature_defs = &feature_defs;
     const char* page_name;
-    // Load training data from .tr files on the command line.
     while ((page_name = GetNextFilename(argc, argv)) != NULL) {
+      tasks.page_names.push_back(STRING(page_name));
+      tasks.samples.push_back(new TrFileSamples);
+    }
+    tasks.results.init_to_size(tasks.page_names.size(), false);
+    SVSync::ParallelFor(tasks.page_names.size(), FLAGS_threads,
+                        ReadOneTrFile, &tasks);
+    for (int i = 0; i < tasks.page_names.size(); ++i) {
+      page_name = tasks.page_names[i].string();
       tprintf("Reading %s ...\n", page_name);
-      trainer->ReadTrainingSamples(page_name, feature_defs, false);
+      if (tasks.results[i])
+        trainer->AddTrFileSamples(page_name, false, tasks.samples[i]);
 
       // If there is a file with [lang].[fontname].exp[num].fontinfo present,
       // read font spacing information in to fontinfo_table.
-      int pagename_len = strlen(page_name);
-      char *fontinfo_file_name = new char[pagename_len + 7];
-      strncpy(fontinfo_file_name, page_name, pagename_len - 2);  // remove "tr"
-      strcpy(fontinfo_file_name + pagename_len - 2, "fontinfo");  // +"fontinfo"
-      trainer->AddSpacingInfo(fontinfo_file_name);
-      delete[] fontinfo_file_name;
+      // Chop off the tr or trb after the last dot.
+      STRING base_name = page_name;
+      const char* extension = strrchr(page_name, '.');
+      if (extension != NULL)
+        base_name.truncate_at(extension + 1 - page_name);
+      STRING fontinfo_file_name = base_name + "fontinfo";
+      trainer->AddSpacingInfo(fontinfo_file_name.string());
 
       // Load the images into memory if required by the classifier.
       if (FLAGS_load_images) {
-        STRING image_name = page_name;
-        // Chop off the tr and replace with tif. Extension must be tif!
-        image_name.truncate_at(image_name.length() - 2);
-        image_name += "tif";
+        // Replace the extension with tif. Extension must be tif!
+        STRING image_name = base_name + "tif";
         trainer->LoadPageImages(image_name.string());
       }
     }
@@ -325,7 +357,7 @@ const char *GetNextFilename(int argc, const char* const * argv) {
  * @note Exceptions: none
  * @note History: Fri Aug 18 15:57:41 1989, DSJ, Created.
  */
-LABELEDLIST FindList(LIST List, char* Label) {
+LABELEDLIST FindList(LIST List, const char* Label) {
   LABELEDLIST LabeledList;
 
   iterate (List)
@@ -361,6 +393,56 @@ LABELEDLIST NewLabeledList(const char* Label) {
 
 } /* NewLabeledList */
 
+/*---------------------------------------------------------------------------*/
+// Returns a new feature set holding the features of the given type of the
+// given sample, or NULL if that type is not kept in a TrainingSample.
+static FEATURE_SET SampleFeatureSet(const FEATURE_DEFS_STRUCT& feature_defs,
+                                    const char* feature_name,
+                                    const tesseract::TrainingSample& sample) {
+  FEATURE_SET feature_set = NULL;
+  if (strcmp(feature_name, kCNFeatureType) == 0) {
+    feature_set = NewFeatureSet(1);
+    AddFeature(feature_set, sample.GetCNFeature());
+  } else if (strcmp(feature_name, kMicroFeatureType) == 0) {
+    feature_set = NewFeatureSet(sample.num_micro_features());
+    for (int f = 0; f < sample.num_micro_features(); ++f) {
+      FEATURE feature = NewFeature(&MicroFeatureDesc);
+      for (int p = 0; p < MFCount; ++p)
+        feature->Params[p] = sample.micro_features()[f][p];
+      AddFeature(feature_set, feature);
+    }
+  }
+  return feature_set;
+}
+
+/*---------------------------------------------------------------------------*/
+// Adds the feature_samples of the given unichar to training_samples, as
+// ReadTrainingSamples does.
+static void AddLabeledSample(const char* unichar, FEATURE_SET feature_samples,
+                             int max_samples, UNICHARSET* unicharset,
+                             LIST* training_samples) {
+  if (unicharset != NULL && !unicharset->contains_unichar(unichar)) {
+    unicharset->unichar_insert(unichar);
+    if (unicharset->size() > MAX_NUM_CLASSES) {
+      tprintf("Error: Size of unicharset in training is "
+              "greater than MAX_NUM_CLASSES\n");
+      exit(1);
+    }
+  }
+  LABELEDLIST char_sample = FindList(*training_samples, unichar);
+  if (char_sample == NULL) {
+    char_sample = NewLabeledList(unichar);
+    *training_samples = push(*training_samples, char_sample);
+  }
+  if (char_sample->font_sample_count < max_samples || max_samples <= 0) {
+    char_sample->List = push(char_sample->List, feature_samples);
+    char_sample->SampleCount++;
+    char_sample->font_sample_count++;
+  } else {
+    FreeFeatureSet(feature_samples);
+  }
+}
+
 /*---------------------------------------------------------------------------*/
 // TODO(rays) This is now used only by cntraining. Convert cntraining to use
 // the new method or get rid of it entirely.
@@ -401,33 +483,35 @@ void ReadTrainingSamples(const FEATURE_DEFS_STRUCT& feature_defs,
     char_sample->font_sample_count = 0;
   }
 
+  if (tesseract::MasterTrainer::IsBinaryTrFile(file)) {
+    tesseract::TrFileSamples samples;
+    if (!tesseract::MasterTrainer::ReadTrFile(file, feature_defs, &samples)) {
+      tprintf("Error: Failed to read binary training samples\n");
+      exit(1);
+    }
+    for (int s = 0; s < samples.samples.size(); ++s) {
+      feature_samples = SampleFeatureSet(feature_defs, feature_name,
+                                         *samples.samples[s]);
+      if (feature_samples == NULL) {
+        tprintf("Error: Binary training samples have no %s features\n",
+                feature_name);
+        exit(1);
+      }
+      AddLabeledSample(samples.unichars[s].string(), feature_samples,
+                       max_samples, unicharset, training_samples);
+    }
+    return;
+  }
+
   while (fgets(buffer, 2048, file) != NULL) {
     if (buffer[0] == '\n')
       continue;
 
     sscanf(buffer, "%*s %s", unichar);
-    if (unicharset != NULL && !unicharset->contains_unichar(unichar)) {
-      unicharset->unichar_insert(unichar);
-      if (unicharset->size() > MAX_NUM_CLASSES) {
-        tprintf("Error: Size of unicharset in training is "
-                "greater than MAX_NUM_CLASSES\n");
-        exit(1);
-      }
-    }
-    char_sample = FindList(*training_samples, unichar);
-    if (char_sample == NULL) {
-      char_sample = NewLabeledList(unichar);
-      *training_samples = push(*training_samples, char_sample);
-    }
     char_desc = ReadCharDescription(feature_defs, file);
     feature_samples = char_desc->FeatureSets[feature_type];
-    if (char_sample->font_sample_count < max_samples || max_samples <= 0) {
-      char_sample->List = push(char_sample->List, feature_samples);
-      char_sample->SampleCount++;
-      char_sample->font_sample_count++;
-    } else {
-      FreeFeatureSet(feature_samples);
-    }
+    AddLabeledSample(unichar, feature_samples, max_samples, unicharset,
+                     training_samples);
     for (i = 0; i < char_desc->NumFeatureSets; i++) {
       if (feature_type != i)
         FreeFeatureSet(char_desc->FeatureSets[i]);
@@ -91,7 +91,7 @@ const char *GetNextFilename(int argc, const char* const * argv);
 
 LABELEDLIST FindList(
     LIST        List,
-    char        *Label);
+    const char  *Label);
 
 LABELEDLIST NewLabeledList(
     const char  *Label);
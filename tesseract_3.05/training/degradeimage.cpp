@@ -20,11 +20,18 @@
 
 #include "degradeimage.h"
 
+#include <math.h>
 #include <stdlib.h>
 #include "allheaders.h"   // from leptonica
 #include "genericvector.h"
 #include "helpers.h"  // For TRand.
+#include "points.h"
 #include "rect.h"
+#include "tprintf.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
 
 namespace tesseract {
 
@@ -60,6 +67,8 @@ const int kExposureFactor = 16;
 const int kSaltnPepper = 5;
 // Min sum of width + height on which to operate the ramp.
 const int kMinRampSize = 1000;
+// Size in pixels of the cells of the grid of random elastic displacements.
+const int kElasticCellSize = 64;
 
 // Degrade the pix as if by a print/copy/scan cycle with exposure > 0
 // corresponding to darkening on the copier and <0 lighter and 0 not copied.
@@ -100,7 +109,7 @@ Pix* DegradeImage(Pix* input, int exposure, TRand* randomizer,
     // This is backwards to binary morphology,
     // see http://www.leptonica.com/grayscale-morphology.html
     pix = input;
-    input = pixErodeGray(pix, 3, 3);
+    input = pixErodeGray3(pix, 3, 3);
     pixDestroy(&pix);
   }
   // A convolution is essential to any mode as no scanner produces an
@@ -132,7 +141,7 @@ Pix* DegradeImage(Pix* input, int exposure, TRand* randomizer,
     // This is backwards to binary morphology,
     // see http://www.leptonica.com/grayscale-morphology.html
     pix = input;
-    input = pixErodeGray(pix, 3, 3);
+    input = pixErodeGray3(pix, 3, 3);
     pixDestroy(&pix);
   }
   // The convolution really needed to be 2x2 to be realistic enough, but
@@ -150,26 +159,207 @@ Pix* DegradeImage(Pix* input, int exposure, TRand* randomizer,
   // Add a gradual fade over the page and a small amount of salt and pepper
   // noise to simulate noise in the sensor/paper fibres and varying
   // illumination.
+  // The fade depends only on 2x + y, so it is tabulated together with the
+  // offset to keep the division out of the loop over the pixels.
+  GenericVector<int> offsets;
+  offsets.init_to_size(2 * width + height, erosion_offset);
+  if (height + width > kMinRampSize) {
+    for (int i = 0; i < offsets.size(); ++i)
+      offsets[i] -= i * 32 / (height + width);
+  }
   l_uint32* data = pixGetData(input);
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      int pixel = GET_DATA_BYTE(data, x);
-      if (randomizer != NULL)
-        pixel += randomizer->IntRand() % (kSaltnPepper*2 + 1) - kSaltnPepper;
-      if (height + width > kMinRampSize)
-        pixel -= (2*x + y) * 32 / (height + width);
-      pixel += erosion_offset;
-      if (pixel < 0)
-        pixel = 0;
-      if (pixel > 255)
-        pixel = 255;
-      SET_DATA_BYTE(data, x, pixel);
+  int wpl = pixGetWpl(input);
+  for (int y = 0; y < height; ++y, data += wpl) {
+    const int* row_offsets = &offsets[y];
+    if (randomizer != NULL) {
+      for (int x = 0; x < width; ++x) {
+        int pixel = GET_DATA_BYTE(data, x) + row_offsets[2 * x] +
+            randomizer->IntRand() % (kSaltnPepper*2 + 1) - kSaltnPepper;
+        SET_DATA_BYTE(data, x, ClipToRange(pixel, 0, 255));
+      }
+    } else {
+      for (int x = 0; x < width; ++x) {
+        int pixel = GET_DATA_BYTE(data, x) + row_offsets[2 * x];
+        SET_DATA_BYTE(data, x, ClipToRange(pixel, 0, 255));
+      }
     }
-    data += input->wpl;
   }
   return input;
 }
 
+// Returns a copy of the 8 bit grey or 32 bit color pix with gaussian noise
+// of the given standard deviation added to each sample. Unlike
+// pixAddGaussianNoise, which uses rand(), the noise is drawn from the given
+// randomizer, so it is reproducible and independent of other threads.
+// Returns NULL if the pix has any other depth.
+Pix* AddGaussianNoise(Pix* pix, double stddev, TRand* randomizer) {
+  int depth = pixGetDepth(pix);
+  if (depth != 8 && depth != 32) return NULL;
+  Pix* noisy = pixCopy(NULL, pix);
+  int width = pixGetWidth(noisy);
+  int height = pixGetHeight(noisy);
+  int wpl = pixGetWpl(noisy);
+  l_uint32* data = pixGetData(noisy);
+  // Samples are drawn in pairs by the Box-Muller transform.
+  double spare_noise = 0.0;
+  bool have_spare = false;
+  int samples_per_pixel = depth == 8 ? 1 : 3;
+  for (int y = 0; y < height; ++y, data += wpl) {
+    for (int x = 0; x < width; ++x) {
+      for (int c = 0; c < samples_per_pixel; ++c) {
+        double noise;
+        if (have_spare) {
+          noise = spare_noise;
+        } else {
+          double radius = sqrt(-2.0 * log((randomizer->IntRand() + 1.0) /
+                                          (MAX_INT32 + 1.0)));
+          double angle = randomizer->UnsignedRand(2.0 * M_PI);
+          noise = radius * cos(angle) * stddev;
+          spare_noise = radius * sin(angle) * stddev;
+        }
+        have_spare = !have_spare;
+        // The color samples are COLOR_RED, COLOR_GREEN and COLOR_BLUE.
+        int index = depth == 8 ? x : x * 4 + c;
+        int value = IntCastRounded(GET_DATA_BYTE(data, index) + noise);
+        SET_DATA_BYTE(data, index, ClipToRange(value, 0, 255));
+      }
+    }
+  }
+  return noisy;
+}
+
+// Sets the given fraction of the pixels of the 8 bit grey or 32 bit color pix
+// at random to black or white, as dust and drop-outs do on a scan.
+void AddSaltAndPepperNoise(Pix* pix, double fraction, TRand* randomizer) {
+  int depth = pixGetDepth(pix);
+  if (depth != 8 && depth != 32) return;
+  int width = pixGetWidth(pix);
+  int height = pixGetHeight(pix);
+  int num_pixels = IntCastRounded(fraction * width * height);
+  for (int i = 0; i < num_pixels; ++i) {
+    int x = randomizer->IntRand() % width;
+    int y = randomizer->IntRand() % height;
+    bool black = randomizer->SignedRand(1.0) < 0.0;
+    if (depth == 8)
+      pixSetPixel(pix, x, y, black ? 0 : 255);
+    else
+      pixSetPixel(pix, x, y, black ? 0 : 0xffffff00);
+  }
+}
+
+// Returns a copy of the 8 bit grey or 32 bit color pix after a round trip
+// through JPEG at the given quality, to add its block and ringing artifacts.
+// Returns NULL on error.
+Pix* AddJpegArtifacts(Pix* pix, int quality) {
+  l_uint8* data = NULL;
+  size_t size = 0;
+  if (pixWriteMemJpeg(&data, &size, pix, ClipToRange(quality, 1, 100), 0) != 0)
+    return NULL;
+  Pix* result = pixReadMem(data, size);
+  lept_free(data);
+  return result;
+}
+
+// Returns the displacement at (x, y) of the elastic distortion, whose random
+// displacements are given on a grid of cells of cell_size pixels, with
+// grid_width points in each row, by bilinear interpolation.
+static FCOORD ElasticDisplacement(const GenericVector<FCOORD>& grid,
+                                  int grid_width, int cell_size,
+                                  float x, float y) {
+  int grid_height = grid.size() / grid_width;
+  float gx = ClipToRange(x / cell_size, 0.0f, grid_width - 1.0f);
+  float gy = ClipToRange(y / cell_size, 0.0f, grid_height - 1.0f);
+  int x0 = MIN(static_cast<int>(gx), grid_width - 2);
+  int y0 = MIN(static_cast<int>(gy), grid_height - 2);
+  float fx = gx - x0;
+  float fy = gy - y0;
+  const FCOORD& d00 = grid[y0 * grid_width + x0];
+  const FCOORD& d10 = grid[y0 * grid_width + x0 + 1];
+  const FCOORD& d01 = grid[(y0 + 1) * grid_width + x0];
+  const FCOORD& d11 = grid[(y0 + 1) * grid_width + x0 + 1];
+  return (d00 * (1.0f - fx) + d10 * fx) * (1.0f - fy) +
+         (d01 * (1.0f - fx) + d11 * fx) * fy;
+}
+
+// Distorts anything that has a non-null pointer with the same pseudo-random
+// smooth (elastic) displacement of up to amplitude pixels, like the warping
+// of paper that is not flat on the scanner. The displacements are random on
+// a coarse grid and interpolated in between, so the glyphs bend without
+// breaking. The pix must be 8 bit grey or 32 bit color, and is resampled
+// bilinearly. The boxes are moved with the displacement at their corners.
+void GenerateElasticDistortion(double amplitude, TRand* randomizer, Pix** pix,
+                               GenericVector<TBOX>* boxes) {
+  if (*pix == NULL) return;
+  int depth = pixGetDepth(*pix);
+  if (depth != 8 && depth != 32) {
+    tprintf("Elastic distortion needs an 8 or 32 bit image, not %d!\n", depth);
+    return;
+  }
+  int width = pixGetWidth(*pix);
+  int height = pixGetHeight(*pix);
+  int grid_width = (width + kElasticCellSize - 1) / kElasticCellSize + 1;
+  int grid_height = (height + kElasticCellSize - 1) / kElasticCellSize + 1;
+  GenericVector<FCOORD> grid;
+  grid.reserve(grid_width * grid_height);
+  for (int i = 0; i < grid_width * grid_height; ++i) {
+    float dx = randomizer->SignedRand(amplitude);
+    float dy = randomizer->SignedRand(amplitude);
+    grid.push_back(FCOORD(dx, dy));
+  }
+  // Each destination pixel takes the source pixel at its displacement.
+  Pix* warped = pixCreate(width, height, depth);
+  pixSetAllArbitrary(warped, depth == 8 ? 255 : 0xffffff00);
+  int samples_per_pixel = depth == 8 ? 1 : 3;
+  int src_wpl = pixGetWpl(*pix);
+  int dest_wpl = pixGetWpl(warped);
+  const l_uint32* src_data = pixGetData(*pix);
+  l_uint32* dest_line = pixGetData(warped);
+  for (int y = 0; y < height; ++y, dest_line += dest_wpl) {
+    for (int x = 0; x < width; ++x) {
+      FCOORD d = ElasticDisplacement(grid, grid_width, kElasticCellSize, x, y);
+      float src_x = x + d.x();
+      float src_y = y + d.y();
+      int x0 = static_cast<int>(floor(src_x));
+      int y0 = static_cast<int>(floor(src_y));
+      if (x0 < 0 || y0 < 0 || x0 + 1 >= width || y0 + 1 >= height) continue;
+      float fx = src_x - x0;
+      float fy = src_y - y0;
+      const l_uint32* line0 = src_data + y0 * src_wpl;
+      const l_uint32* line1 = line0 + src_wpl;
+      for (int c = 0; c < samples_per_pixel; ++c) {
+        // The color samples are COLOR_RED, COLOR_GREEN and COLOR_BLUE.
+        int i0 = depth == 8 ? x0 : x0 * 4 + c;
+        int i1 = depth == 8 ? x0 + 1 : (x0 + 1) * 4 + c;
+        float top = GET_DATA_BYTE(line0, i0) * (1.0f - fx) +
+                    GET_DATA_BYTE(line0, i1) * fx;
+        float bottom = GET_DATA_BYTE(line1, i0) * (1.0f - fx) +
+                       GET_DATA_BYTE(line1, i1) * fx;
+        int value = IntCastRounded(top * (1.0f - fy) + bottom * fy);
+        SET_DATA_BYTE(dest_line, depth == 8 ? x : x * 4 + c,
+                      ClipToRange(value, 0, 255));
+      }
+    }
+  }
+  pixDestroy(pix);
+  *pix = warped;
+  if (boxes != NULL) {
+    // A source point p lands near p - d(p), as the displacement is smooth.
+    for (int b = 0; b < boxes->size(); ++b) {
+      const TBOX& box = (*boxes)[b];
+      TBOX new_box;
+      for (int corner = 0; corner < 4; ++corner) {
+        int x = corner & 1 ? box.right() : box.left();
+        int y = corner & 2 ? box.top() : box.bottom();
+        FCOORD d = ElasticDisplacement(grid, grid_width, kElasticCellSize,
+                                       x, height - y);
+        ICOORD pt(IntCastRounded(x - d.x()), IntCastRounded(y + d.y()));
+        new_box += TBOX(pt, pt);
+      }
+      (*boxes)[b] = new_box;
+    }
+  }
+}
+
 // Creates and returns a Pix distorted by various means according to the bool
 // flags. If boxes is not NULL, the boxes are resized/positioned according to
 // any spatial distortion and also by the integer reduction factor box_scale
@@ -184,16 +374,15 @@ Pix* PrepareDistortedPix(const Pix* pix, bool perspective, bool invert,
   if (invert && randomizer->SignedRand(1.0) < 0)
     pixInvert(distorted, distorted);
   if ((white_noise || smooth_noise) && randomizer->SignedRand(1.0) > 0.0) {
-    // TODO(rays) Cook noise in a more thread-safe manner than rand().
-    // Attempt to make the sequences reproducible.
-    srand(randomizer->IntRand());
-    Pix* pixn = pixAddGaussianNoise(distorted, 8.0);
-    pixDestroy(&distorted);
-    if (smooth_noise) {
-      distorted = pixBlockconv(pixn, 1, 1);
-      pixDestroy(&pixn);
-    } else {
-      distorted = pixn;
+    Pix* pixn = AddGaussianNoise(distorted, 8.0, randomizer);
+    if (pixn != NULL) {
+      pixDestroy(&distorted);
+      if (smooth_noise) {
+        distorted = pixBlockconv(pixn, 1, 1);
+        pixDestroy(&pixn);
+      } else {
+        distorted = pixn;
+      }
     }
   }
   if (blur && randomizer->SignedRand(1.0) > 0.0) {
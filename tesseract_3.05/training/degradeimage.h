@@ -35,6 +35,23 @@ namespace tesseract {
 struct Pix* DegradeImage(struct Pix* input, int exposure, TRand* randomizer,
                          float* rotation);
 
+// Returns a copy of the 8 bit grey or 32 bit color pix with gaussian noise
+// of the given standard deviation added to each sample, drawn from the
+// randomizer. Returns NULL if the pix has any other depth.
+Pix* AddGaussianNoise(Pix* pix, double stddev, TRand* randomizer);
+// Sets the given fraction of the pixels of the 8 bit grey or 32 bit color pix
+// at random to black or white, as dust and drop-outs do on a scan.
+void AddSaltAndPepperNoise(Pix* pix, double fraction, TRand* randomizer);
+// Returns a copy of the 8 bit grey or 32 bit color pix after a round trip
+// through JPEG at the given quality, to add its block and ringing artifacts.
+// Returns NULL on error.
+Pix* AddJpegArtifacts(Pix* pix, int quality);
+// Distorts anything that has a non-null pointer with the same pseudo-random
+// smooth (elastic) displacement of up to amplitude pixels, like the warping
+// of paper that is not flat on the scanner. The pix must be 8 bit grey or
+// 32 bit color. The boxes are moved with the displacement at their corners.
+void GenerateElasticDistortion(double amplitude, TRand* randomizer, Pix** pix,
+                               GenericVector<TBOX>* boxes);
 // Creates and returns a Pix distorted by various means according to the bool
 // flags. If boxes is not NULL, the boxes are resized/positioned according to
 // any spatial distortion and also by the integer reduction factor box_scale
@@ -60,6 +60,7 @@
 #include "oldlist.h"
 #include "protos.h"
 #include "shapetable.h"
+#include "svutil.h"
 #include "tessopt.h"
 #include "tprintf.h"
 #include "unicity_table.h"
@@ -75,6 +76,7 @@ using tesseract::ShapeTable;
 const int kMaxShapeLabelLength = 10;
 
 DECLARE_STRING_PARAM_FLAG(test_ch);
+DECLARE_INT_PARAM_FLAG(threads);
 
 /*----------------------------------------------------------------------------
           Public Function Prototypes
@@ -120,33 +122,47 @@ static void DisplayProtoList(const char* ch, LIST protolist) {
 }
 #endif  // GRAPHICS_DISABLED
 
+// The configs to be clustered by ClusterOneConfig and their results.
+struct MFClusteringTasks {
+  const ShapeTable* shape_table;
+  MasterTrainer* trainer;
+  GenericVector<const char*> class_labels;
+  GenericVector<LIST> proto_lists;
+};
+
 // Helper to run clustering on a single config.
 // Mostly copied from the old mftraining, but with renamed variables.
-static LIST ClusterOneConfig(int shape_id, const char* class_label,
-                             LIST mf_classes,
-                             const ShapeTable& shape_table,
-                             MasterTrainer* trainer) {
+// Clusters the samples of shape shape_id and stores the significant protos
+// in tasks->proto_lists[shape_id]. Each call uses its own copy of the global
+// Config, so the configs can be clustered in parallel.
+static void ClusterOneConfig(void* arg, int shape_id) {
+  MFClusteringTasks* tasks = static_cast<MFClusteringTasks*>(arg);
+  const char* class_label = tasks->class_labels[shape_id];
   int num_samples;
-  CLUSTERER  *clusterer = trainer->SetupForClustering(shape_table,
-                                                      feature_defs,
-                                                      shape_id,
-                                                      &num_samples);
-  Config.MagicSamples = num_samples;
-  LIST proto_list = ClusterSamples(clusterer, &Config);
+  CLUSTERER  *clusterer = tasks->trainer->SetupForClustering(
+      *tasks->shape_table, feature_defs, shape_id, &num_samples);
+  CLUSTERCONFIG config = Config;
+  config.MagicSamples = num_samples;
+  LIST proto_list = ClusterSamples(clusterer, &config);
   CleanUpUnusedData(proto_list);
 
   // Merge protos where reasonable to make more of them significant by
   // representing almost all samples of the class/font.
-  MergeInsignificantProtos(proto_list, class_label, clusterer, &Config);
+  MergeInsignificantProtos(proto_list, class_label, clusterer, &config);
   #ifndef GRAPHICS_DISABLED
   if (strcmp(FLAGS_test_ch.c_str(), class_label) == 0)
     DisplayProtoList(FLAGS_test_ch.c_str(), proto_list);
   #endif  // GRAPHICS_DISABLED
   // Delete the protos that will not be used in the inttemp output file.
-  proto_list = RemoveInsignificantProtos(proto_list, true,
-                                         false,
-                                         clusterer->SampleSize);
+  tasks->proto_lists[shape_id] =
+      RemoveInsignificantProtos(proto_list, true, false,
+                                clusterer->SampleSize);
   FreeClusterer(clusterer);
+}
+
+// Helper to add the protos of a single clustered config to its class.
+static LIST AddConfigProtos(int shape_id, const char* class_label,
+                            LIST proto_list, LIST mf_classes) {
   MERGE_CLASS merge_class = FindClass(mf_classes, class_label);
   if (merge_class == NULL) {
     merge_class = NewLabeledClass(class_label);
@@ -276,9 +292,12 @@ int main (int argc, char **argv) {
     }
   }
 
-  // Now train each config separately.
+  // Now train each config separately. The configs are clustered in
+  // parallel, and then merged into their classes in order.
   int num_configs = shape_table->NumShapes();
-  LIST mf_classes = NIL_LIST;
+  MFClusteringTasks tasks;
+  tasks.shape_table = shape_table;
+  tasks.trainer = trainer;
   for (int s = 0; s < num_configs; ++s) {
     int unichar_id, font_id;
     if (unicharset == &shape_set) {
@@ -288,9 +307,14 @@ int main (int argc, char **argv) {
       // Get the real unichar_id from the shape table/unicharset.
       shape_table->GetFirstUnicharAndFont(s, &unichar_id, &font_id);
     }
-    const char* class_label = unicharset->id_to_unichar(unichar_id);
-    mf_classes = ClusterOneConfig(s, class_label, mf_classes, *shape_table,
-                                  trainer);
+    tasks.class_labels.push_back(unicharset->id_to_unichar(unichar_id));
+  }
+  tasks.proto_lists.init_to_size(num_configs, NIL_LIST);
+  SVSync::ParallelFor(num_configs, FLAGS_threads, ClusterOneConfig, &tasks);
+  LIST mf_classes = NIL_LIST;
+  for (int s = 0; s < num_configs; ++s) {
+    mf_classes = AddConfigProtos(s, tasks.class_labels[s],
+                                 tasks.proto_lists[s], mf_classes);
   }
   STRING inttemp_file = file_prefix;
   inttemp_file += "inttemp";
@@ -97,6 +97,10 @@ class StringRenderer {
   void set_page(int page) {
     page_ = page;
   }
+  // The page that the next RenderToImage will render.
+  int page() const {
+    return page_;
+  }
   void set_box_padding(int val) {
     box_padding_ = val;
   }
@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////
+// File:        text2charngram.cpp
+// Description: Program to build a character ngram model from a text file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////
+
+// Given a UTF-8 text file, this program writes the [lang].char-ngram file
+// that combine_tessdata can add to a traineddata file. The model is used by
+// the language model when language_model_ngram_on is set.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "charngram.h"
+#include "genericvector.h"
+#include "strngs.h"
+#include "tprintf.h"
+
+int main(int argc, char** argv) {
+  int order = 6;
+  int min_count = 2;
+  int argv_index = 1;
+  while (argv_index + 1 < argc && argv[argv_index][0] == '-') {
+    if (strcmp(argv[argv_index], "-o") == 0) {
+      order = atoi(argv[argv_index + 1]);
+    } else if (strcmp(argv[argv_index], "-c") == 0) {
+      min_count = atoi(argv[argv_index + 1]);
+    } else {
+      break;
+    }
+    argv_index += 2;
+  }
+  if (argc - argv_index != 2) {
+    printf("Usage: %s [-o order] [-c min_count] text_file char_ngram_file\n",
+           argv[0]);
+    return 1;
+  }
+  const char* text_filename = argv[argv_index];
+  const char* ngram_filename = argv[argv_index + 1];
+  GenericVector<char> data;
+  if (!tesseract::LoadDataFromFile(text_filename, &data)) {
+    tprintf("Failed to read text from '%s'\n", text_filename);
+    return 1;
+  }
+  STRING text(&data[0], data.size());
+  GenericVector<STRING> lines;
+  text.split('\n', &lines);
+  tprintf("Building order %d character ngram model from %d lines\n",
+          order, lines.size());
+  tesseract::CharNgram ngram;
+  ngram.Train(lines, order, min_count);
+  tprintf("Writing %d ngrams to '%s'\n", ngram.num_entries(), ngram_filename);
+  FILE* fp = fopen(ngram_filename, "wb");
+  if (fp == NULL || !ngram.Serialize(fp)) {
+    tprintf("Failed to write '%s'\n", ngram_filename);
+    if (fp != NULL) fclose(fp);
+    return 1;
+  }
+  fclose(fp);
+  return 0;
+}
@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <map>
 #include <string>
@@ -38,14 +39,17 @@
 #include <vector>
 
 #include "allheaders.h"  // from leptonica
+#include "augmentation.h"
 #include "boxchar.h"
 #include "commandlineflags.h"
 #include "degradeimage.h"
 #include "errcode.h"
 #include "fileio.h"
 #include "helpers.h"
+#include "mastertrainer.h"
 #include "normstrngs.h"
 #include "stringrenderer.h"
+#include "svutil.h"
 #include "tlog.h"
 #include "unicharset.h"
 #include "util.h"
@@ -73,6 +77,19 @@ BOOL_PARAM_FLAG(degrade_image, true,
 // Rotate the rendered image to have more realistic glyph borders
 BOOL_PARAM_FLAG(rotate_image, true, "Rotate the image in a random way.");
 
+// Further distortions of the rendered image, after any degradation.
+STRING_PARAM_FLAG(augment, "",
+                  "Comma-separated augmentation stages to apply to each page,"
+                  " of the form name[=param][@probability], where the names"
+                  " are degrade, invert, noise, saltpepper, blur, perspective,"
+                  " elastic and jpeg, eg elastic=3@0.5,jpeg=40");
+
+// Extract training samples from the rendered pages.
+BOOL_PARAM_FLAG(output_trb, false,
+                "Also write the training samples of the rendered pages to"
+                " output_base.trb for mftraining and shapeclustering, as"
+                " tesseract box.train would make them from the image");
+
 // Degradation to apply to the image.
 INT_PARAM_FLAG(exposure, 0, "Exposure level in photocopier");
 
@@ -139,6 +156,13 @@ DOUBLE_PARAM_FLAG(min_coverage, 1.0,
 
 BOOL_PARAM_FLAG(list_available_fonts, false, "List available fonts and quit.");
 
+STRING_PARAM_FLAG(fontlist, "",
+                  "File with one font name per line, as written by "
+                  "--find_fonts --norender_per_font, to render instead of "
+                  "--font. Each font is rendered to its own image and box "
+                  "file of the form output_name.font_name.tif/box");
+INT_PARAM_FLAG(threads, 1, "Number of fonts of --fontlist to render at once");
+
 BOOL_PARAM_FLAG(render_ngrams, false, "Put each space-separated entity from the"
                 " input file into one bounding box. The ngrams in the input"
                 " file will be randomly permuted before rendering (so that"
@@ -313,7 +337,9 @@ void ExtractFontProperties(const string &utf8_text,
 
 bool MakeIndividualGlyphs(Pix* pix,
                           const vector<BoxChar*>& vbox,
-                          const int input_tiff_page) {
+                          const int input_tiff_page,
+                          const string& output_base,
+                          int* glyph_count) {
   // If checks fail, return false without exiting text2image
   if (!pix) {
     tprintf("ERROR: MakeIndividualGlyphs(): Input Pix* is NULL\n");
@@ -330,7 +356,6 @@ bool MakeIndividualGlyphs(Pix* pix,
   int n_boxes_saved = 0;
   int current_tiff_page = 0;
   int y_previous = 0;
-  static int glyph_count = 0;
   for (int i = 0; i < n_boxes; i++) {
     // Get one bounding box
     Box* b = vbox[i]->mutable_box();
@@ -384,8 +409,8 @@ bool MakeIndividualGlyphs(Pix* pix,
     // Write out
     Pix* pix_glyph_sq_pad_8 = pixConvertTo8(pix_glyph_sq_pad, false);
     char filename[1024];
-    snprintf(filename, 1024, "%s_%d.jpg", FLAGS_outputbase.c_str(),
-             glyph_count++);
+    snprintf(filename, 1024, "%s_%d.jpg", output_base.c_str(),
+             (*glyph_count)++);
     if (pixWriteJpeg(filename, pix_glyph_sq_pad_8, 100, 0)) {
       tprintf("ERROR: MakeIndividualGlyphs(): Failed to write JPEG to %s,"
               " at i=%d\n", filename, i);
@@ -406,12 +431,255 @@ bool MakeIndividualGlyphs(Pix* pix,
     return true;
   }
 }
+
+// Applies the rendering flags to the given renderer.
+void SetupRenderer(StringRenderer* render) {
+  render->set_add_ligatures(FLAGS_ligatures);
+  render->set_leading(FLAGS_leading);
+  render->set_resolution(FLAGS_resolution);
+  render->set_char_spacing(FLAGS_char_spacing * FLAGS_ptsize);
+  render->set_h_margin(FLAGS_margin);
+  render->set_v_margin(FLAGS_margin);
+  render->set_output_word_boxes(FLAGS_output_word_boxes);
+  render->set_box_padding(FLAGS_box_padding);
+  render->set_strip_unrenderable_words(FLAGS_strip_unrenderable_words);
+  render->set_underline_start_prob(FLAGS_underline_start_prob);
+  render->set_underline_continuation_prob(FLAGS_underline_continuation_prob);
+
+  // Set text rendering orientation and their forms.
+  if (FLAGS_writing_mode == "horizontal") {
+    // Render regular horizontal text (default).
+    render->set_vertical_text(false);
+    render->set_gravity_hint_strong(false);
+    render->set_render_fullwidth_latin(false);
+  } else if (FLAGS_writing_mode == "vertical") {
+    // Render vertical text. Glyph orientation is selected by Pango.
+    render->set_vertical_text(true);
+    render->set_gravity_hint_strong(false);
+    render->set_render_fullwidth_latin(false);
+  } else if (FLAGS_writing_mode == "vertical-upright") {
+    // Render vertical text. Glyph orientation is set to be upright.
+    // Also Basic Latin characters are converted to their fullwidth forms
+    // on rendering, since fullwidth Latin characters are well designed to fit
+    // vertical text lines, while .box files store halfwidth Basic Latin
+    // unichars.
+    render->set_vertical_text(true);
+    render->set_gravity_hint_strong(true);
+    render->set_render_fullwidth_latin(true);
+  }
+}
+
+// Returns the name of the font in training files, as tesstrain.sh makes it.
+string TrainingFontName(const string& font) {
+  string name = StringReplace(font, " ", "_");
+  name.erase(std::remove(name.begin(), name.end(), ','), name.end());
+  return name;
+}
+
+// Gets the BoxChars of the page that render rendered last, except those
+// without a box, into page_boxchars, their boxes in tesseract coordinates for
+// a page of the given height into boxes, and their text into unichars.
+// Gets nothing if that page has no boxes.
+static void GetPageBoxes(const StringRenderer& render, int height,
+                         vector<BoxChar*>* page_boxchars,
+                         GenericVector<TBOX>* boxes,
+                         GenericVector<STRING>* unichars) {
+  const vector<BoxChar*>& boxchars = render.GetBoxes();
+  int page = render.page() - 1;
+  int start = boxchars.size();
+  while (start > 0 && boxchars[start - 1]->page() == page)
+    --start;
+  for (int i = start; i < boxchars.size(); ++i) {
+    const Box* box = boxchars[i]->box();
+    if (box == NULL) continue;
+    page_boxchars->push_back(boxchars[i]);
+    boxes->push_back(TBOX(box->x, height - box->y - box->h,
+                          box->x + box->w, height - box->y));
+    unichars->push_back(STRING(boxchars[i]->ch().c_str()));
+  }
+}
+
+// Renders to_render_utf8 with the given renderer, degrades and augments the
+// pages and writes them to output_base.tif, or with --find_fonts, writes each
+// page to a file per font or adds the font to font_names. With --output_trb,
+// the training samples of the pages are written to output_base.trb with the
+// font name of tr_font. Returns the number of pages rendered.
+int RenderPages(const char* to_render_utf8, StringRenderer* render,
+                const string& tr_font, const string& output_base,
+                vector<string>* font_names) {
+  int im = 0;
+  int glyph_count = 0;
+  vector<float> page_rotation;
+  AugmentationPipeline augmentation;
+  augmentation.ParseSpec(FLAGS_augment.c_str());  // Checked by main.
+  bool output_trb = FLAGS_output_trb && !FLAGS_find_fonts;
+  TrFileSamples samples;
+
+  tesseract::TRand randomizer;
+  randomizer.set_seed(kRandomSeed);
+  // We use a two pass mechanism to rotate images in both direction.
+  // The first pass(0) will rotate the images in random directions and
+  // the second pass(1) will mirror those rotations.
+  int num_pass = FLAGS_bidirectional_rotation ? 2 : 1;
+  for (int pass = 0; pass < num_pass; ++pass) {
+    int page_num = 0;
+    string font_used;
+    for (int offset = 0; offset < strlen(to_render_utf8); ++im, ++page_num) {
+      tlog(1, "Starting page %d\n", im);
+      Pix* pix = NULL;
+      if (FLAGS_find_fonts) {
+        offset += render->RenderAllFontsToImage(FLAGS_min_coverage,
+                                                to_render_utf8 + offset,
+                                                strlen(to_render_utf8 + offset),
+                                                &font_used, &pix);
+      } else {
+        offset += render->RenderToImage(to_render_utf8 + offset,
+                                        strlen(to_render_utf8 + offset), &pix);
+      }
+      if (pix != NULL) {
+        float rotation = 0;
+        if (pass == 1) {
+          // Pass 2, do mirror rotation.
+          rotation = -1 * page_rotation[page_num];
+        }
+        if (FLAGS_degrade_image) {
+          pix = DegradeImage(pix, FLAGS_exposure, &randomizer,
+                             FLAGS_rotate_image ? &rotation : NULL);
+        }
+        render->RotatePageBoxes(rotation);
+
+        if (pass == 0) {
+          // Pass 1, rotate randomly and store the rotation..
+          page_rotation.push_back(rotation);
+        }
+        // The boxes of this page, for the augmentation and the samples.
+        vector<BoxChar*> page_boxchars;
+        GenericVector<TBOX> page_boxes;
+        GenericVector<STRING> page_unichars;
+        int height = pixGetHeight(pix);
+        if (!augmentation.empty() || output_trb) {
+          GetPageBoxes(*render, height, &page_boxchars, &page_boxes,
+                       &page_unichars);
+        }
+        if (!augmentation.empty()) {
+          Pix* augmented = augmentation.Apply(pix, &randomizer, &page_boxes);
+          if (augmented != NULL) {
+            pixDestroy(&pix);
+            pix = augmented;
+            // Move the boxes with any spatial distortion.
+            for (int b = 0; b < page_boxes.size(); ++b) {
+              const TBOX& box = page_boxes[b];
+              boxSetGeometry(page_boxchars[b]->mutable_box(), box.left(),
+                             height - box.top(), box.width(), box.height());
+            }
+          }
+        }
+
+        Pix* gray_pix = pixConvertTo8(pix, false);
+        pixDestroy(&pix);
+        Pix* binary = pixThresholdToBinary(gray_pix, 128);
+        pixDestroy(&gray_pix);
+        if (output_trb) {
+          ExtractPageSamples(binary, page_boxes, page_unichars,
+                             STRING(tr_font.c_str()), im, &samples);
+        }
+        char tiff_name[1024];
+        if (FLAGS_find_fonts) {
+          if (FLAGS_render_per_font) {
+            string fontname_for_file = tesseract::StringReplace(
+                font_used, " ", "_");
+            snprintf(tiff_name, 1024, "%s.%s.tif", output_base.c_str(),
+                     fontname_for_file.c_str());
+            pixWriteTiff(tiff_name, binary, IFF_TIFF_G4, "w");
+            tprintf("Rendered page %d to file %s\n", im, tiff_name);
+          } else {
+            font_names->push_back(font_used);
+          }
+        } else {
+          snprintf(tiff_name, 1024, "%s.tif", output_base.c_str());
+          pixWriteTiff(tiff_name, binary, IFF_TIFF_G4, im == 0 ? "w" : "a");
+          tprintf("Rendered page %d to file %s\n", im, tiff_name);
+        }
+        // Make individual glyphs
+        if (FLAGS_output_individual_glyph_images) {
+          if (!MakeIndividualGlyphs(binary, render->GetBoxes(), im,
+                                    output_base, &glyph_count)) {
+            tprintf("ERROR: Individual glyphs not saved\n");
+          }
+        }
+        pixDestroy(&binary);
+      }
+      if (FLAGS_find_fonts && offset != 0) {
+        // We just want a list of names, or some sample images so we don't need
+        // to render more than the first page of the text.
+        break;
+      }
+    }
+  }
+  if (output_trb) {
+    string trb_name = output_base + ".trb";
+    if (MasterTrainer::WriteBinaryTrFile(samples, trb_name.c_str())) {
+      tprintf("Wrote %d training samples to %s\n", samples.samples.size(),
+              trb_name.c_str());
+    }
+  }
+  return im;
+}
+
+// The fonts of --fontlist, rendered in parallel by RenderFontList.
+struct FontListTasks {
+  const char* text;
+  vector<string> fonts;
+  vector<int> num_pages;
+};
+
+// Renders tasks->text in tasks->fonts[index] with a renderer of its own,
+// and writes the pages and boxes to output_name.font_name.tif/box.
+static void RenderOneFont(void* arg, int index) {
+  FontListTasks* tasks = static_cast<FontListTasks*>(arg);
+  const string& font = tasks->fonts[index];
+  char font_desc_name[1024];
+  snprintf(font_desc_name, 1024, "%s %d", font.c_str(),
+           static_cast<int>(FLAGS_ptsize));
+  StringRenderer render(font_desc_name, FLAGS_xsize, FLAGS_ysize);
+  SetupRenderer(&render);
+  string output_base = FLAGS_outputbase.c_str();
+  output_base += "." + StringReplace(font, " ", "_");
+  tasks->num_pages[index] = RenderPages(tasks->text, &render,
+                                        TrainingFontName(font), output_base,
+                                        NULL);
+  render.WriteAllBoxes(output_base + ".box");
+}
+
+// Renders the text in each of the given fonts, using up to FLAGS_threads
+// threads, and reports the throughput.
+void RenderFontList(const string& utf8_text, const vector<string>& fonts) {
+  FontListTasks tasks;
+  tasks.text = utf8_text.c_str();
+  tasks.fonts = fonts;
+  tasks.num_pages.resize(fonts.size(), 0);
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  SVSync::ParallelFor(fonts.size(), FLAGS_threads, RenderOneFont, &tasks);
+  double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  int total_pages = 0;
+  for (int i = 0; i < tasks.num_pages.size(); ++i)
+    total_pages += tasks.num_pages[i];
+  tprintf("Rendered %d pages in %d fonts in %.1fs: %.2f pages/s,"
+          " %.2f fonts/s\n", total_pages, static_cast<int>(fonts.size()),
+          seconds, total_pages / MAX(seconds, 1e-3),
+          fonts.size() / MAX(seconds, 1e-3));
+}
 }  // namespace tesseract
 
+using tesseract::AugmentationPipeline;
 using tesseract::DegradeImage;
 using tesseract::ExtractFontProperties;
 using tesseract::File;
 using tesseract::FontUtils;
+using tesseract::RenderPages;
+using tesseract::SetupRenderer;
 using tesseract::SpanUTF8NotWhitespace;
 using tesseract::SpanUTF8Whitespace;
 using tesseract::StringRenderer;
@@ -443,14 +711,56 @@ int main(int argc, char** argv) {
     exit(1);
   }
 
-  if (!FLAGS_find_fonts && !FontUtils::IsAvailableFont(FLAGS_font.c_str())) {
+  if (!(FLAGS_writing_mode == "horizontal" ||
+        FLAGS_writing_mode == "vertical" ||
+        FLAGS_writing_mode == "vertical-upright")) {
+    tprintf("Invalid writing mode: %s\n", FLAGS_writing_mode.c_str());
+    exit(1);
+  }
+
+  vector<string> font_list;
+  if (!FLAGS_fontlist.empty()) {
+    if (FLAGS_find_fonts || FLAGS_only_extract_font_properties) {
+      tprintf("Use '--fontlist' only without '--find_fonts' and"
+              " '--only_extract_font_properties'.\n");
+      exit(1);
+    }
+    string font_list_text;
+    if (!File::ReadFileToString(FLAGS_fontlist.c_str(), &font_list_text)) {
+      tprintf("Failed to read font list: %s\n", FLAGS_fontlist.c_str());
+      exit(1);
+    }
+    int start = 0;
+    while (start < font_list_text.length()) {
+      int end = font_list_text.find('\n', start);
+      if (end == string::npos) end = font_list_text.length();
+      string font = font_list_text.substr(start, end - start);
+      if (!font.empty() && font[font.length() - 1] == '\r')
+        font.erase(font.length() - 1);
+      if (!font.empty()) font_list.push_back(font);
+      start = end + 1;
+    }
+    if (font_list.empty()) {
+      tprintf("No fonts in font list: %s\n", FLAGS_fontlist.c_str());
+      exit(1);
+    }
+  } else if (!FLAGS_find_fonts) {
+    font_list.push_back(FLAGS_font.c_str());
+  }
+  // Check all the fonts before any rendering starts, which also initializes
+  // the font configuration before there is more than one thread.
+  for (int i = 0; i < font_list.size(); ++i) {
+    if (FontUtils::IsAvailableFont(font_list[i].c_str())) continue;
     string pango_name;
-    if (!FontUtils::IsAvailableFont(FLAGS_font.c_str(), &pango_name)) {
-      tprintf("Could not find font named %s.\n", FLAGS_font.c_str());
+    if (!FontUtils::IsAvailableFont(font_list[i].c_str(), &pango_name)) {
+      tprintf("Could not find font named %s.\n", font_list[i].c_str());
       if (!pango_name.empty()) {
         tprintf("Pango suggested font %s.\n", pango_name.c_str());
       }
-      tprintf("Please correct --font arg.\n");
+      if (FLAGS_fontlist.empty())
+        tprintf("Please correct --font arg.\n");
+      else
+        tprintf("Please correct --fontlist file.\n");
       exit(1);
     }
   }
@@ -458,46 +768,16 @@ int main(int argc, char** argv) {
   if (FLAGS_render_ngrams)
     FLAGS_output_word_boxes = true;
 
+  if (!AugmentationPipeline().ParseSpec(FLAGS_augment.c_str())) {
+    tprintf("Please correct --augment arg.\n");
+    exit(1);
+  }
+
   char font_desc_name[1024];
   snprintf(font_desc_name, 1024, "%s %d", FLAGS_font.c_str(),
            static_cast<int>(FLAGS_ptsize));
   StringRenderer render(font_desc_name, FLAGS_xsize, FLAGS_ysize);
-  render.set_add_ligatures(FLAGS_ligatures);
-  render.set_leading(FLAGS_leading);
-  render.set_resolution(FLAGS_resolution);
-  render.set_char_spacing(FLAGS_char_spacing * FLAGS_ptsize);
-  render.set_h_margin(FLAGS_margin);
-  render.set_v_margin(FLAGS_margin);
-  render.set_output_word_boxes(FLAGS_output_word_boxes);
-  render.set_box_padding(FLAGS_box_padding);
-  render.set_strip_unrenderable_words(FLAGS_strip_unrenderable_words);
-  render.set_underline_start_prob(FLAGS_underline_start_prob);
-  render.set_underline_continuation_prob(FLAGS_underline_continuation_prob);
-
-  // Set text rendering orientation and their forms.
-  if (FLAGS_writing_mode == "horizontal") {
-    // Render regular horizontal text (default).
-    render.set_vertical_text(false);
-    render.set_gravity_hint_strong(false);
-    render.set_render_fullwidth_latin(false);
-  } else if (FLAGS_writing_mode == "vertical") {
-    // Render vertical text. Glyph orientation is selected by Pango.
-    render.set_vertical_text(true);
-    render.set_gravity_hint_strong(false);
-    render.set_render_fullwidth_latin(false);
-  } else if (FLAGS_writing_mode == "vertical-upright") {
-    // Render vertical text. Glyph orientation is set to be upright.
-    // Also Basic Latin characters are converted to their fullwidth forms
-    // on rendering, since fullwidth Latin characters are well designed to fit
-    // vertical text lines, while .box files store halfwidth Basic Latin
-    // unichars.
-    render.set_vertical_text(true);
-    render.set_gravity_hint_strong(true);
-    render.set_render_fullwidth_latin(true);
-  } else {
-    tprintf("Invalid writing mode: %s\n", FLAGS_writing_mode.c_str());
-    exit(1);
-  }
+  SetupRenderer(&render);
 
   string src_utf8;
   // This c_str is NOT redundant!
@@ -573,85 +853,15 @@ int main(int argc, char** argv) {
     return 0;
   }
 
-  int im = 0;
-  vector<float> page_rotation;
-  const char* to_render_utf8 = src_utf8.c_str();
+  if (!FLAGS_fontlist.empty()) {
+    tesseract::RenderFontList(src_utf8, font_list);
+    return 0;
+  }
 
-  tesseract::TRand randomizer;
-  randomizer.set_seed(kRandomSeed);
   vector<string> font_names;
-  // We use a two pass mechanism to rotate images in both direction.
-  // The first pass(0) will rotate the images in random directions and
-  // the second pass(1) will mirror those rotations.
-  int num_pass = FLAGS_bidirectional_rotation ? 2 : 1;
-  for (int pass = 0; pass < num_pass; ++pass) {
-    int page_num = 0;
-    string font_used;
-    for (int offset = 0; offset < strlen(to_render_utf8); ++im, ++page_num) {
-      tlog(1, "Starting page %d\n", im);
-      Pix* pix = NULL;
-      if (FLAGS_find_fonts) {
-        offset += render.RenderAllFontsToImage(FLAGS_min_coverage,
-                                               to_render_utf8 + offset,
-                                               strlen(to_render_utf8 + offset),
-                                               &font_used, &pix);
-      } else {
-        offset += render.RenderToImage(to_render_utf8 + offset,
-                                       strlen(to_render_utf8 + offset), &pix);
-      }
-      if (pix != NULL) {
-        float rotation = 0;
-        if (pass == 1) {
-          // Pass 2, do mirror rotation.
-          rotation = -1 * page_rotation[page_num];
-        }
-        if (FLAGS_degrade_image) {
-          pix = DegradeImage(pix, FLAGS_exposure, &randomizer,
-                             FLAGS_rotate_image ? &rotation : NULL);
-        }
-        render.RotatePageBoxes(rotation);
-
-        if (pass == 0) {
-          // Pass 1, rotate randomly and store the rotation..
-          page_rotation.push_back(rotation);
-        }
-
-        Pix* gray_pix = pixConvertTo8(pix, false);
-        pixDestroy(&pix);
-        Pix* binary = pixThresholdToBinary(gray_pix, 128);
-        pixDestroy(&gray_pix);
-        char tiff_name[1024];
-        if (FLAGS_find_fonts) {
-          if (FLAGS_render_per_font) {
-            string fontname_for_file = tesseract::StringReplace(
-                font_used, " ", "_");
-            snprintf(tiff_name, 1024, "%s.%s.tif", FLAGS_outputbase.c_str(),
-                     fontname_for_file.c_str());
-            pixWriteTiff(tiff_name, binary, IFF_TIFF_G4, "w");
-            tprintf("Rendered page %d to file %s\n", im, tiff_name);
-          } else {
-            font_names.push_back(font_used);
-          }
-        } else {
-          snprintf(tiff_name, 1024, "%s.tif", FLAGS_outputbase.c_str());
-          pixWriteTiff(tiff_name, binary, IFF_TIFF_G4, im == 0 ? "w" : "a");
-          tprintf("Rendered page %d to file %s\n", im, tiff_name);
-        }
-        // Make individual glyphs
-        if (FLAGS_output_individual_glyph_images) {
-          if (!MakeIndividualGlyphs(binary, render.GetBoxes(), im)) {
-            tprintf("ERROR: Individual glyphs not saved\n");
-          }
-        }
-        pixDestroy(&binary);
-      }
-      if (FLAGS_find_fonts && offset != 0) {
-        // We just want a list of names, or some sample images so we don't need
-        // to render more than the first page of the text.
-        break;
-      }
-    }
-  }
+  RenderPages(src_utf8.c_str(), &render,
+              tesseract::TrainingFontName(FLAGS_font.c_str()),
+              FLAGS_outputbase.c_str(), &font_names);
   if (!FLAGS_find_fonts) {
     string box_name = FLAGS_outputbase.c_str();
     box_name += ".box";
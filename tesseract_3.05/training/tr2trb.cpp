@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////
+// File:        tr2trb.cpp
+// Description: Program to convert .tr training files to binary .trb files.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////
+
+// Converts each [lang].[fontname].exp[num].tr file given on the command line
+// to [lang].[fontname].exp[num].trb in the same directory. The .trb files
+// hold the same samples as the .tr files, but mftraining, cntraining and
+// shapeclustering read them without any text parsing, so they load much
+// faster when the same training data is used many times.
+
+#include <string.h>
+
+#ifndef USE_STD_NAMESPACE
+#include "base/commandlineflags.h"
+#endif
+#include "commontraining.h"
+#include "featdefs.h"
+#include "genericvector.h"
+#include "mastertrainer.h"
+#include "strngs.h"
+#include "svutil.h"
+#include "tprintf.h"
+
+DECLARE_INT_PARAM_FLAG(threads);
+
+// The files converted in parallel.
+struct ConversionTasks {
+  GenericVector<STRING> page_names;
+  GenericVector<bool> results;
+};
+
+// Converts tasks->page_names[index].
+static void ConvertOneFile(void* arg, int index) {
+  ConversionTasks* tasks = static_cast<ConversionTasks*>(arg);
+  const char* page_name = tasks->page_names[index].string();
+  STRING trb_name = page_name;
+  const char* extension = strrchr(page_name, '.');
+  if (extension != NULL)
+    trb_name.truncate_at(extension - page_name);
+  trb_name += ".trb";
+  tesseract::TrFileSamples samples;
+  tasks->results[index] =
+      tesseract::MasterTrainer::ReadTrFile(page_name, feature_defs,
+                                           &samples) &&
+      tesseract::MasterTrainer::WriteBinaryTrFile(samples, trb_name.string());
+}
+
+int main(int argc, char** argv) {
+  ParseArguments(&argc, &argv);
+  InitFeatureDefs(&feature_defs);
+  ConversionTasks tasks;
+  const char* page_name;
+  while ((page_name = GetNextFilename(argc, argv)) != NULL)
+    tasks.page_names.push_back(STRING(page_name));
+  if (tasks.page_names.empty()) {
+    tprintf("Usage: %s [--threads n] file.tr...\n", argv[0]);
+    return 1;
+  }
+  tasks.results.init_to_size(tasks.page_names.size(), false);
+  SVSync::ParallelFor(tasks.page_names.size(), FLAGS_threads, ConvertOneFile,
+                      &tasks);
+  int num_failed = 0;
+  for (int i = 0; i < tasks.results.size(); ++i) {
+    if (!tasks.results[i]) {
+      tprintf("Failed to convert %s\n", tasks.page_names[i].string());
+      ++num_failed;
+    }
+  }
+  return num_failed > 0 ? 1 : 0;
+}
@@ -19,8 +19,13 @@
 
 // Given a file that contains a list of words (one word per line) this program
 // generates the corresponding squished DAWG file.
+// The DAWG is built directly in its minimal form. That is fastest and needs
+// the least memory when the word list is sorted (LC_ALL=C sort), otherwise
+// the list is sorted in memory first. With -j n, the DAWG of a word list is
+// built on n threads, after reading and sorting it in memory.
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "classify.h"
 #include "dawg.h"
@@ -32,10 +37,17 @@
 #include "unicharset.h"
 
 int main(int argc, char** argv) {
+  const char* program = argv[0];
+  int num_threads = 1;
+  if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+    num_threads = atoi(argv[2]);
+    argc -= 2;
+    argv += 2;
+  }
   if (!(argc == 4 || (argc == 5 && strcmp(argv[1], "-t") == 0) ||
       (argc == 6 && strcmp(argv[1], "-r") == 0))) {
-    printf("Usage: %s [-t | -r [reverse policy] ] word_list_file"
-           " dawg_file unicharset_file\n", argv[0]);
+    printf("Usage: %s [-j num_threads] [-t | -r [reverse policy] ]"
+           " word_list_file dawg_file unicharset_file\n", program);
     return 1;
   }
   tesseract::Classify *classify = new tesseract::Classify();
@@ -67,15 +79,15 @@ int main(int argc, char** argv) {
         // the first 3 arguments are not used in this case
         tesseract::DAWG_TYPE_WORD, "", SYSTEM_DAWG_PERM,
         unicharset.size(), classify->getDict().dawg_debug_level);
-    tprintf("Reading word list from '%s'\n", wordlist_filename);
-    if (!trie.read_and_add_word_list(wordlist_filename, unicharset,
-                                     reverse_policy)) {
-      tprintf("Failed to add word list from '%s'\n", wordlist_filename);
+    tprintf("Building SquishedDawg from word list '%s'\n",
+            wordlist_filename);
+    tesseract::SquishedDawg *dawg = trie.read_word_list_to_dawg(
+        wordlist_filename, unicharset, reverse_policy, num_threads);
+    if (dawg == NULL) {
+      tprintf("Failed to read word list from '%s'\n", wordlist_filename);
       exit(1);
     }
-    tprintf("Reducing Trie to SquishedDawg\n");
-    tesseract::SquishedDawg *dawg = trie.trie_to_dawg();
-    if (dawg != NULL && dawg->NumEdges() > 0) {
+    if (dawg->NumEdges() > 0) {
       tprintf("Writing squished DAWG to '%s'\n", dawg_filename);
       dawg->write_squished_dawg(dawg_filename);
     } else {
@@ -83,10 +83,6 @@ void SVMutex::Unlock() {
 #endif
 }
 
-#ifndef GRAPHICS_DISABLED
-
-const int kMaxMsgSize = 4096;
-
 // Signals a thread to exit.
 void SVSync::ExitThread() {
 #ifdef _WIN32
@@ -96,60 +92,6 @@ void SVSync::ExitThread() {
 #endif
 }
 
-// Starts a new process.
-void SVSync::StartProcess(const char* executable, const char* args) {
-  std::string proc;
-  proc.append(executable);
-  proc.append(" ");
-  proc.append(args);
-  std::cout << "Starting " << proc << std::endl;
-#ifdef _WIN32
-  STARTUPINFO start_info;
-  PROCESS_INFORMATION proc_info;
-  GetStartupInfo(&start_info);
-  if (!CreateProcess(NULL, const_cast<char*>(proc.c_str()), NULL, NULL, FALSE,
-                CREATE_NO_WINDOW | DETACHED_PROCESS, NULL, NULL,
-                &start_info, &proc_info))
-    return;
-#else
-  int pid = fork();
-  if (pid != 0) {   // The father process returns
-  } else {
-#ifdef __linux__
-    // Make sure the java process terminates on exit, since its
-    // broken socket detection seems to be useless.
-    prctl(PR_SET_PDEATHSIG, 2, 0, 0, 0);
-#endif
-    char* mutable_args = strdup(args);
-    int argc = 1;
-    for (int i = 0; mutable_args[i]; ++i) {
-      if (mutable_args[i] == ' ') {
-        ++argc;
-      }
-    }
-    char** argv = new char*[argc + 2];
-    argv[0] = strdup(executable);
-    argv[1] = mutable_args;
-    argc = 2;
-    bool inquote = false;
-    for (int i = 0; mutable_args[i]; ++i) {
-      if (!inquote && mutable_args[i] == ' ') {
-        mutable_args[i] = '\0';
-        argv[argc++] = mutable_args + i + 1;
-      } else if (mutable_args[i] == '"') {
-        inquote = !inquote;
-        mutable_args[i] = ' ';
-      }
-    }
-    argv[argc] = NULL;
-    execvp(executable, argv);
-    free(argv[0]);
-    free(argv[1]);
-    delete[] argv;
-  }
-#endif
-}
-
 SVSemaphore::SVSemaphore() {
 #ifdef _WIN32
   semaphore_ = CreateSemaphore(0, 0, 10, 0);
@@ -166,6 +108,16 @@ SVSemaphore::SVSemaphore() {
 #endif
 }
 
+SVSemaphore::~SVSemaphore() {
+#ifdef _WIN32
+  CloseHandle(semaphore_);
+#elif defined(__APPLE__)
+  sem_close(semaphore_);
+#else
+  sem_destroy(&semaphore_);
+#endif
+}
+
 void SVSemaphore::Signal() {
 #ifdef _WIN32
   ReleaseSemaphore(semaphore_, 1, NULL);
@@ -187,25 +139,176 @@ void SVSemaphore::Wait() {
 }
 
 
+#ifdef _WIN32
+// The function and argument of a thread, as CreateThread takes a WINAPI
+// function, not the cdecl one given to StartThread.
+struct SVThreadStart {
+  void *(*func)(void*);
+  void* arg;
+};
+
+static DWORD WINAPI SVThreadFunc(LPVOID data) {
+  SVThreadStart* start = static_cast<SVThreadStart*>(data);
+  void *(*func)(void*) = start->func;
+  void* arg = start->arg;
+  delete start;
+  func(arg);
+  return 0;
+}
+#endif
+
 // Create new thread.
 
-void SVSync::StartThread(void *(*func)(void*), void* arg) {
+bool SVSync::StartThread(void *(*func)(void*), void* arg) {
 #ifdef _WIN32
-  LPTHREAD_START_ROUTINE f = (LPTHREAD_START_ROUTINE) func;
+  SVThreadStart* start = new SVThreadStart;
+  start->func = func;
+  start->arg = arg;
   DWORD threadid;
   HANDLE newthread = CreateThread(
   NULL,          // default security attributes
   0,             // use default stack size
-  f,             // thread function
-  arg,           // argument to thread function
+  SVThreadFunc,  // thread function
+  start,         // argument to thread function
   0,             // use default creation flags
   &threadid);    // returns the thread identifier
+  if (newthread == NULL) {
+    delete start;
+    return false;
+  }
+  // The thread is never joined, so its handle is not needed.
+  CloseHandle(newthread);
+  return true;
 #else
   pthread_t helper;
   pthread_attr_t attr;
   pthread_attr_init(&attr);
   pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-  pthread_create(&helper, &attr, func, arg);
+  int result = pthread_create(&helper, &attr, func, arg);
+  pthread_attr_destroy(&attr);
+  return result == 0;
+#endif
+}
+
+// Shared state of the threads of a ParallelFor call.
+struct SVParallelForState {
+  void (*func)(void*, int);
+  void* arg;
+  int count;
+  int next_index;
+  int running_threads;
+  SVMutex mutex;
+  SVSemaphore done;
+};
+
+// Claims and runs indices of the ParallelFor until there are none left.
+static void RunParallelForTasks(SVParallelForState* state) {
+  while (true) {
+    state->mutex.Lock();
+    int index = state->next_index++;
+    state->mutex.Unlock();
+    if (index >= state->count) break;
+    (*state->func)(state->arg, index);
+  }
+}
+
+static void* ParallelForThread(void* arg) {
+  SVParallelForState* state = static_cast<SVParallelForState*>(arg);
+  RunParallelForTasks(state);
+  state->mutex.Lock();
+  bool last = --state->running_threads == 0;
+  state->mutex.Unlock();
+  if (last) state->done.Signal();
+  return NULL;
+}
+
+// Calls func(arg, index) for every index in [0, count), using up to
+// num_threads threads, including the calling thread.
+void SVSync::ParallelFor(int count, int num_threads,
+                         void (*func)(void*, int), void* arg) {
+  if (num_threads > count) num_threads = count;
+  if (num_threads <= 1) {
+    for (int i = 0; i < count; ++i) (*func)(arg, i);
+    return;
+  }
+  SVParallelForState state;
+  state.func = func;
+  state.arg = arg;
+  state.count = count;
+  state.next_index = 0;
+  // The calling thread counts as running until it has run out of tasks, so
+  // that a thread that could not be started can be taken off the count
+  // without it reaching 0.
+  state.running_threads = num_threads;
+  for (int t = 1; t < num_threads; ++t) {
+    if (!StartThread(ParallelForThread, &state)) {
+      state.mutex.Lock();
+      --state.running_threads;
+      state.mutex.Unlock();
+    }
+  }
+  RunParallelForTasks(&state);
+  state.mutex.Lock();
+  bool last = --state.running_threads == 0;
+  state.mutex.Unlock();
+  if (!last) state.done.Wait();
+}
+
+#ifndef GRAPHICS_DISABLED
+
+const int kMaxMsgSize = 4096;
+
+// Starts a new process.
+void SVSync::StartProcess(const char* executable, const char* args) {
+  std::string proc;
+  proc.append(executable);
+  proc.append(" ");
+  proc.append(args);
+  std::cout << "Starting " << proc << std::endl;
+#ifdef _WIN32
+  STARTUPINFO start_info;
+  PROCESS_INFORMATION proc_info;
+  GetStartupInfo(&start_info);
+  if (!CreateProcess(NULL, const_cast<char*>(proc.c_str()), NULL, NULL, FALSE,
+                CREATE_NO_WINDOW | DETACHED_PROCESS, NULL, NULL,
+                &start_info, &proc_info))
+    return;
+#else
+  int pid = fork();
+  if (pid != 0) {   // The father process returns
+  } else {
+#ifdef __linux__
+    // Make sure the java process terminates on exit, since its
+    // broken socket detection seems to be useless.
+    prctl(PR_SET_PDEATHSIG, 2, 0, 0, 0);
+#endif
+    char* mutable_args = strdup(args);
+    int argc = 1;
+    for (int i = 0; mutable_args[i]; ++i) {
+      if (mutable_args[i] == ' ') {
+        ++argc;
+      }
+    }
+    char** argv = new char*[argc + 2];
+    argv[0] = strdup(executable);
+    argv[1] = mutable_args;
+    argc = 2;
+    bool inquote = false;
+    for (int i = 0; mutable_args[i]; ++i) {
+      if (!inquote && mutable_args[i] == ' ') {
+        mutable_args[i] = '\0';
+        argv[argc++] = mutable_args + i + 1;
+      } else if (mutable_args[i] == '"') {
+        inquote = !inquote;
+        mutable_args[i] = ' ';
+      }
+    }
+    argv[argc] = NULL;
+    execvp(executable, argv);
+    free(argv[0]);
+    free(argv[1]);
+    delete[] argv;
+  }
 #endif
 }
 
@@ -57,12 +57,18 @@
 /// The SVSync class provides functionality for Thread & Process Creation
 class SVSync {
  public:
-  /// Create new thread.
-  static void StartThread(void *(*func)(void*), void* arg);
+  /// Create new thread. Returns false if it could not be created.
+  static bool StartThread(void *(*func)(void*), void* arg);
   /// Signals a thread to exit.
   static void ExitThread();
   /// Starts a new process.
   static void StartProcess(const char* executable, const char* args);
+  /// Calls func(arg, index) for every index in [0, count) on up to
+  /// num_threads threads (including the calling thread) and returns when
+  /// all the calls have finished. The indices are handed out in order to
+  /// whichever thread is free, so func must be safe to call concurrently.
+  static void ParallelFor(int count, int num_threads,
+                          void (*func)(void* arg, int index), void* arg);
 };
 
 /// A semaphore class which encapsulates the main signalling
@@ -71,6 +77,7 @@ class SVSemaphore {
  public:
   /// Sets up a semaphore.
   SVSemaphore();
+  ~SVSemaphore();
   /// Signal a semaphore.
   void Signal();
   /// Wait on a semaphore.
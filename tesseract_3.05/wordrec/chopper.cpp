@@ -420,7 +420,9 @@ void Wordrec::chop_word_main(WERD_RES *word) {
   }
 
   // Run Segmentation Search.
-  BestChoiceBundle best_choice_bundle(word->ratings->dimension());
+  BestChoiceBundle best_choice_bundle(
+      word->ratings->dimension(),
+      language_model_->getViterbiStateEntryPool());
   SegSearch(word, &best_choice_bundle, word->blamer_bundle);
 
   if (word->best_choice == NULL) {
@@ -484,7 +486,8 @@ void Wordrec::improve_by_chopping(float rating_cert_scale,
     // states in WERD_CHOICEs, and blob widths.
     word->InsertSeam(blob_number, seam);
     // Insert a new entry in the beam array.
-    best_choice_bundle->beam.insert(new LanguageModelState, blob_number);
+    best_choice_bundle->beam.insert(
+        new LanguageModelState(best_choice_bundle->pool), blob_number);
     // Fixpts are outdated, but will get recalculated.
     best_choice_bundle->fixpt.clear();
     // Remap existing pain points.
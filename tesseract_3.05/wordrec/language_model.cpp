@@ -609,8 +609,8 @@ bool LanguageModel::AddViterbiStateEntry(
     if (language_model_debug_level > 1) {
       tprintf("Language model components very early pruned this entry\n");
     }
-    delete ngram_info;
-    delete dawg_info;
+    vse_pool_.Recycle(ngram_info);
+    vse_pool_.Recycle(dawg_info);
     return false;
   }
 
@@ -632,8 +632,8 @@ bool LanguageModel::AddViterbiStateEntry(
     if (language_model_debug_level > 1) {
       tprintf("Language model components early pruned this entry\n");
     }
-    delete ngram_info;
-    delete dawg_info;
+    vse_pool_.Recycle(ngram_info);
+    vse_pool_.Recycle(dawg_info);
     return false;
   }
 
@@ -654,7 +654,7 @@ bool LanguageModel::AddViterbiStateEntry(
   }
 
   // Create the new ViterbiStateEntry compute the adjusted cost of the path.
-  ViterbiStateEntry *new_vse = new ViterbiStateEntry(
+  ViterbiStateEntry *new_vse = vse_pool_.NewEntry(
       parent_vse, b, 0.0, outline_length,
       consistency_info, associate_stats, top_choice_flags, dawg_info,
       ngram_info, (language_model_debug_level > 0) ?
@@ -679,7 +679,7 @@ bool LanguageModel::AddViterbiStateEntry(
     if (language_model_debug_level > 1) {
       tprintf("Language model components did not like this entry\n");
     }
-    delete new_vse;
+    vse_pool_.Recycle(new_vse);
     return false;
   }
 
@@ -695,7 +695,7 @@ bool LanguageModel::AddViterbiStateEntry(
               new_vse->cost,
               curr_state->viterbi_state_entries_prunable_max_cost);
     }
-    delete new_vse;
+    vse_pool_.Recycle(new_vse);
     return false;
   }
 
@@ -709,7 +709,7 @@ bool LanguageModel::AddViterbiStateEntry(
       if (language_model_debug_level > 1) {
         tprintf("Discarded ViterbiEntry with high cost %g\n", new_vse->cost);
       }
-      delete new_vse;
+      vse_pool_.Recycle(new_vse);
       return false;
     }
   }
@@ -797,8 +797,7 @@ LanguageModelDawgInfo *LanguageModel::GenerateDawgInfo(
   // Deal with hyphenated words.
   if (word_end && dict_->has_hyphen_end(b.unichar_id(), curr_col == 0)) {
     if (language_model_debug_level > 0) tprintf("Hyphenated word found\n");
-    return new LanguageModelDawgInfo(dawg_args_.active_dawgs,
-                                     COMPOUND_PERM);
+    return vse_pool_.NewDawgInfo(dawg_args_.active_dawgs, COMPOUND_PERM);
   }
 
   // Deal with compound words.
@@ -830,7 +829,7 @@ LanguageModelDawgInfo *LanguageModel::GenerateDawgInfo(
     if (!has_word_ending) return NULL;
 
     if (language_model_debug_level > 0) tprintf("Compound word found\n");
-    return new LanguageModelDawgInfo(&beginning_active_dawgs_, COMPOUND_PERM);
+    return vse_pool_.NewDawgInfo(&beginning_active_dawgs_, COMPOUND_PERM);
   }  // done dealing with compound words
 
   LanguageModelDawgInfo *dawg_info = NULL;
@@ -840,7 +839,6 @@ LanguageModelDawgInfo *LanguageModel::GenerateDawgInfo(
   // like don't.
   const GenericVector<UNICHAR_ID>& normed_ids =
       dict_->getUnicharset().normed_ids(b.unichar_id());
-  DawgPositionVector tmp_active_dawgs;
   for (int i = 0; i < normed_ids.size(); ++i) {
     if (language_model_debug_level > 2)
       tprintf("Test Letter OK for unichar %d, normed %d\n",
@@ -850,8 +848,8 @@ LanguageModelDawgInfo *LanguageModel::GenerateDawgInfo(
     if (dawg_args_.permuter == NO_PERM) {
       break;
     } else if (i < normed_ids.size() - 1) {
-      tmp_active_dawgs = *dawg_args_.updated_dawgs;
-      dawg_args_.active_dawgs = &tmp_active_dawgs;
+      tmp_active_dawgs_ = *dawg_args_.updated_dawgs;
+      dawg_args_.active_dawgs = &tmp_active_dawgs_;
     }
     if (language_model_debug_level > 2)
       tprintf("Letter was OK for unichar %d, normed %d\n",
@@ -859,8 +857,8 @@ LanguageModelDawgInfo *LanguageModel::GenerateDawgInfo(
   }
   dawg_args_.active_dawgs = NULL;
   if (dawg_args_.permuter != NO_PERM) {
-    dawg_info = new LanguageModelDawgInfo(dawg_args_.updated_dawgs,
-                                          dawg_args_.permuter);
+    dawg_info = vse_pool_.NewDawgInfo(dawg_args_.updated_dawgs,
+                                      dawg_args_.permuter);
   } else if (language_model_debug_level > 3) {
     tprintf("Letter %s not OK!\n",
             dict_->getUnicharset().id_to_unichar(b.unichar_id()));
@@ -917,7 +915,7 @@ LanguageModelNgramInfo *LanguageModel::GenerateNgramInfo(
   if (parent_vse != NULL && parent_vse->ngram_info->pruned) pruned = true;
 
   // Construct and return the new LanguageModelNgramInfo.
-  LanguageModelNgramInfo *ngram_info = new LanguageModelNgramInfo(
+  LanguageModelNgramInfo *ngram_info = vse_pool_.NewNgramInfo(
       pcontext_ptr, pcontext_unichar_step_len, pruned, ngram_cost,
       ngram_and_classifier_cost);
   ngram_info->context += unichar;
@@ -98,6 +98,11 @@ class LanguageModel {
   }
   // Returns the reference to ParamsModel.
   inline ParamsModel &getParamsModel() { return params_model_; }
+  // Pool that recycles the ViterbiStateEntries of the segmentation search
+  // across words.
+  inline ViterbiStateEntryPool *getViterbiStateEntryPool() {
+    return &vse_pool_;
+  }
 
  protected:
 
@@ -362,6 +367,9 @@ class LanguageModel {
   // Temporary DawgArgs struct that is re-used across different words to
   // avoid dynamic memory re-allocation (should be cleared before each use).
   DawgArgs dawg_args_;
+  // Temporary active dawgs used by GenerateDawgInfo() when a unichar
+  // normalizes to more than one id, kept here for the same reason.
+  DawgPositionVector tmp_active_dawgs_;
   // Scaling for recovering blob outline length from rating and certainty.
   float rating_cert_scale_;
 
@@ -411,6 +419,9 @@ class LanguageModel {
 
   // Params models containing weights for for computing ViterbiStateEntry costs.
   ParamsModel params_model_;
+
+  // Free lists for the ViterbiStateEntries and their dawg and ngram infos.
+  ViterbiStateEntryPool vse_pool_;
 };
 
 }  // namespace tesseract
@@ -61,7 +61,11 @@ void ViterbiStateEntry::Print(const char *msg) const {
 
 /// Clears the viterbi search state back to its initial conditions.
 void LanguageModelState::Clear() {
-  viterbi_state_entries.clear();
+  if (pool != NULL) {
+    pool->RecycleAll(&viterbi_state_entries);
+  } else {
+    viterbi_state_entries.clear();
+  }
   viterbi_state_entries_prunable_length = 0;
   viterbi_state_entries_prunable_max_cost = MAX_FLOAT32;
   viterbi_state_entries_length = 0;
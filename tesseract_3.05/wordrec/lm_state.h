@@ -61,6 +61,12 @@ typedef unsigned char LanguageModelFlagsType;
 struct LanguageModelDawgInfo {
   LanguageModelDawgInfo(const DawgPositionVector *a, PermuterType pt)
     : active_dawgs(*a), permuter(pt) {}
+  /// Re-initializes a recycled entry. The assignment reuses the memory
+  /// already reserved by active_dawgs.
+  void Set(const DawgPositionVector *a, PermuterType pt) {
+    active_dawgs = *a;
+    permuter = pt;
+  }
   DawgPositionVector active_dawgs;
   PermuterType permuter;
 };
@@ -71,6 +77,15 @@ struct LanguageModelNgramInfo {
   LanguageModelNgramInfo(const char *c, int l, bool p, float nc, float ncc)
     : context(c), context_unichar_step_len(l), pruned(p), ngram_cost(nc),
       ngram_and_classifier_cost(ncc) {}
+  /// Re-initializes a recycled entry. The assignment reuses the memory
+  /// already allocated by context.
+  void Set(const char *c, int l, bool p, float nc, float ncc) {
+    context = c;
+    context_unichar_step_len = l;
+    pruned = p;
+    ngram_cost = nc;
+    ngram_and_classifier_cost = ncc;
+  }
   STRING context;  //< context string
   /// Length of the context measured by advancing using UNICHAR::utf8_step()
   /// (should be at most the order of the character ngram model used).
@@ -97,12 +112,42 @@ struct ViterbiStateEntry : public ELIST_LINK {
                     LanguageModelDawgInfo *d,
                     LanguageModelNgramInfo *n,
                     const char *debug_uch)
-    : cost(c), curr_b(b), parent_vse(pe), competing_vse(NULL),
-      ratings_sum(b->rating()),
-      min_certainty(b->certainty()), adapted(b->IsAdapted()), length(1),
-      outline_length(ol), consistency_info(ci), associate_stats(as),
-      top_choice_flags(tcf), dawg_info(d), ngram_info(n),
-      updated(true) {
+    : consistency_info(ci), dawg_info(NULL), ngram_info(NULL),
+      debug_str(NULL) {
+    Init(pe, b, c, ol, ci, as, tcf, d, n, debug_uch);
+  }
+  ~ViterbiStateEntry() {
+    delete dawg_info;
+    delete ngram_info;
+    delete debug_str;
+  }
+  /// (Re-)initializes all the fields of the entry. Takes ownership of d and n.
+  /// Used by the constructor and by ViterbiStateEntryPool when an entry is
+  /// recycled, in which case dawg_info, ngram_info and debug_str must already
+  /// have been released.
+  void Init(ViterbiStateEntry *pe,
+            BLOB_CHOICE *b, float c, float ol,
+            const LMConsistencyInfo &ci,
+            const AssociateStats &as,
+            LanguageModelFlagsType tcf,
+            LanguageModelDawgInfo *d,
+            LanguageModelNgramInfo *n,
+            const char *debug_uch) {
+    cost = c;
+    curr_b = b;
+    parent_vse = pe;
+    competing_vse = NULL;
+    ratings_sum = b->rating();
+    min_certainty = b->certainty();
+    adapted = b->IsAdapted();
+    length = 1;
+    outline_length = ol;
+    consistency_info = ci;
+    associate_stats = as;
+    top_choice_flags = tcf;
+    dawg_info = d;
+    ngram_info = n;
+    updated = true;
     debug_str = (debug_uch == NULL) ? NULL : new STRING();
     if (pe != NULL) {
       ratings_sum += pe->ratings_sum;
@@ -116,11 +161,6 @@ struct ViterbiStateEntry : public ELIST_LINK {
     }
     if (debug_str != NULL && debug_uch != NULL) *debug_str += debug_uch;
   }
-  ~ViterbiStateEntry() {
-    delete dawg_info;
-    delete ngram_info;
-    delete debug_str;
-  }
   /// Comparator function for sorting ViterbiStateEntry_LISTs in
   /// non-increasing order of costs.
   static int Compare(const void *e1, const void *e2) {
@@ -189,13 +229,98 @@ struct ViterbiStateEntry : public ELIST_LINK {
 
 ELISTIZEH(ViterbiStateEntry);
 
+/// Free lists of ViterbiStateEntry, LanguageModelDawgInfo and
+/// LanguageModelNgramInfo objects. The segmentation search creates and drops
+/// thousands of these per word, so instead of going back to the heap, the
+/// released objects are kept here (owned by the LanguageModel, hence one pool
+/// per thread) and handed out again for the following words. Recycled
+/// LanguageModelDawgInfos keep the memory reserved by their active_dawgs, so
+/// once the pool has warmed up the search runs without allocations.
+class ViterbiStateEntryPool {
+ public:
+  ViterbiStateEntryPool() {}
+  ~ViterbiStateEntryPool() {
+    free_entries_.delete_data_pointers();
+    free_dawg_infos_.delete_data_pointers();
+    free_ngram_infos_.delete_data_pointers();
+  }
+
+  /// Returns a ViterbiStateEntry initialized as by its constructor.
+  ViterbiStateEntry *NewEntry(ViterbiStateEntry *pe,
+                              BLOB_CHOICE *b, float c, float ol,
+                              const LMConsistencyInfo &ci,
+                              const AssociateStats &as,
+                              LanguageModelFlagsType tcf,
+                              LanguageModelDawgInfo *d,
+                              LanguageModelNgramInfo *n,
+                              const char *debug_uch) {
+    if (free_entries_.empty()) {
+      return new ViterbiStateEntry(pe, b, c, ol, ci, as, tcf, d, n, debug_uch);
+    }
+    ViterbiStateEntry *vse = free_entries_.back();
+    free_entries_.truncate(free_entries_.size() - 1);
+    vse->Init(pe, b, c, ol, ci, as, tcf, d, n, debug_uch);
+    return vse;
+  }
+  LanguageModelDawgInfo *NewDawgInfo(const DawgPositionVector *a,
+                                     PermuterType pt) {
+    if (free_dawg_infos_.empty()) return new LanguageModelDawgInfo(a, pt);
+    LanguageModelDawgInfo *dawg_info = free_dawg_infos_.back();
+    free_dawg_infos_.truncate(free_dawg_infos_.size() - 1);
+    dawg_info->Set(a, pt);
+    return dawg_info;
+  }
+  LanguageModelNgramInfo *NewNgramInfo(const char *c, int l, bool p,
+                                       float nc, float ncc) {
+    if (free_ngram_infos_.empty()) {
+      return new LanguageModelNgramInfo(c, l, p, nc, ncc);
+    }
+    LanguageModelNgramInfo *ngram_info = free_ngram_infos_.back();
+    free_ngram_infos_.truncate(free_ngram_infos_.size() - 1);
+    ngram_info->Set(c, l, p, nc, ncc);
+    return ngram_info;
+  }
+
+  /// Takes back an entry that is no longer in any list, together with its
+  /// dawg and ngram info.
+  void Recycle(ViterbiStateEntry *vse) {
+    Recycle(vse->dawg_info);
+    Recycle(vse->ngram_info);
+    vse->dawg_info = NULL;
+    vse->ngram_info = NULL;
+    delete vse->debug_str;
+    vse->debug_str = NULL;
+    free_entries_.push_back(vse);
+  }
+  void Recycle(LanguageModelDawgInfo *dawg_info) {
+    if (dawg_info != NULL) free_dawg_infos_.push_back(dawg_info);
+  }
+  void Recycle(LanguageModelNgramInfo *ngram_info) {
+    if (ngram_info != NULL) free_ngram_infos_.push_back(ngram_info);
+  }
+  /// Empties the given list, recycling all its entries.
+  void RecycleAll(ViterbiStateEntry_LIST *entries) {
+    ViterbiStateEntry_IT vit(entries);
+    for (vit.mark_cycle_pt(); !vit.cycled_list(); vit.forward()) {
+      Recycle(vit.extract());
+    }
+  }
+
+ private:
+  GenericVector<ViterbiStateEntry *> free_entries_;
+  GenericVector<LanguageModelDawgInfo *> free_dawg_infos_;
+  GenericVector<LanguageModelNgramInfo *> free_ngram_infos_;
+};
+
 /// Struct to store information maintained by various language model components.
 struct LanguageModelState {
-  LanguageModelState() :
+  explicit LanguageModelState(ViterbiStateEntryPool *p = NULL) :
      viterbi_state_entries_prunable_length(0),
     viterbi_state_entries_prunable_max_cost(MAX_FLOAT32),
-    viterbi_state_entries_length(0) {}
-  ~LanguageModelState() {}
+    viterbi_state_entries_length(0), pool(p) {}
+  ~LanguageModelState() {
+    if (pool != NULL) pool->RecycleAll(&viterbi_state_entries);
+  }
 
   /// Clears the viterbi search state back to its initial conditions.
   void Clear();
@@ -209,15 +334,18 @@ struct LanguageModelState {
   float viterbi_state_entries_prunable_max_cost;
   /// Total number of entries in viterbi_state_entries.
   int viterbi_state_entries_length;
+  /// Pool that takes back the entries when they are cleared (not owned).
+  /// If NULL, the entries are simply deleted.
+  ViterbiStateEntryPool *pool;
 };
 
 /// Bundle together all the things pertaining to the best choice/state.
 struct BestChoiceBundle {
-  explicit BestChoiceBundle(int matrix_dimension)
-    : updated(false), best_vse(NULL) {
+  BestChoiceBundle(int matrix_dimension, ViterbiStateEntryPool *p)
+    : updated(false), best_vse(NULL), pool(p) {
     beam.reserve(matrix_dimension);
     for (int i = 0; i < matrix_dimension; ++i)
-      beam.push_back(new LanguageModelState);
+      beam.push_back(new LanguageModelState(pool));
   }
   ~BestChoiceBundle() {}
 
@@ -231,6 +359,8 @@ struct BestChoiceBundle {
   PointerVector<LanguageModelState> beam;
   /// Best ViterbiStateEntry and BLOB_CHOICE.
   ViterbiStateEntry *best_vse;
+  /// Pool for the ViterbiStateEntries of the beam (not owned).
+  ViterbiStateEntryPool *pool;
 };
 
 }  // namespace tesseract
@@ -29,7 +29,9 @@
 namespace tesseract {
 
 void Wordrec::DoSegSearch(WERD_RES* word_res) {
-  BestChoiceBundle best_choice_bundle(word_res->ratings->dimension());
+  BestChoiceBundle best_choice_bundle(
+      word_res->ratings->dimension(),
+      language_model_->getViterbiStateEntryPool());
   // Run Segmentation Search.
   SegSearch(word_res, &best_choice_bundle, NULL);
 }
@@ -133,7 +135,9 @@ void Wordrec::WordSearch(WERD_RES* word_res) {
                            assume_fixed_pitch_char_segment,
                            &getDict(), segsearch_debug_level);
   GenericVector<SegSearchPending> pending;
-  BestChoiceBundle best_choice_bundle(word_res->ratings->dimension());
+  BestChoiceBundle best_choice_bundle(
+      word_res->ratings->dimension(),
+      language_model_->getViterbiStateEntryPool());
   // Run Segmentation Search.
   InitialSegSearch(word_res, &pain_points, &pending, &best_choice_bundle, NULL);
   if (segsearch_debug_level > 0) {